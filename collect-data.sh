@@ -51,7 +51,7 @@ for ((i = 0; i < ${#configs[@]}; i++)); do
 	kill -INT $server_pid
 
 	if [ $? == 0 ]; then
-		completion_times=$(echo "$times" | grep "moving average of \"full test client run\":" | sed 's/.*"full test client run": //g' | sed 's/µs//g')
+		completion_times=$(echo "$times" | grep "summary of \"full test client run\":" | sed 's/.*"full test client run": count [0-9]*, mean \([0-9]*\)µs.*/\1/g')
 
 		n=0
 		sum=0
@@ -63,7 +63,7 @@ for ((i = 0; i < ${#configs[@]}; i++)); do
 
 		average_of_completion_times=$((sum / n))
 
-		average_network_input_times=$(echo "$times" | grep "moving average of \"reading input from network\":" | sed 's/.*"reading input from network": //g' | sed 's/µs//g')
+		average_network_input_times=$(echo "$times" | grep "summary of \"reading input from network\":" | sed 's/.*"reading input from network": count [0-9]*, mean \([0-9]*\)µs.*/\1/g')
 
 		n=0
 		sum=0
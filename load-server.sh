@@ -0,0 +1,7 @@
+#!/bin/sh
+
+# same as stress-server.sh except that all of the users are
+# simulated from a single test client process
+
+echo "load-server.sh: starting the load generator..."
+build/src/netsketch_test_client --username juan --clients $1 --iterations $2 --interval $3 --expected-responses $(($1*$2))
@@ -0,0 +1,8 @@
+#!/bin/sh
+
+# runs the microbenchmarks (build with build-rel.sh first),
+# any extra arguments are passed on to the suite (e.g.
+# --filter 'canvas/.*' --output results.json --format json)
+
+echo "microbench.sh: running the microbenchmarks..."
+build/src/netsketch_microbench "$@"
@@ -0,0 +1,8 @@
+#!/bin/sh
+
+# finds the offered load at which the server stops meeting
+# its latency SLO, any extra arguments are passed on to the
+# benchmark driver (e.g. --slo 50000 --output data.csv)
+
+echo "saturate-server.sh: starting the benchmark driver..."
+build/src/netsketch_bench_driver "$@"
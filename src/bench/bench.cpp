@@ -1,14 +1,569 @@
 #include "bench.hpp"
-#include <chrono>
 
-namespace bench {
+// common
+#include "../common/abort.hpp"
+#include "../common/threading.hpp"
+
+// std
+#include <fstream>
+#include <memory>
+#include <string>
+
+// unix
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// cstd
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 
-threading::thread benchmark_thread {};
-threading::mutex benchmark_mutex {};
-threading::cond_var benchmark_cond {};
-std::queue<std::pair<std::string, std::chrono::microseconds>>
-    benchmark_queue {};
+// spdlog
+#include <spdlog/fmt/chrono.h>
+#include <spdlog/spdlog.h>
+
+namespace bench {
 
 bool disable_individual_logs { false };
 
+// all of the scopes which have been passed through, new scopes
+// are pushed onto the front
+static std::atomic<Scope*> scopes { nullptr };
+
+static std::atomic<std::size_t> scope_count { 0 };
+
+// A single pass through a scope, the fields are only atomic so
+// that the trace can be dumped while it is being written to
+struct TraceEvent {
+    std::atomic<const Scope*> scope { nullptr };
+    std::atomic<uint64_t> start_ns { 0 };
+    std::atomic<uint64_t> duration_ns { 0 };
+    std::atomic<uint32_t> tid { 0 };
+};
+
+// The most recent events of a thread, like a slot it is only
+// written to by the thread which holds it and is handed over to
+// another thread once the holder exits
+struct TraceRing {
+    explicit TraceRing(std::size_t capacity)
+        : capacity { capacity }
+        , events { std::make_unique<TraceEvent[]>(capacity) }
+    {
+    }
+
+    TraceRing(const TraceRing&) = delete;
+    TraceRing& operator=(const TraceRing&) = delete;
+
+    std::atomic<bool> is_held { true };
+
+    TraceRing* next { nullptr };
+
+    // the number of events ever written
+    std::atomic<uint64_t> head { 0 };
+
+    std::size_t capacity { 0 };
+
+    std::unique_ptr<TraceEvent[]> events;
+};
+
+static std::atomic<bool> is_tracing { false };
+
+static std::string trace_path {};
+
+static std::size_t trace_capacity { BENCH_TRACE_DEFAULT_EVENTS };
+
+static std::atomic<TraceRing*> trace_rings { nullptr };
+
+// the thread which dumps the trace on SIGUSR1
+static threading::thread trace_thread {};
+
+// serializes dumps (from the signal and from shutting down)
+static threading::mutex trace_mutex {};
+
+static TraceRing* acquire_trace_ring()
+{
+    for (TraceRing* ring = trace_rings.load(std::memory_order_acquire);
+         ring != nullptr;
+         ring = ring->next) {
+        bool is_held { false };
+
+        if (!ring->is_held.load(std::memory_order_relaxed)
+            && ring->is_held.compare_exchange_strong(
+                is_held,
+                true,
+                std::memory_order_acquire
+            )) {
+            return ring;
+        }
+    }
+
+    auto* ring = new TraceRing { trace_capacity };
+
+    ring->next = trace_rings.load(std::memory_order_relaxed);
+
+    while (!trace_rings.compare_exchange_weak(
+        ring->next,
+        ring,
+        std::memory_order_release,
+        std::memory_order_relaxed
+    )) { }
+
+    return ring;
+}
+
+// The slots held by a thread (indexed by the id of the scope),
+// they are handed back once the thread exits
+class ThreadSlots {
+   public:
+    ThreadSlots() = default;
+
+    ThreadSlots(const ThreadSlots&) = delete;
+
+    ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+    Slot*& operator[](std::size_t id)
+    {
+        return m_slots[id];
+    }
+
+    void trace(const Scope& scope, uint64_t start_ns, uint64_t duration_ns)
+    {
+        if (m_ring == nullptr) {
+            m_ring = acquire_trace_ring();
+            m_tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        }
+
+        uint64_t head = m_ring->head.load(std::memory_order_relaxed);
+
+        // NOTE: orders the previous bump of the head before
+        // overwriting the event (see dump_trace)
+        std::atomic_thread_fence(std::memory_order_release);
+
+        TraceEvent& event = m_ring->events[head % m_ring->capacity];
+
+        event.scope.store(&scope, std::memory_order_relaxed);
+        event.start_ns.store(start_ns, std::memory_order_relaxed);
+        event.duration_ns.store(duration_ns, std::memory_order_relaxed);
+        event.tid.store(m_tid, std::memory_order_relaxed);
+
+        m_ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    ~ThreadSlots()
+    {
+        for (Slot* slot : m_slots) {
+            if (slot != nullptr) {
+                slot->is_held.store(false, std::memory_order_release);
+            }
+        }
+
+        if (m_ring != nullptr) {
+            m_ring->is_held.store(false, std::memory_order_release);
+        }
+    }
+
+   private:
+    std::array<Slot*, BENCH_MAX_SCOPES> m_slots {};
+
+    TraceRing* m_ring { nullptr };
+    uint32_t m_tid { 0 };
+};
+
+static thread_local ThreadSlots thread_slots {};
+
+Scope::Scope(
+    const char* file,
+    const char* function_name,
+    const char* line,
+    const char* name
+)
+    : m_file { file }
+    , m_function_name { function_name }
+    , m_line { line }
+    , m_name { name }
+    , m_id { scope_count.fetch_add(1, std::memory_order_relaxed) }
+{
+    if (m_id >= BENCH_MAX_SCOPES) {
+        ABORTV("more than {} benchmarked scopes", BENCH_MAX_SCOPES);
+    }
+
+    m_next = scopes.load(std::memory_order_relaxed);
+
+    while (!scopes.compare_exchange_weak(
+        m_next,
+        this,
+        std::memory_order_release,
+        std::memory_order_relaxed
+    )) { }
+}
+
+Slot* Scope::acquire()
+{
+    for (Slot* slot = slots(); slot != nullptr; slot = slot->next) {
+        bool is_held { false };
+
+        if (!slot->is_held.load(std::memory_order_relaxed)
+            && slot->is_held.compare_exchange_strong(
+                is_held,
+                true,
+                std::memory_order_acquire
+            )) {
+            return slot;
+        }
+    }
+
+    auto* slot = new Slot {};
+
+    slot->next = m_slots.load(std::memory_order_relaxed);
+
+    while (!m_slots.compare_exchange_weak(
+        slot->next,
+        slot,
+        std::memory_order_release,
+        std::memory_order_relaxed
+    )) { }
+
+    return slot;
+}
+
+void Scope::record(std::chrono::nanoseconds time_taken)
+{
+    Slot*& slot = thread_slots[m_id];
+
+    if (slot == nullptr) {
+        slot = acquire();
+    }
+
+    slot->record(static_cast<uint64_t>(std::max<int64_t>(time_taken.count(), 0))
+    );
+}
+
+std::vector<Summary> summarize()
+{
+    std::vector<Summary> summaries {};
+
+    for (Scope* scope = scopes.load(std::memory_order_acquire);
+         scope != nullptr;
+         scope = scope->next()) {
+        Buckets merged {};
+
+        uint64_t count { 0 };
+        uint64_t sum_ns { 0 };
+        uint64_t max_ns { 0 };
+
+        for (Slot* slot = scope->slots(); slot != nullptr; slot = slot->next) {
+            for (std::size_t i = 0; i < Buckets::BUCKET_COUNT; i++) {
+                merged.record(
+                    Buckets::highest_equivalent_of(i),
+                    slot->counts[i].load(std::memory_order_relaxed)
+                );
+            }
+
+            count += slot->count.load(std::memory_order_relaxed);
+            sum_ns += slot->sum_ns.load(std::memory_order_relaxed);
+            max_ns = std::max(max_ns, slot->max_ns.load(std::memory_order_relaxed));
+        }
+
+        if (count == 0) {
+            continue;
+        }
+
+        // NOTE: the percentiles are only as accurate as the
+        // buckets, but they never exceed the exact maximum
+        auto percentile = [&merged, max_ns](double percentile) {
+            return std::chrono::nanoseconds {
+                std::min(merged.percentile(percentile), max_ns)
+            };
+        };
+
+        summaries.push_back(Summary {
+            scope,
+            count,
+            std::chrono::nanoseconds { sum_ns / count },
+            percentile(50),
+            percentile(90),
+            percentile(99),
+            percentile(99.9),
+            std::chrono::nanoseconds { max_ns },
+        });
+    }
+
+    return summaries;
+}
+
+bool setup()
+{
+    const char* path = std::getenv(BENCH_TRACE_ENV);
+
+    if (path == nullptr || *path == '\0') {
+        return true;
+    }
+
+    const char* events = std::getenv(BENCH_TRACE_EVENTS_ENV);
+
+    if (events != nullptr) {
+        char* end { nullptr };
+
+        auto capacity = std::strtoull(events, &end, 10);
+
+        if (*end != '\0' || capacity < 2) {
+            fmt::println(
+                stderr,
+                "error: {} has to be at least two events",
+                BENCH_TRACE_EVENTS_ENV
+            );
+
+            return false;
+        }
+
+        trace_capacity = static_cast<std::size_t>(capacity);
+    }
+
+    trace_path = path;
+
+    for (std::size_t at = trace_path.find("%p"); at != std::string::npos;
+         at = trace_path.find("%p", at)) {
+        trace_path.replace(at, 2, std::to_string(getpid()));
+    }
+
+    // NOTE: every thread started from here on inherits the mask,
+    // so the signal is only ever picked up by the trace thread
+    sigset_t set {};
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+
+    auto ret = pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    if (ret != 0) {
+        fmt::println(
+            stderr,
+            "error: failed to block SIGUSR1, reason {}",
+            strerror(ret)
+        );
+
+        return false;
+    }
+
+    trace_thread = threading::thread { [set]() {
+        for (;;) {
+            int signal { 0 };
+
+            if (sigwait(&set, &signal) == 0) {
+                dump_trace();
+            }
+        }
+    } };
+
+    is_tracing.store(true);
+
+    return true;
+}
+
+bool dump_trace()
+{
+    threading::mutex_guard guard { trace_mutex };
+
+    std::ofstream of { trace_path };
+
+    if (!of) {
+        spdlog::error("could not open {}", trace_path);
+
+        return false;
+    }
+
+    auto pid = getpid();
+
+    uint64_t event_count { 0 };
+
+    of << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+
+    for (TraceRing* ring = trace_rings.load(std::memory_order_acquire);
+         ring != nullptr;
+         ring = ring->next) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+
+        // NOTE: the oldest event is left out as it is the one
+        // which gets overwritten next
+        uint64_t first = head - std::min<uint64_t>(head, ring->capacity - 1);
+
+        for (uint64_t i = first; i < head; i++) {
+            const TraceEvent& event = ring->events[i % ring->capacity];
+
+            const Scope* scope = event.scope.load(std::memory_order_relaxed);
+            uint64_t start_ns = event.start_ns.load(std::memory_order_relaxed);
+            uint64_t duration_ns
+                = event.duration_ns.load(std::memory_order_relaxed);
+            uint32_t tid = event.tid.load(std::memory_order_relaxed);
+
+            // NOTE: the thread holding the ring could have lapped
+            // us while we were reading, in which case the event
+            // may be torn and is skipped
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            uint64_t new_head = ring->head.load(std::memory_order_relaxed);
+
+            if (i + ring->capacity <= new_head) {
+                continue;
+            }
+
+            // timestamps are in microseconds (with nanoseconds
+            // as the fraction)
+            of << fmt::format(
+                "{}\n{{\"name\": \"{}\", \"cat\": \"bench\", \"ph\": \"X\", "
+                "\"ts\": {}.{:03}, \"dur\": {}.{:03}, \"pid\": {}, "
+                "\"tid\": {}, \"args\": {{\"at\": \"{}:{}:{}\"}}}}",
+                event_count == 0 ? "" : ",",
+                scope->name(),
+                start_ns / 1000,
+                start_ns % 1000,
+                duration_ns / 1000,
+                duration_ns % 1000,
+                pid,
+                tid,
+                scope->file(),
+                scope->function_name(),
+                scope->line()
+            );
+
+            event_count++;
+        }
+    }
+
+    of << "\n]}\n";
+
+    if (!of) {
+        spdlog::error("could not write the trace to {}", trace_path);
+
+        return false;
+    }
+
+    spdlog::info("wrote {} trace events to {}", event_count, trace_path);
+
+    return true;
+}
+
+void report()
+{
+    if (is_tracing.exchange(false)) {
+        trace_thread.cancel();
+        trace_thread.join();
+
+        dump_trace();
+    }
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    for (const auto& summary : summarize()) {
+        spdlog::debug(
+            "[{}:{}:{}] summary of \"{}\": count {}, mean {}, p50 {}, p90 {}, "
+            "p99 {}, p99.9 {}, max {}",
+            summary.scope->file(),
+            summary.scope->function_name(),
+            summary.scope->line(),
+            summary.scope->name(),
+            summary.count,
+            duration_cast<microseconds>(summary.mean),
+            duration_cast<microseconds>(summary.p50),
+            duration_cast<microseconds>(summary.p90),
+            duration_cast<microseconds>(summary.p99),
+            duration_cast<microseconds>(summary.p999),
+            duration_cast<microseconds>(summary.max)
+        );
+    }
+}
+
+#ifdef NETSKETCH_LOCKPROF
+
+static std::chrono::microseconds to_micros(uint64_t duration_ns)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds {
+            static_cast<std::chrono::nanoseconds::rep>(duration_ns) }
+    );
+}
+
+#endif
+
+void report_locks()
+{
+#ifdef NETSKETCH_LOCKPROF
+    for (const auto& summary : threading::lockprof::summarize()) {
+        // NOTE: the waits of a condition variable are waits to
+        // be notified, not contention
+        if (summary.kind == threading::lockprof::Kind::COND_VAR) {
+            spdlog::info(
+                "[lock] summary of \"{}\" ({}): waits {}, waited {} (mean {}, "
+                "max {})",
+                summary.name,
+                threading::lockprof::kind_name(summary.kind),
+                summary.acquisitions,
+                to_micros(summary.wait_ns),
+                to_micros(summary.wait_ns / summary.acquisitions),
+                to_micros(summary.max_wait_ns)
+            );
+
+            continue;
+        }
+
+        spdlog::info(
+            "[lock] summary of \"{}\" ({}): acquisitions {}, contended {} "
+            "({:.2f}%), waited {} (mean {}, max {}), held {} (mean {}, max {})",
+            summary.name,
+            threading::lockprof::kind_name(summary.kind),
+            summary.acquisitions,
+            summary.contentions,
+            100.0 * static_cast<double>(summary.contentions)
+                / static_cast<double>(summary.acquisitions),
+            to_micros(summary.wait_ns),
+            to_micros(
+                summary.contentions == 0
+                    ? 0
+                    : summary.wait_ns / summary.contentions
+            ),
+            to_micros(summary.max_wait_ns),
+            to_micros(summary.hold_ns),
+            to_micros(summary.hold_ns / summary.acquisitions),
+            to_micros(summary.max_hold_ns)
+        );
+    }
+#endif
+}
+
+Bench::~Bench()
+{
+    auto time_taken = std::chrono::steady_clock::now() - m_start;
+
+    m_scope.record(time_taken);
+
+    if (is_tracing.load(std::memory_order_relaxed)) {
+        thread_slots.trace(
+            m_scope,
+            static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    m_start.time_since_epoch()
+                )
+                    .count()
+            ),
+            static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(time_taken)
+                    .count()
+            )
+        );
+    }
+
+    if (!disable_individual_logs) {
+        spdlog::debug(
+            "[{}:{}:{}] \"{}\" Time Taken: {}",
+            m_scope.file(),
+            m_scope.function_name(),
+            m_scope.line(),
+            m_scope.name(),
+            std::chrono::duration_cast<std::chrono::microseconds>(time_taken)
+        );
+    }
+}
+
 } // namespace bench
@@ -1,17 +1,38 @@
 #pragma once
 
 // std
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <vector>
 
-// spdlog
-#include <spdlog/fmt/chrono.h>
-#include <spdlog/spdlog.h>
+// cstd
+#include <cstdint>
 
 // common
-#include "../common/threading.hpp"
+#include "../common/histogram.hpp"
 
-// std
-#include <queue>
+// The number of sub-bucket bits of the histograms kept by
+// the benchmarks, there is a histogram for every thread which
+// passes through a benchmarked scope so they are kept small
+// (~8KiB with a relative error < 6.25%)
+#define BENCH_SUB_BUCKET_BITS (5)
+
+// The maximum number of benchmarked scopes in a binary
+#define BENCH_MAX_SCOPES (64)
+
+// The environment variable which turns tracing on, it names
+// the file the trace is written to (a %p in it is replaced
+// with the process id)
+#define BENCH_TRACE_ENV "NETSKETCH_TRACE"
+
+// The environment variable which sets the number of events
+// kept for every thread while tracing
+#define BENCH_TRACE_EVENTS_ENV "NETSKETCH_TRACE_EVENTS"
+
+// The default number of events kept for every thread (at 32
+// bytes an event that is 128KiB a thread)
+#define BENCH_TRACE_DEFAULT_EVENTS (4096)
 
 // The below class is small class which is starts a timer when
 // its created and closes a timer when it is destroyed.
@@ -19,122 +40,189 @@
 // to be used is by creating a scope and constructing the
 // Bench object within that scope. This basically,
 // allows us to time particular scope.
+//
+// Every benchmarked scope (i.e. every use of the BENCH macro)
+// has a single static Scope which identifies it. The time
+// taken is recorded into a histogram which belongs to both
+// the scope and the current thread, so recording a sample is
+// just a few (uncontended) relaxed stores. The histograms of
+// all threads are only merged when a summary is asked for.
+//
+// Optionally (see BENCH_TRACE_ENV), every pass through a scope
+// is also kept as an event in a ring buffer of the thread, the
+// most recent events of every thread are written out as Chrome
+// trace-event JSON (which Perfetto can open) when the program
+// shuts down or whenever it receives SIGUSR1. Only the last
+// so many events of a thread are kept, so the memory used is
+// bounded by the number of threads alive at once.
 
 namespace bench {
 
-extern threading::thread benchmark_thread;
-extern threading::mutex benchmark_mutex;
-extern threading::cond_var benchmark_cond;
-extern std::queue<std::pair<std::string, std::chrono::microseconds>>
-    benchmark_queue;
+using Buckets = BasicHistogram<BENCH_SUB_BUCKET_BITS>;
 
 extern bool disable_individual_logs;
 
-class MovingBenchmark {
-   public:
-    void operator()()
-    {
-        for (;;) {
-            threading::unique_mutex_guard guard { benchmark_mutex };
+// The samples a single thread recorded for a scope, it is only
+// ever written to by the thread which holds it (the atomics
+// are there so that it can be read while being written to)
+struct Slot {
+    std::atomic<bool> is_held { true };
 
-            benchmark_cond.wait(guard, []() {
-                return benchmark_queue.empty();
-            });
+    Slot* next { nullptr };
 
-            auto [key, time_taken] = benchmark_queue.front();
+    std::array<std::atomic<uint64_t>, Buckets::BUCKET_COUNT> counts {};
 
-            benchmark_queue.pop();
+    std::atomic<uint64_t> count { 0 };
+    std::atomic<uint64_t> sum_ns { 0 };
+    std::atomic<uint64_t> max_ns { 0 };
 
-            m_moving_averages[key]
-                = (m_moving_averages.count(key) <= 0)
-                      ? time_taken
-                      : (m_moving_averages[key] + time_taken) / 2;
-        }
-    }
-
-    ~MovingBenchmark()
+    void record(uint64_t ns)
     {
-        for (auto& [key, moving_average] : m_moving_averages) {
-            spdlog::debug("moving average of \"{}\": {}", key, moving_average);
+        auto& bucket = counts[Buckets::index_of(ns)];
+
+        bucket.store(
+            bucket.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed
+        );
+
+        count.store(
+            count.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed
+        );
+        sum_ns.store(
+            sum_ns.load(std::memory_order_relaxed) + ns,
+            std::memory_order_relaxed
+        );
+
+        if (ns > max_ns.load(std::memory_order_relaxed)) {
+            max_ns.store(ns, std::memory_order_relaxed);
         }
     }
-
-   private:
-    std::unordered_map<std::string, std::chrono::microseconds>
-        m_moving_averages {};
 };
 
-class Bench {
+class Scope {
    public:
-    explicit Bench(
+    Scope(
         const char* file,
         const char* function_name,
         const char* line,
         const char* name
-    )
-        : m_file { file }
-        , m_function_name { function_name }
-        , m_line { line }
-        , m_name { name }
+    );
+
+    Scope(const Scope&) = delete;
+
+    Scope& operator=(const Scope&) = delete;
+
+    void record(std::chrono::nanoseconds time_taken);
+
+    // NOTE: the slots are never freed (a scope lives until the
+    // end of the program anyway), so that a thread which is
+    // still running at exit can never record into freed memory
+    ~Scope() = default;
+
+    // hands out a slot for the calling thread, reusing the slot
+    // of a thread which has exited if there is one
+    Slot* acquire();
+
+    [[nodiscard]] const char* file() const
     {
-        m_start = std::chrono::high_resolution_clock::now();
+        return m_file;
     }
 
-    explicit Bench(
-        std::string file,
-        std::string function_name,
-        std::string line,
-        std::string name
-    )
-        : m_file { std::move(file) }
-        , m_function_name { std::move(function_name) }
-        , m_line { std::move(line) }
-        , m_name { std::move(name) }
+    [[nodiscard]] const char* function_name() const
     {
-        m_start = std::chrono::high_resolution_clock::now();
+        return m_function_name;
     }
 
-    ~Bench()
+    [[nodiscard]] const char* line() const
     {
-        m_end = std::chrono::high_resolution_clock::now();
+        return m_line;
+    }
 
-        auto start
-            = std::chrono::time_point_cast<std::chrono::microseconds>(m_start)
-                  .time_since_epoch();
-        auto end
-            = std::chrono::time_point_cast<std::chrono::microseconds>(m_end)
-                  .time_since_epoch();
+    [[nodiscard]] const char* name() const
+    {
+        return m_name;
+    }
 
-        std::chrono::microseconds time_taken = (end - start);
+    [[nodiscard]] std::size_t id() const
+    {
+        return m_id;
+    }
 
-        {
-            threading::mutex_guard guard { benchmark_mutex };
+    [[nodiscard]] Scope* next() const
+    {
+        return m_next;
+    }
 
-            benchmark_queue.emplace(m_name, time_taken);
-        }
+    [[nodiscard]] Slot* slots() const
+    {
+        return m_slots.load(std::memory_order_acquire);
+    }
 
-        benchmark_cond.notify_one();
-
-        if (!disable_individual_logs) {
-            spdlog::debug(
-                "[{}:{}:{}] \"{}\" Time Taken: {}",
-                m_file,
-                m_function_name,
-                m_line,
-                m_name,
-                time_taken
-            );
-        }
+   private:
+    const char* m_file { nullptr };
+    const char* m_function_name { nullptr };
+    const char* m_line { nullptr };
+    const char* m_name { nullptr };
+
+    std::size_t m_id { 0 };
+
+    std::atomic<Slot*> m_slots { nullptr };
+
+    Scope* m_next { nullptr };
+};
+
+// The samples of every thread for a scope merged together
+struct Summary {
+    const Scope* scope { nullptr };
+
+    uint64_t count { 0 };
+
+    std::chrono::nanoseconds mean {};
+    std::chrono::nanoseconds p50 {};
+    std::chrono::nanoseconds p90 {};
+    std::chrono::nanoseconds p99 {};
+    std::chrono::nanoseconds p999 {};
+    std::chrono::nanoseconds max {};
+};
+
+std::vector<Summary> summarize();
+
+// turns on tracing if asked for by the environment, this has
+// to be called before any other thread is started (so that
+// they all leave SIGUSR1 to the thread which dumps the trace)
+bool setup();
+
+// logs a summary of every scope which has been passed through
+// (and writes out the trace if tracing)
+void report();
+
+// writes the events of every thread out as Chrome trace-event
+// JSON
+bool dump_trace();
+
+// logs the contention of every profiled lock (only when built
+// with LOCKPROF, see common/lockprof.hpp)
+void report_locks();
+
+class Bench {
+   public:
+    explicit Bench(Scope& scope)
+        : m_scope { scope }
+        , m_start { std::chrono::steady_clock::now() }
+    {
     }
 
+    Bench(const Bench&) = delete;
+
+    Bench& operator=(const Bench&) = delete;
+
+    ~Bench();
+
    private:
-    std::chrono::time_point<std::chrono::high_resolution_clock> m_start {};
-    std::chrono::time_point<std::chrono::high_resolution_clock> m_end {};
+    Scope& m_scope;
 
-    std::string m_file {};
-    std::string m_function_name {};
-    std::string m_line {};
-    std::string m_name {};
+    std::chrono::time_point<std::chrono::steady_clock> m_start {};
 };
 
 } // namespace bench
@@ -156,7 +244,7 @@ class Bench {
 
 template <std::size_t N>
 struct CompTimeString {
-    char bytes[N];
+    char bytes[N] {};
 
     [[nodiscard]] constexpr std::size_t size() const
     {
@@ -236,18 +324,16 @@ constexpr CompTimeString<N> file_name(CompTimeString<N> file_path)
         bench::disable_individual_logs = true; \
     } while (0)
 
-#define START_BENCHMARK_THREAD                                 \
-    do {                                                       \
-        bench::benchmark_thread                                \
-            = threading::thread { bench::MovingBenchmark {} }; \
+#define SETUP_BENCHMARKS         \
+    do {                         \
+        if (!bench::setup()) {   \
+            return false;        \
+        }                        \
     } while (0)
 
-#define END_BENCHMARK_THREAD                            \
-    do {                                                \
-        if (bench::benchmark_thread.is_initialized()) { \
-            bench::benchmark_thread.cancel();           \
-            bench::benchmark_thread.join();             \
-        }                                               \
+#define REPORT_BENCHMARKS \
+    do {                  \
+        bench::report();  \
     } while (0)
 
 // This is the macro we use to instead of calling
@@ -255,17 +341,35 @@ constexpr CompTimeString<N> file_name(CompTimeString<N> file_path)
 // all the info relating to the file name,
 // function name and line number.
 
-#define BENCH(name)                                                         \
-    bench::Bench netsketch_server_internal_bench                            \
-    {                                                                       \
-        file_name(CompTimeString { __FILE__ }), __func__, LINE_STRING, name \
+#define BENCH(name)                                                       \
+    static constexpr auto netsketch_internal_bench_file                   \
+        = file_name(CompTimeString { __FILE__ });                         \
+    static bench::Scope netsketch_internal_bench_scope {                  \
+        netsketch_internal_bench_file.data(), __func__, LINE_STRING, name \
+    };                                                                    \
+    bench::Bench netsketch_internal_bench                                 \
+    {                                                                     \
+        netsketch_internal_bench_scope                                    \
     }
 
 #else
 
 #define DISABLE_INDIVIDUAL_LOGS
-#define START_BENCHMARK_THREAD
-#define END_BENCHMARK_THREAD
+#define SETUP_BENCHMARKS
+#define REPORT_BENCHMARKS
 #define BENCH(name)
 
 #endif
+
+#ifdef NETSKETCH_LOCKPROF
+
+#define REPORT_LOCKS           \
+    do {                       \
+        bench::report_locks(); \
+    } while (0)
+
+#else
+
+#define REPORT_LOCKS
+
+#endif
@@ -0,0 +1,363 @@
+// bench_compare
+#include "comparer.hpp"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+// cstd
+#include <cmath>
+#include <cstdlib>
+
+// fmt
+#include <fmt/core.h>
+
+namespace bench_compare {
+
+// splits a line of comma separated values
+static std::vector<std::string> split_csv_line(const std::string& line)
+{
+    std::vector<std::string> fields {};
+
+    std::istringstream stream { line };
+
+    std::string field {};
+
+    while (std::getline(stream, field, ',')) {
+        fields.push_back(field);
+    }
+
+    return fields;
+}
+
+// reads a CSV file with a header, lines starting with # are
+// comments (so that a baseline can say where it came from)
+static std::optional<ResultTable>
+read_table(const std::string& path, const std::string& key)
+{
+    std::ifstream file { path };
+
+    if (!file) {
+        fmt::println(stderr, "error: could not open {}", path);
+
+        return std::nullopt;
+    }
+
+    ResultTable table {};
+
+    std::vector<std::string> header {};
+    size_t key_index { 0 };
+
+    std::string line {};
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields = split_csv_line(line);
+
+        if (header.empty()) {
+            header = std::move(fields);
+
+            auto iter = std::find(header.begin(), header.end(), key);
+
+            if (iter == header.end()) {
+                fmt::println(
+                    stderr,
+                    "error: {} has no {} column",
+                    path,
+                    key
+                );
+
+                return std::nullopt;
+            }
+
+            key_index = static_cast<size_t>(iter - header.begin());
+
+            continue;
+        }
+
+        if (fields.size() != header.size()) {
+            fmt::println(
+                stderr,
+                "error: {} has a row with {} fields instead of {}",
+                path,
+                fields.size(),
+                header.size()
+            );
+
+            return std::nullopt;
+        }
+
+        const std::string& row_key = fields[key_index];
+
+        if (table.rows.count(row_key) > 0) {
+            fmt::println(
+                stderr,
+                "error: {} has more than one row for {}",
+                path,
+                row_key
+            );
+
+            return std::nullopt;
+        }
+
+        auto& row = table.rows[row_key];
+
+        for (size_t i = 0; i < fields.size(); i++) {
+            // NOTE: columns which are not numbers (like the
+            // name of a benchmark) are simply left out
+            char* end { nullptr };
+
+            double value = std::strtod(fields[i].c_str(), &end);
+
+            if (!fields[i].empty() && *end == '\0') {
+                row[header[i]] = value;
+            }
+        }
+
+        table.keys.push_back(row_key);
+    }
+
+    if (header.empty()) {
+        fmt::println(stderr, "error: {} is empty", path);
+
+        return std::nullopt;
+    }
+
+    return table;
+}
+
+bool Comparer::setup(
+    const std::string& baseline_path,
+    const std::string& results_path,
+    const std::string& key,
+    const std::vector<Metric>& metrics,
+    const std::vector<Limit>& limits,
+    double tolerance,
+    const std::string& noise_column,
+    bool allow_missing
+)
+{
+    if (metrics.empty() && limits.empty()) {
+        fmt::println(stderr, "error: there are no metrics to compare");
+
+        return false;
+    }
+
+    if (tolerance < 0) {
+        fmt::println(stderr, "error: the tolerance cannot be negative");
+
+        return false;
+    }
+
+    auto baseline = read_table(baseline_path, key);
+
+    if (!baseline.has_value()) {
+        return false;
+    }
+
+    auto results = read_table(results_path, key);
+
+    if (!results.has_value()) {
+        return false;
+    }
+
+    m_key = key;
+    m_metrics = metrics;
+    m_limits = limits;
+    m_tolerance = tolerance;
+    m_noise_column = noise_column;
+    m_allow_missing = allow_missing;
+    m_baseline = std::move(*baseline);
+    m_results = std::move(*results);
+
+    return true;
+}
+
+bool Comparer::run() const
+{
+    fmt::println(
+        "{:<48} {:<14} {:>14} {:>14} {:>9}  {}",
+        m_key,
+        "metric",
+        "baseline",
+        "current",
+        "change",
+        "verdict"
+    );
+
+    uint32_t regressions { 0 };
+    uint32_t improvements { 0 };
+    uint32_t missing { 0 };
+
+    for (const auto& key : m_baseline.keys) {
+        const auto& baseline_row = m_baseline.rows.at(key);
+
+        auto results_iter = m_results.rows.find(key);
+
+        if (results_iter == m_results.rows.end()) {
+            fmt::println(
+                "{:<48} {:<14} {:>14} {:>14} {:>9}  missing",
+                key,
+                "-",
+                "-",
+                "-",
+                "-"
+            );
+
+            missing++;
+
+            continue;
+        }
+
+        for (const auto& metric : m_metrics) {
+            auto baseline_value = baseline_row.find(metric.column);
+            auto current_value = results_iter->second.find(metric.column);
+
+            if (baseline_value == baseline_row.end()
+                || current_value == results_iter->second.end()) {
+                fmt::println(
+                    "{:<48} {:<14} {:>14} {:>14} {:>9}  missing",
+                    key,
+                    metric.column,
+                    "-",
+                    "-",
+                    "-"
+                );
+
+                missing++;
+
+                continue;
+            }
+
+            double before = baseline_value->second;
+            double after = current_value->second;
+
+            // the relative change (any change from zero is
+            // treated as infinitely large)
+            double change { 0 };
+
+            if (before != 0) {
+                change = (after - before) / std::abs(before);
+            } else if (after != 0) {
+                change = after > 0 ? INFINITY : -INFINITY;
+            }
+
+            // positive if the metric got worse
+            double worsening = metric.direction == Direction::HIGHER_IS_BETTER
+                                   ? -change
+                                   : change;
+
+            // the spread of both sides, zero if unknown
+            double noise { 0 };
+
+            if (!m_noise_column.empty()) {
+                auto baseline_noise = baseline_row.find(m_noise_column);
+                auto current_noise = results_iter->second.find(m_noise_column);
+
+                if (baseline_noise != baseline_row.end()
+                    && current_noise != results_iter->second.end()) {
+                    noise = NOISE_FACTOR
+                          * (baseline_noise->second + current_noise->second);
+                }
+            }
+
+            const char* verdict = "ok";
+
+            if (noise > 0 && std::abs(after - before) <= noise) {
+                verdict = "ok (noise)";
+            } else if (worsening > m_tolerance) {
+                verdict = "REGRESSED";
+
+                regressions++;
+            } else if (worsening < -m_tolerance) {
+                verdict = "improved";
+
+                improvements++;
+            }
+
+            fmt::println(
+                "{:<48} {:<14} {:>14.3f} {:>14.3f} {:>+8.1f}%  {}",
+                key,
+                metric.column,
+                before,
+                after,
+                change * 100,
+                verdict
+            );
+        }
+
+        for (const auto& limit : m_limits) {
+            auto current_value = results_iter->second.find(limit.column);
+
+            if (current_value == results_iter->second.end()) {
+                fmt::println(
+                    "{:<48} {:<14} {:>14} {:>14} {:>9}  missing",
+                    key,
+                    limit.column,
+                    "-",
+                    "-",
+                    "-"
+                );
+
+                missing++;
+
+                continue;
+            }
+
+            const char* verdict = "ok";
+
+            if (current_value->second > limit.at_most) {
+                verdict = "OVER LIMIT";
+
+                regressions++;
+            }
+
+            fmt::println(
+                "{:<48} {:<14} {:>14} {:>14.3f} {:>9}  {}",
+                key,
+                limit.column,
+                fmt::format("<= {:.3f}", limit.at_most),
+                current_value->second,
+                "-",
+                verdict
+            );
+        }
+    }
+
+    for (const auto& key : m_results.keys) {
+        if (m_baseline.rows.count(key) == 0) {
+            fmt::println(
+                "{:<48} {:<14} {:>14} {:>14} {:>9}  new",
+                key,
+                "-",
+                "-",
+                "-",
+                "-"
+            );
+        }
+    }
+
+    fmt::println(
+        "{} regressed, {} improved and {} missing (tolerance {:.1f}%)",
+        regressions,
+        improvements,
+        missing,
+        m_tolerance * 100
+    );
+
+    if (improvements > 0) {
+        fmt::println(
+            "NOTE: consider updating the baseline to lock in the "
+            "improvements"
+        );
+    }
+
+    return regressions == 0 && (m_allow_missing || missing == 0);
+}
+
+} // namespace bench_compare
@@ -0,0 +1,92 @@
+#pragma once
+
+// std
+#include <map>
+#include <string>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+// The number of times the combined spread of the baseline and
+// the results a change has to exceed to not be noise
+#define NOISE_FACTOR (3.0)
+
+namespace bench_compare {
+
+// A table of results read from a CSV file, keyed on one of
+// its columns
+struct ResultTable {
+    std::vector<std::string> keys {};
+    std::map<std::string, std::map<std::string, double>> rows {};
+};
+
+// Whether a larger or a smaller value of a metric is better
+enum class Direction : uint8_t {
+    LOWER_IS_BETTER,
+    HIGHER_IS_BETTER,
+};
+
+struct Metric {
+    std::string column {};
+    Direction direction { Direction::LOWER_IS_BETTER };
+};
+
+// A metric which is checked against a fixed limit rather than
+// against the baseline (like an error rate, which is usually
+// zero in the baseline, so that any change is infinitely large)
+struct Limit {
+    std::string column {};
+    double at_most { 0 };
+};
+
+// The comparer checks a set of results (from the microbenchmark
+// suite or the benchmark driver) against a baseline which was
+// produced the same way. Every metric of every row is compared
+// and a metric which got worse by more than the tolerance (a
+// fraction of the baseline value) counts as a regression.
+//
+// When the results carry a measure of their own spread (like
+// the MAD of the microbenchmarks), a change which is within
+// a few times the spread is put down to noise and never counts
+// as a regression or an improvement.
+//
+// A limit is checked as is, a metric over its limit counts as
+// a regression whatever the baseline says.
+//
+// NOTE: rows are matched up on the key column, a row of the
+// baseline which is missing from the results also fails the
+// comparison (unless it is allowed) since a benchmark which is
+// silently dropped can hide a regression.
+
+class Comparer {
+   public:
+    Comparer() = default;
+
+    bool setup(
+        const std::string& baseline_path,
+        const std::string& results_path,
+        const std::string& key,
+        const std::vector<Metric>& metrics,
+        const std::vector<Limit>& limits,
+        double tolerance,
+        const std::string& noise_column,
+        bool allow_missing
+    );
+
+    // prints the comparison, fails if anything regressed
+    [[nodiscard]] bool run() const;
+
+   private:
+    std::string m_key {};
+    std::vector<Metric> m_metrics {};
+    std::vector<Limit> m_limits {};
+    double m_tolerance { 0 };
+    std::string m_noise_column {};
+    bool m_allow_missing { false };
+
+    ResultTable m_baseline {};
+    ResultTable m_results {};
+};
+
+} // namespace bench_compare
@@ -0,0 +1,146 @@
+// bench_compare
+#include "comparer.hpp"
+
+// cli11
+#include <CLI/App.hpp>
+#include <CLI/CLI.hpp>
+#include <CLI/Validators.hpp>
+
+// cstd
+#include <cstdlib>
+
+// fmt
+#include <fmt/core.h>
+
+int main(int argc, char** argv)
+{
+    CLI::App app;
+
+    std::string baseline_path {};
+    app.add_option(
+           "--baseline",
+           baseline_path,
+           "The CSV file of results which are compared against"
+    )
+        ->required();
+
+    std::string results_path {};
+    app.add_option(
+           "--results",
+           results_path,
+           "The CSV file of results which are checked"
+    )
+        ->required();
+
+    std::string key { "name" };
+    app.add_option(
+           "--key",
+           key,
+           "The column which identifies a row (e.g. name for the "
+           "microbenchmarks and offered_rate for the benchmark driver)"
+    )
+        ->capture_default_str();
+
+    std::vector<std::string> lower_is_better {};
+    app.add_option(
+        "--lower-is-better",
+        lower_is_better,
+        "The columns which regress when they increase (like latencies)"
+    );
+
+    std::vector<std::string> higher_is_better {};
+    app.add_option(
+        "--higher-is-better",
+        higher_is_better,
+        "The columns which regress when they decrease (like throughput)"
+    );
+
+    std::vector<std::string> at_most {};
+    app.add_option(
+        "--at-most",
+        at_most,
+        "Columns which are checked against a fixed limit rather than "
+        "against the baseline, as COLUMN=LIMIT (like error_rate=0.001)"
+    );
+
+    double tolerance { 0.1 };
+    app.add_option(
+           "--tolerance",
+           tolerance,
+           "How much worse (as a fraction of the baseline) a metric can "
+           "get before it counts as a regression"
+    )
+        ->capture_default_str();
+
+    std::string noise_column {};
+    app.add_option(
+        "--noise-column",
+        noise_column,
+        "A column with the spread of the metrics (like mad_ns), changes "
+        "within a few times the spread are ignored"
+    );
+
+    bool allow_missing { false };
+    app.add_flag(
+        "--allow-missing",
+        allow_missing,
+        "Do not fail if a row or a metric of the baseline is missing from "
+        "the results"
+    );
+
+    CLI11_PARSE(app, argc, argv);
+
+    std::vector<bench_compare::Metric> metrics {};
+
+    for (const auto& column : lower_is_better) {
+        metrics.push_back({ column, bench_compare::Direction::LOWER_IS_BETTER }
+        );
+    }
+
+    for (const auto& column : higher_is_better) {
+        metrics.push_back({ column, bench_compare::Direction::HIGHER_IS_BETTER }
+        );
+    }
+
+    std::vector<bench_compare::Limit> limits {};
+
+    for (const auto& option : at_most) {
+        size_t split = option.find('=');
+
+        char* end { nullptr };
+
+        double limit = split == std::string::npos
+                           ? 0
+                           : std::strtod(option.c_str() + split + 1, &end);
+
+        if (split == std::string::npos || split == 0 || end == nullptr
+            || end == option.c_str() + split + 1 || *end != '\0') {
+            fmt::println(stderr, "error: expected COLUMN=LIMIT, got {}", option);
+
+            return EXIT_FAILURE;
+        }
+
+        limits.push_back({ option.substr(0, split), limit });
+    }
+
+    bench_compare::Comparer comparer {};
+
+    if (!comparer.setup(
+            baseline_path,
+            results_path,
+            key,
+            metrics,
+            limits,
+            tolerance,
+            noise_column,
+            allow_missing
+        )) {
+        return EXIT_FAILURE;
+    }
+
+    if (!comparer.run()) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// bench_driver
+#include "runner.hpp"
+
+// std
+#include <filesystem>
+
+// cli11
+#include <CLI/App.hpp>
+#include <CLI/CLI.hpp>
+#include <CLI/Validators.hpp>
+
+int main(int argc, char** argv)
+{
+    CLI::App app;
+
+    // by default the other binaries are expected to be built
+    // alongside the driver
+    std::filesystem::path build_dir
+        = std::filesystem::path { argv[0] }.parent_path();
+
+    std::string server_path { (build_dir / "netsketch_server").string() };
+    app.add_option(
+           "--server-binary",
+           server_path,
+           "The path to the NetSketch server binary"
+    )
+        ->capture_default_str();
+
+    std::string test_client_path {
+        (build_dir / "netsketch_test_client").string()
+    };
+    app.add_option(
+           "--test-client-binary",
+           test_client_path,
+           "The path to the NetSketch test client binary"
+    )
+        ->capture_default_str();
+
+    uint16_t port { 7777 };
+    app.add_option(
+           "--port",
+           port,
+           "The port number the server under test listens on"
+    )
+        ->capture_default_str();
+
+    uint32_t clients { 100 };
+    app.add_option("--clients", clients, "The number of simulated users")
+        ->capture_default_str();
+
+    double start_rate { 100 };
+    app.add_option(
+           "--start-rate",
+           start_rate,
+           "The offered load (actions per second) of the first step"
+    )
+        ->capture_default_str();
+
+    double rate_step { 100 };
+    app.add_option(
+           "--rate-step",
+           rate_step,
+           "How much the offered load is increased by at every step"
+    )
+        ->capture_default_str();
+
+    double max_rate { 10000 };
+    app.add_option(
+           "--max-rate",
+           max_rate,
+           "The offered load at which the search gives up"
+    )
+        ->capture_default_str();
+
+    double step_secs { 10 };
+    app.add_option(
+           "--step-duration",
+           step_secs,
+           "How long (in seconds) the load is offered for at every step"
+    )
+        ->capture_default_str();
+
+    std::string slo_percentile { "p99" };
+    app.add_option(
+           "--slo-percentile",
+           slo_percentile,
+           "The latency percentile the SLO is set on"
+    )
+        ->capture_default_str()
+        ->check(CLI::IsMember({ "p50", "p90", "p99", "p999", "max" }));
+
+    uint64_t slo_us { 100000 };
+    app.add_option(
+           "--slo",
+           slo_us,
+           "The latency SLO in microseconds (from sending an action to "
+           "receiving its broadcast)"
+    )
+        ->capture_default_str();
+
+    double max_error_rate { 0.001 };
+    app.add_option(
+           "--max-error-rate",
+           max_error_rate,
+           "The largest tolerated fraction of broadcasts which never arrive"
+    )
+        ->capture_default_str();
+
+    std::string output {};
+    app.add_option(
+        "--output",
+        output,
+        "A CSV file to which the results of every step are written"
+    );
+
+    CLI11_PARSE(app, argc, argv);
+
+    bench_driver::Runner runner {};
+
+    if (!runner.setup(
+            server_path,
+            test_client_path,
+            port,
+            clients,
+            start_rate,
+            rate_step,
+            max_rate,
+            step_secs,
+            slo_percentile,
+            slo_us,
+            max_error_rate,
+            output
+        )) {
+        return EXIT_FAILURE;
+    }
+
+    if (!runner.run()) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
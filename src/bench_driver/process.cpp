@@ -0,0 +1,234 @@
+// bench_driver
+#include "process.hpp"
+
+// unix
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// cstd
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+// std
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+// fmt
+#include <fmt/core.h>
+
+namespace bench_driver {
+
+ChildProcess::ChildProcess(pid_t pid)
+    : m_pid(pid)
+{
+}
+
+ChildProcess::ChildProcess(ChildProcess&& other) noexcept
+    : m_pid(std::exchange(other.m_pid, -1))
+    , m_has_exited(std::exchange(other.m_has_exited, false))
+{
+}
+
+ChildProcess& ChildProcess::operator=(ChildProcess&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    if (m_pid != -1 && !m_has_exited) {
+        kill(m_pid, SIGKILL);
+
+        waitpid(m_pid, nullptr, 0);
+    }
+
+    m_pid = std::exchange(other.m_pid, -1);
+    m_has_exited = std::exchange(other.m_has_exited, false);
+
+    return *this;
+}
+
+std::optional<ChildProcess>
+ChildProcess::spawn(const std::vector<std::string>& args)
+{
+    std::vector<char*> argv {};
+
+    argv.reserve(args.size() + 1);
+
+    for (auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        fmt::println(stderr, "error: fork(): {}", strerror(errno));
+
+        return std::nullopt;
+    }
+
+    if (pid == 0) {
+        int dev_null = open("/dev/null", O_WRONLY);
+
+        if (dev_null != -1) {
+            dup2(dev_null, STDOUT_FILENO);
+            dup2(dev_null, STDERR_FILENO);
+        }
+
+        execv(argv[0], argv.data());
+
+        // NOTE: stderr is gone at this point so the exit code
+        // is all the parent gets
+        _exit(127);
+    }
+
+    return ChildProcess { pid };
+}
+
+pid_t ChildProcess::pid() const
+{
+    return m_pid;
+}
+
+void ChildProcess::signal(int signal) const
+{
+    if (m_pid != -1 && !m_has_exited) {
+        kill(m_pid, signal);
+    }
+}
+
+std::optional<int> ChildProcess::wait(double timeout_secs)
+{
+    if (m_pid == -1 || m_has_exited) {
+        return std::nullopt;
+    }
+
+    struct timespec spec { };
+
+    spec.tv_nsec = 10000000; // 10ms
+
+    double waited { 0 };
+
+    for (;;) {
+        int status { 0 };
+
+        pid_t ret = waitpid(m_pid, &status, WNOHANG);
+
+        if (ret == m_pid) {
+            m_has_exited = true;
+
+            if (WIFEXITED(status)) {
+                return WEXITSTATUS(status);
+            }
+
+            return std::nullopt;
+        }
+
+        if (ret == -1 || waited >= timeout_secs) {
+            return std::nullopt;
+        }
+
+        nanosleep(&spec, nullptr);
+
+        waited += 0.01;
+    }
+}
+
+std::optional<ProcessStats> ChildProcess::stats() const
+{
+    if (m_pid == -1 || m_has_exited) {
+        return std::nullopt;
+    }
+
+    ProcessStats stats {};
+
+    // NOTE: please refer to proc(5), utime and stime are the
+    // 14th and 15th fields of stat, the second field (the
+    // name of the executable) can contain spaces so we skip
+    // past its closing parenthesis first
+    {
+        std::ifstream file { fmt::format("/proc/{}/stat", m_pid) };
+
+        std::string contents {};
+
+        if (!std::getline(file, contents)) {
+            return std::nullopt;
+        }
+
+        std::istringstream fields {
+            contents.substr(contents.rfind(')') + 2)
+        };
+
+        std::string field {};
+
+        unsigned long utime { 0 };
+        unsigned long stime { 0 };
+
+        // the 3rd field up to the 13th
+        for (int i = 3; i <= 13; i++) {
+            fields >> field;
+        }
+
+        fields >> utime >> stime;
+
+        auto ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+
+        stats.cpu_secs = static_cast<double>(utime + stime) / ticks;
+    }
+
+    {
+        std::ifstream file { fmt::format("/proc/{}/status", m_pid) };
+
+        std::string key {};
+
+        while (file >> key) {
+            if (key == "VmHWM:") {
+                file >> stats.max_rss_kib;
+            }
+
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+    }
+
+    // NOTE: unlike the rest, the context switches in status
+    // are per thread so they are summed up over every task
+    std::error_code error {};
+
+    for (auto& task : std::filesystem::directory_iterator {
+             fmt::format("/proc/{}/task", m_pid), error }) {
+        std::ifstream file { task.path() / "status" };
+
+        std::string key {};
+
+        uint64_t count { 0 };
+
+        while (file >> key) {
+            if (key == "voluntary_ctxt_switches:" && file >> count) {
+                stats.voluntary_ctx_switches += count;
+            } else if (key == "nonvoluntary_ctxt_switches:" && file >> count) {
+                stats.involuntary_ctx_switches += count;
+            }
+
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+    }
+
+    return stats;
+}
+
+ChildProcess::~ChildProcess()
+{
+    if (m_pid != -1 && !m_has_exited) {
+        kill(m_pid, SIGKILL);
+
+        waitpid(m_pid, nullptr, 0);
+    }
+}
+
+} // namespace bench_driver
@@ -0,0 +1,65 @@
+#pragma once
+
+// std
+#include <optional>
+#include <string>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+// unix
+#include <sys/types.h>
+
+namespace bench_driver {
+
+// Resource usage of a process as reported by procfs, all of
+// it is cumulative since the process started
+struct ProcessStats {
+    double cpu_secs { 0 };
+    uint64_t max_rss_kib { 0 };
+    uint64_t voluntary_ctx_switches { 0 };
+    uint64_t involuntary_ctx_switches { 0 };
+};
+
+// A child process which is started with fork/exec (with its
+// output thrown away). If it is still running when the object
+// is destroyed it is killed.
+
+class ChildProcess {
+   public:
+    ChildProcess() = default;
+
+    ChildProcess(ChildProcess&& other) noexcept;
+
+    ChildProcess& operator=(ChildProcess&& other) noexcept;
+
+    ChildProcess(const ChildProcess&) = delete;
+
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    [[nodiscard]] static std::optional<ChildProcess>
+    spawn(const std::vector<std::string>& args);
+
+    [[nodiscard]] pid_t pid() const;
+
+    void signal(int signal) const;
+
+    // waits for at most timeout_secs for the process to exit
+    // and returns its exit status (std::nullopt if it is
+    // still running or was killed by a signal)
+    std::optional<int> wait(double timeout_secs);
+
+    [[nodiscard]] std::optional<ProcessStats> stats() const;
+
+    ~ChildProcess();
+
+   private:
+    explicit ChildProcess(pid_t pid);
+
+    pid_t m_pid { -1 };
+
+    bool m_has_exited { false };
+};
+
+} // namespace bench_driver
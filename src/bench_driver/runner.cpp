@@ -0,0 +1,459 @@
+// bench_driver
+#include "runner.hpp"
+
+// common
+#include "../common/network.hpp"
+
+// unix
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <unistd.h>
+
+// cstd
+#include <cmath>
+#include <ctime>
+
+// std
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+// fmt
+#include <fmt/core.h>
+
+// How long the server gets to start listening
+#define SERVER_START_TIMEOUT_SECS (5.0)
+
+// How long the server gets to shut down once interrupted
+#define SERVER_STOP_TIMEOUT_SECS (10.0)
+
+namespace bench_driver {
+
+// splits a line of comma separated values
+static std::vector<std::string> split_csv_line(const std::string& line)
+{
+    std::vector<std::string> fields {};
+
+    std::istringstream stream { line };
+
+    std::string field {};
+
+    while (std::getline(stream, field, ',')) {
+        fields.push_back(field);
+    }
+
+    return fields;
+}
+
+// reads the latency output of the test client, which is a
+// header followed by a single row
+static std::optional<std::map<std::string, std::string>>
+read_latency_output(const std::string& path)
+{
+    std::ifstream file { path };
+
+    std::string header {};
+    std::string row {};
+
+    if (!std::getline(file, header) || !std::getline(file, row)) {
+        return std::nullopt;
+    }
+
+    auto keys = split_csv_line(header);
+    auto values = split_csv_line(row);
+
+    if (keys.size() != values.size()) {
+        return std::nullopt;
+    }
+
+    std::map<std::string, std::string> columns {};
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        columns[keys[i]] = values[i];
+    }
+
+    return columns;
+}
+
+bool Runner::setup(
+    const std::string& server_path,
+    const std::string& test_client_path,
+    uint16_t port,
+    uint32_t clients,
+    double start_rate,
+    double rate_step,
+    double max_rate,
+    double step_secs,
+    const std::string& slo_percentile,
+    uint64_t slo_us,
+    double max_error_rate,
+    const std::string& output
+)
+{
+    if (access(server_path.c_str(), X_OK) != 0) {
+        fmt::println(stderr, "error: {} is not executable", server_path);
+
+        return false;
+    }
+
+    if (access(test_client_path.c_str(), X_OK) != 0) {
+        fmt::println(stderr, "error: {} is not executable", test_client_path);
+
+        return false;
+    }
+
+    if (clients < 2) {
+        fmt::println(stderr, "error: at least two clients are required");
+
+        return false;
+    }
+
+    if (start_rate <= 0 || rate_step <= 0 || max_rate < start_rate) {
+        fmt::println(stderr, "error: invalid range of rates");
+
+        return false;
+    }
+
+    m_server_path = server_path;
+    m_test_client_path = test_client_path;
+    m_port = port;
+    m_clients = clients;
+    m_start_rate = start_rate;
+    m_rate_step = rate_step;
+    m_max_rate = max_rate;
+    m_step_secs = step_secs;
+    m_slo_percentile = slo_percentile;
+    m_slo_us = slo_us;
+    m_max_error_rate = max_error_rate;
+    m_output = output;
+
+    return true;
+}
+
+bool Runner::run()
+{
+    fmt::println(
+        "{:>4} {:>10} {:>10} {:>12} {:>9} {:>9} {:>9} {:>9} {:>9} {:>7} "
+        "{:>8} {:>10} {:>10} {:>10}",
+        "step",
+        "offered/s",
+        "sent/s",
+        "received/s",
+        "p50 µs",
+        "p90 µs",
+        "p99 µs",
+        "p99.9 µs",
+        "max µs",
+        "errors",
+        "cpu s",
+        "rss KiB",
+        "vol cs",
+        "invol cs"
+    );
+
+    size_t step = 0;
+
+    for (double rate = m_start_rate; rate <= m_max_rate;
+         rate += m_rate_step, step++) {
+        auto result = run_step(step, rate);
+
+        if (!result.has_value()) {
+            return false;
+        }
+
+        m_results.push_back(*result);
+
+        print(step, *result);
+
+        if (!result->is_within_slo) {
+            break;
+        }
+    }
+
+    auto knee = std::find_if(
+        m_results.rbegin(),
+        m_results.rend(),
+        [](const StepResult& result) {
+            return result.is_within_slo;
+        }
+    );
+
+    if (knee == m_results.rend()) {
+        fmt::println(
+            "knee: none, the SLO was breached at the first step already"
+        );
+    } else if (knee == m_results.rbegin()) {
+        fmt::println(
+            "knee: not reached, the SLO held up to {:.1f} actions/s "
+            "({:.1f} broadcasts/s)",
+            knee->offered_rate,
+            knee->throughput
+        );
+    } else {
+        fmt::println(
+            "knee: {:.1f} actions/s ({:.1f} broadcasts/s, {} {} µs)",
+            knee->offered_rate,
+            knee->throughput,
+            m_slo_percentile,
+            slo_value_of(*knee)
+        );
+    }
+
+    return write_output();
+}
+
+std::optional<StepResult> Runner::run_step(size_t step, double rate)
+{
+    // every user sends the same number of actions, enough to
+    // keep the offered rate up for (roughly) the duration of
+    // a step
+    auto iterations = static_cast<uint32_t>(std::max(
+        1.0,
+        std::round(rate * m_step_secs / static_cast<double>(m_clients))
+    ));
+
+    uint64_t expected_responses
+        = static_cast<uint64_t>(m_clients) * iterations;
+
+    std::string latency_output
+        = (std::filesystem::temp_directory_path()
+           / fmt::format("netsketch_bench_{}_{}.csv", getpid(), step))
+              .string();
+
+    // NOTE: the server does not set SO_REUSEADDR so the port
+    // of the previous step might still be held up by
+    // connections in TIME_WAIT, hence every step gets its own
+    auto port = static_cast<uint16_t>(m_port + step);
+
+    auto server = ChildProcess::spawn(
+        { m_server_path, "--port", std::to_string(port) }
+    );
+
+    if (!server.has_value()) {
+        return std::nullopt;
+    }
+
+    if (!wait_for_server(port)) {
+        fmt::println(stderr, "error: the server did not start listening");
+
+        return std::nullopt;
+    }
+
+    auto client = ChildProcess::spawn({ m_test_client_path,
+                                        "--port",
+                                        std::to_string(port),
+                                        "--username",
+                                        fmt::format("bench{}_", step),
+                                        "--clients",
+                                        std::to_string(m_clients),
+                                        "--iterations",
+                                        std::to_string(iterations),
+                                        "--rate",
+                                        fmt::format("{}", rate),
+                                        "--expected-responses",
+                                        std::to_string(expected_responses),
+                                        "--latency-output",
+                                        latency_output,
+                                        "--latency-format",
+                                        "csv" });
+
+    if (!client.has_value()) {
+        return std::nullopt;
+    }
+
+    // NOTE: a saturated server might never deliver everything,
+    // so the load generator is only given so long
+    std::optional<int> client_status = client->wait(m_step_secs * 3 + 30);
+
+    client->signal(SIGKILL);
+
+    StepResult result {};
+
+    result.offered_rate = rate;
+
+    // the server is fresh for every step so its totals are
+    // exactly what this step cost
+    auto stats = server->stats();
+
+    if (stats.has_value()) {
+        result.server = *stats;
+    }
+
+    server->signal(SIGINT);
+
+    if (!server->wait(SERVER_STOP_TIMEOUT_SECS).has_value()) {
+        server->signal(SIGKILL);
+    }
+
+    auto columns = read_latency_output(latency_output);
+
+    std::filesystem::remove(latency_output);
+
+    if (!client_status.has_value() || !columns.has_value()) {
+        result.error_rate = 1;
+
+        return result;
+    }
+
+    try {
+        double elapsed = std::stod(columns->at("elapsed_sec"));
+
+        auto sent = std::stoull(columns->at("actions_sent"));
+        auto received = std::stoull(columns->at("actions_received"));
+
+        result.achieved_rate = static_cast<double>(sent) / elapsed;
+        result.throughput = static_cast<double>(received) / elapsed;
+
+        result.p50_us = std::stoull(columns->at("p50_us"));
+        result.p90_us = std::stoull(columns->at("p90_us"));
+        result.p99_us = std::stoull(columns->at("p99_us"));
+        result.p999_us = std::stoull(columns->at("p999_us"));
+        result.max_us = std::stoull(columns->at("max_us"));
+
+        // every user is expected to receive every action
+        auto expected = static_cast<double>(m_clients)
+                        * static_cast<double>(expected_responses);
+
+        result.error_rate = std::max(
+            0.0,
+            1.0 - static_cast<double>(received) / expected
+        );
+    } catch (std::exception& error) {
+        fmt::println(
+            stderr,
+            "warn: could not parse the latency output, reason {}",
+            error.what()
+        );
+
+        result.error_rate = 1;
+
+        return result;
+    }
+
+    result.is_within_slo = slo_value_of(result) <= m_slo_us
+                           && result.error_rate <= m_max_error_rate;
+
+    return result;
+}
+
+bool Runner::wait_for_server(uint16_t port) const
+{
+    struct timespec spec { };
+
+    spec.tv_nsec = 50000000; // 50ms
+
+    for (double waited = 0; waited < SERVER_START_TIMEOUT_SECS;
+         waited += 0.05) {
+        nanosleep(&spec, nullptr);
+
+        // NOTE: the server will try to read a username from
+        // this connection, closing it straight away just makes
+        // it give up on it
+        try {
+            IPv4Socket sock {};
+
+            sock.open(SOCK_STREAM, 0);
+
+            sockaddr_in addr {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(port);
+
+            sock.connect(&addr);
+
+            return true;
+        } catch (std::runtime_error&) {
+            continue;
+        }
+    }
+
+    return false;
+}
+
+uint64_t Runner::slo_value_of(const StepResult& result) const
+{
+    if (m_slo_percentile == "p50")
+        return result.p50_us;
+    if (m_slo_percentile == "p90")
+        return result.p90_us;
+    if (m_slo_percentile == "p999")
+        return result.p999_us;
+    if (m_slo_percentile == "max")
+        return result.max_us;
+
+    return result.p99_us;
+}
+
+void Runner::print(size_t step, const StepResult& result) const
+{
+    fmt::println(
+        "{:>4} {:>10.1f} {:>10.1f} {:>12.1f} {:>9} {:>9} {:>9} {:>9} {:>9} "
+        "{:>7.4f} {:>8.2f} {:>10} {:>10} {:>10}{}",
+        step,
+        result.offered_rate,
+        result.achieved_rate,
+        result.throughput,
+        result.p50_us,
+        result.p90_us,
+        result.p99_us,
+        result.p999_us,
+        result.max_us,
+        result.error_rate,
+        result.server.cpu_secs,
+        result.server.max_rss_kib,
+        result.server.voluntary_ctx_switches,
+        result.server.involuntary_ctx_switches,
+        result.is_within_slo ? "" : " (SLO breached)"
+    );
+}
+
+bool Runner::write_output() const
+{
+    if (m_output.empty()) {
+        return true;
+    }
+
+    std::ofstream of { m_output };
+
+    if (!of) {
+        fmt::println(stderr, "error: could not open {}", m_output);
+
+        return false;
+    }
+
+    of << "step,offered_rate,achieved_rate,throughput,p50_us,p90_us,p99_us,"
+          "p999_us,max_us,error_rate,server_cpu_sec,server_max_rss_kib,"
+          "server_voluntary_ctx_switches,server_involuntary_ctx_switches,"
+          "within_slo\n";
+
+    for (size_t step = 0; step < m_results.size(); step++) {
+        const StepResult& result = m_results[step];
+
+        of << fmt::format(
+            "{},{:.3f},{:.3f},{:.3f},{},{},{},{},{},{:.6f},{:.3f},{},{},{},{}"
+            "\n",
+            step,
+            result.offered_rate,
+            result.achieved_rate,
+            result.throughput,
+            result.p50_us,
+            result.p90_us,
+            result.p99_us,
+            result.p999_us,
+            result.max_us,
+            result.error_rate,
+            result.server.cpu_secs,
+            result.server.max_rss_kib,
+            result.server.voluntary_ctx_switches,
+            result.server.involuntary_ctx_switches,
+            result.is_within_slo ? 1 : 0
+        );
+    }
+
+    return true;
+}
+
+} // namespace bench_driver
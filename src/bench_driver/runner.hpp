@@ -0,0 +1,92 @@
+#pragma once
+
+// bench_driver
+#include "process.hpp"
+
+// std
+#include <optional>
+#include <string>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+namespace bench_driver {
+
+// The outcome of running the load generator against a fresh
+// server at a single offered rate
+struct StepResult {
+    double offered_rate { 0 };
+    double achieved_rate { 0 };
+    double throughput { 0 };
+
+    uint64_t p50_us { 0 };
+    uint64_t p90_us { 0 };
+    uint64_t p99_us { 0 };
+    uint64_t p999_us { 0 };
+    uint64_t max_us { 0 };
+
+    // the fraction of the expected broadcasts which never
+    // arrived (one if the load generator failed outright)
+    double error_rate { 0 };
+
+    ProcessStats server {};
+
+    bool is_within_slo { false };
+};
+
+// The runner ramps the offered load up step by step, each
+// step starting a fresh server and pointing the (open loop)
+// load generator of the test client at it, until either the
+// latency SLO or the error threshold is breached. The last
+// step which was still within both is the knee point.
+
+class Runner {
+   public:
+    Runner() = default;
+
+    bool setup(
+        const std::string& server_path,
+        const std::string& test_client_path,
+        uint16_t port,
+        uint32_t clients,
+        double start_rate,
+        double rate_step,
+        double max_rate,
+        double step_secs,
+        const std::string& slo_percentile,
+        uint64_t slo_us,
+        double max_error_rate,
+        const std::string& output
+    );
+
+    [[nodiscard]] bool run();
+
+   private:
+    [[nodiscard]] std::optional<StepResult> run_step(size_t step, double rate);
+
+    [[nodiscard]] bool wait_for_server(uint16_t port) const;
+
+    [[nodiscard]] uint64_t slo_value_of(const StepResult& result) const;
+
+    void print(size_t step, const StepResult& result) const;
+
+    [[nodiscard]] bool write_output() const;
+
+    std::string m_server_path {};
+    std::string m_test_client_path {};
+    uint16_t m_port {};
+    uint32_t m_clients {};
+    double m_start_rate {};
+    double m_rate_step {};
+    double m_max_rate {};
+    double m_step_secs {};
+    std::string m_slo_percentile {};
+    uint64_t m_slo_us {};
+    double m_max_error_rate {};
+    std::string m_output {};
+
+    std::vector<StepResult> m_results {};
+};
+
+} // namespace bench_driver
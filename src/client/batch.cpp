@@ -0,0 +1,295 @@
+// client
+#include "batch.hpp"
+#include "bounds.hpp"
+
+// common
+#include "../common/overload.hpp"
+#include "../common/stroke.hpp"
+
+// raylib
+#include <raymath.h>
+#include <rlgl.h>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+// The maximum number of vertices which are handed over to
+// rlgl in one go. It is kept well below the size of the
+// default rlgl render batch so that a run never has to
+// be split up by rlgl itself.
+#define MAX_VERTICES_PER_SUBMIT (3 * 2048)
+
+namespace client {
+
+[[nodiscard]] static Color to_raylib_colour(Colour colour)
+{
+    return { colour.r, colour.g, colour.b, 255 };
+}
+
+// NOTE: this mirrors how raylib picks the number of segments
+// for DrawCircle, i.e. the maximum distance between the
+// tessellated edge and the actual circle is half a pixel.
+// The radius is in screen space.
+static int circle_segments(float radius)
+{
+    if (radius <= 0.5f) {
+        return 6;
+    }
+
+    float angle = std::acos(1.0f - (0.5f / radius));
+
+    int segments = static_cast<int>(std::ceil(2 * PI / angle));
+
+    return std::clamp(segments, 6, 72);
+}
+
+void SceneBatch::clear()
+{
+    m_vertices.clear();
+
+    m_runs.clear();
+}
+
+void SceneBatch::push_triangle(Vector2 a, Vector2 b, Vector2 c, Color colour)
+{
+    // raylib culls back faces so the vertices have to be
+    // in counter-clockwise order (as seen on the screen
+    // where the y axis points downwards)
+    float cross = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+
+    if (cross > 0) {
+        std::swap(b, c);
+    }
+
+    m_vertices.push_back({ a.x, a.y, colour });
+    m_vertices.push_back({ b.x, b.y, colour });
+    m_vertices.push_back({ c.x, c.y, colour });
+}
+
+// the offset from a segment to either of its edges
+static Vector2 segment_normal(Vector2 start, Vector2 end, float thickness)
+{
+    Vector2 delta = Vector2Subtract(end, start);
+
+    return Vector2Scale(Vector2Normalize({ -delta.y, delta.x }), thickness / 2);
+}
+
+void SceneBatch::push_segment(
+    Vector2 start,
+    Vector2 end,
+    float thickness,
+    Color colour
+)
+{
+    // same as DrawLineEx, nothing is drawn for a line of
+    // length zero
+    if (Vector2Length(Vector2Subtract(end, start)) <= 0) {
+        return;
+    }
+
+    // a line is a quad which extends half the thickness on
+    // either side of the segment
+    Vector2 normal = segment_normal(start, end, thickness);
+
+    Vector2 a = Vector2Add(start, normal);
+    Vector2 b = Vector2Subtract(start, normal);
+    Vector2 c = Vector2Subtract(end, normal);
+    Vector2 d = Vector2Add(end, normal);
+
+    push_triangle(a, b, c, colour);
+    push_triangle(a, c, d, colour);
+}
+
+void SceneBatch::add(const Draw& draw, float zoom)
+{
+    if (std::holds_alternative<TextDraw>(draw)) {
+        m_runs.emplace_back(std::get<TextDraw>(draw));
+
+        return;
+    }
+
+    size_t begin = m_vertices.size();
+
+    std::visit(
+        overload {
+            [](const TextDraw&) {
+            },
+            [this, zoom](const CircleDraw& arg) {
+                Color colour = to_raylib_colour(arg.colour);
+
+                Vector2 centre { static_cast<float>(arg.x),
+                                 static_cast<float>(arg.y) };
+
+                float radius = std::abs(arg.r);
+
+                int segments = circle_segments(radius * zoom);
+
+                float step = 2 * PI / static_cast<float>(segments);
+
+                Vector2 previous { centre.x + radius, centre.y };
+
+                for (int i = 1; i <= segments; i++) {
+                    float angle = step * static_cast<float>(i);
+
+                    Vector2 current { centre.x + radius * std::cos(angle),
+                                      centre.y + radius * std::sin(angle) };
+
+                    push_triangle(centre, previous, current, colour);
+
+                    previous = current;
+                }
+            },
+            [this](const RectangleDraw& arg) {
+                Color colour = to_raylib_colour(arg.colour);
+
+                auto left = static_cast<float>(std::min(arg.x0, arg.x1));
+                auto right = static_cast<float>(std::max(arg.x0, arg.x1));
+                auto top = static_cast<float>(std::min(arg.y0, arg.y1));
+                auto bottom = static_cast<float>(std::max(arg.y0, arg.y1));
+
+                push_triangle(
+                    { left, top },
+                    { left, bottom },
+                    { right, bottom },
+                    colour
+                );
+                push_triangle(
+                    { left, top },
+                    { right, bottom },
+                    { right, top },
+                    colour
+                );
+            },
+            [this](const LineDraw& arg) {
+                push_segment(
+                    { static_cast<float>(arg.x0), static_cast<float>(arg.y0) },
+                    { static_cast<float>(arg.x1), static_cast<float>(arg.y1) },
+                    LINE_THICKNESS,
+                    to_raylib_colour(arg.colour)
+                );
+            },
+            [this](const StrokeDraw& arg) {
+                Color colour = to_raylib_colour(arg.colour);
+
+                float thickness = stroke_thickness(arg);
+
+                Vector2 previous { static_cast<float>(arg.x),
+                                   static_cast<float>(arg.y) };
+
+                // the normal of the previous segment (if any)
+                std::optional<Vector2> joint {};
+
+                // NOTE: all the segments go into the same run, so
+                // the stroke is drawn as a single polyline
+                stroke::for_each_point(arg, [&](int x, int y) {
+                    Vector2 current { static_cast<float>(x),
+                                      static_cast<float>(y) };
+
+                    if (Vector2Length(Vector2Subtract(current, previous))
+                        <= 0) {
+                        return;
+                    }
+
+                    Vector2 normal
+                        = segment_normal(previous, current, thickness);
+
+                    // the gap between two segments is filled with
+                    // a bevel on either side (only the one on the
+                    // outside of the turn shows)
+                    if (joint) {
+                        push_triangle(
+                            previous,
+                            Vector2Add(previous, *joint),
+                            Vector2Add(previous, normal),
+                            colour
+                        );
+                        push_triangle(
+                            previous,
+                            Vector2Subtract(previous, *joint),
+                            Vector2Subtract(previous, normal),
+                            colour
+                        );
+                    }
+
+                    push_segment(previous, current, thickness, colour);
+
+                    joint = normal;
+                    previous = current;
+                });
+            },
+        },
+        draw
+    );
+
+    if (m_vertices.size() == begin) {
+        return;
+    }
+
+    // extend the previous run if possible to keep the
+    // number of runs (and hence draw calls) down
+    if (!m_runs.empty() && std::holds_alternative<GeometryRun>(m_runs.back())) {
+        std::get<GeometryRun>(m_runs.back()).end = m_vertices.size();
+
+        return;
+    }
+
+    m_runs.emplace_back(GeometryRun { begin, m_vertices.size() });
+}
+
+void SceneBatch::submit() const
+{
+    for (auto& run : m_runs) {
+        std::visit(
+            overload {
+                [](const TextDraw& arg) {
+                    DrawText(
+                        arg.string.c_str(),
+                        arg.x,
+                        arg.y,
+                        TEXT_FONT_SIZE,
+                        to_raylib_colour(arg.colour)
+                    );
+                },
+                [this](const GeometryRun& arg) {
+                    for (size_t chunk = arg.begin; chunk < arg.end;
+                         chunk += MAX_VERTICES_PER_SUBMIT) {
+                        size_t chunk_end = std::min(
+                            chunk + MAX_VERTICES_PER_SUBMIT,
+                            arg.end
+                        );
+
+                        rlCheckRenderBatchLimit(
+                            static_cast<int>(chunk_end - chunk)
+                        );
+
+                        rlBegin(RL_TRIANGLES);
+
+                        for (size_t i = chunk; i < chunk_end; i++) {
+                            const Vertex& vertex = m_vertices[i];
+
+                            rlColor4ub(
+                                vertex.colour.r,
+                                vertex.colour.g,
+                                vertex.colour.b,
+                                vertex.colour.a
+                            );
+                            rlVertex2f(vertex.x, vertex.y);
+                        }
+
+                        rlEnd();
+                    }
+                },
+            },
+            run
+        );
+    }
+}
+
+size_t SceneBatch::vertex_count() const
+{
+    return m_vertices.size();
+}
+
+} // namespace client
@@ -0,0 +1,62 @@
+#pragma once
+
+// raylib
+#include <raylib.h>
+
+// common
+#include "../common/types.hpp"
+
+// std
+#include <variant>
+#include <vector>
+
+namespace client {
+
+// A SceneBatch is the retained form of the scene. Instead
+// of issuing one immediate-mode raylib call per shape on
+// every frame, the draws are tessellated into triangles
+// once (whenever the canvas or the camera changes) and the
+// resulting vertices are submitted to rlgl in bulk. Text
+// cannot be tessellated so it is kept as is. To preserve
+// the order in which draws are stacked, the batch is made
+// up of runs, a run being either a contiguous range of
+// vertices or a single piece of text.
+
+struct Vertex {
+    float x { 0 };
+    float y { 0 };
+    Color colour {};
+};
+
+struct GeometryRun {
+    size_t begin { 0 };
+    size_t end { 0 };
+};
+
+using BatchRun = std::variant<GeometryRun, TextDraw>;
+
+class SceneBatch {
+   public:
+    void clear();
+
+    // NOTE: the zoom is used to pick the level of detail
+    // with which circles are tessellated
+    void add(const Draw& draw, float zoom);
+
+    void submit() const;
+
+    [[nodiscard]] size_t vertex_count() const;
+
+   private:
+    void push_triangle(Vector2 a, Vector2 b, Vector2 c, Color colour);
+
+    // a quad along the segment (nothing for a segment of length
+    // zero)
+    void push_segment(Vector2 start, Vector2 end, float thickness, Color colour);
+
+    std::vector<Vertex> m_vertices {};
+
+    std::vector<BatchRun> m_runs {};
+};
+
+} // namespace client
@@ -0,0 +1,86 @@
+// client
+#include "bounds.hpp"
+
+// common
+#include "../common/overload.hpp"
+#include "../common/stroke.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <variant>
+
+namespace client {
+
+static Bounds from_corners(int x0, int y0, int x1, int y1, float padding)
+{
+    return { static_cast<float>(std::min(x0, x1)) - padding,
+             static_cast<float>(std::min(y0, y1)) - padding,
+             static_cast<float>(std::max(x0, x1)) + padding,
+             static_cast<float>(std::max(y0, y1)) + padding };
+}
+
+Bounds bounds_of(const Draw& draw)
+{
+    return std::visit(
+        overload {
+            [](const TextDraw& arg) -> Bounds {
+                // NOTE: measuring the text properly requires the
+                // font to be loaded (and is quite slow), so we
+                // over-approximate by assuming that no glyph of the
+                // default font is wider than the font size.
+                auto width = static_cast<float>(
+                    arg.string.size() * static_cast<size_t>(TEXT_FONT_SIZE)
+                );
+
+                return { static_cast<float>(arg.x),
+                         static_cast<float>(arg.y),
+                         static_cast<float>(arg.x) + width,
+                         static_cast<float>(arg.y + TEXT_FONT_SIZE) };
+            },
+            [](const CircleDraw& arg) -> Bounds {
+                float r = std::abs(arg.r);
+
+                return { static_cast<float>(arg.x) - r,
+                         static_cast<float>(arg.y) - r,
+                         static_cast<float>(arg.x) + r,
+                         static_cast<float>(arg.y) + r };
+            },
+            [](const RectangleDraw& arg) -> Bounds {
+                return from_corners(arg.x0, arg.y0, arg.x1, arg.y1, 0);
+            },
+            [](const LineDraw& arg) -> Bounds {
+                return from_corners(
+                    arg.x0,
+                    arg.y0,
+                    arg.x1,
+                    arg.y1,
+                    LINE_THICKNESS
+                );
+            },
+            [](const StrokeDraw& arg) -> Bounds {
+                Bounds bounds { static_cast<float>(arg.x),
+                                static_cast<float>(arg.y),
+                                static_cast<float>(arg.x),
+                                static_cast<float>(arg.y) };
+
+                stroke::for_each_point(arg, [&bounds](int x, int y) {
+                    bounds.x0 = std::min(bounds.x0, static_cast<float>(x));
+                    bounds.y0 = std::min(bounds.y0, static_cast<float>(y));
+                    bounds.x1 = std::max(bounds.x1, static_cast<float>(x));
+                    bounds.y1 = std::max(bounds.y1, static_cast<float>(y));
+                });
+
+                float padding = stroke_thickness(arg);
+
+                return { bounds.x0 - padding,
+                         bounds.y0 - padding,
+                         bounds.x1 + padding,
+                         bounds.y1 + padding };
+            },
+        },
+        draw
+    );
+}
+
+} // namespace client
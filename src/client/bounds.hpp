@@ -0,0 +1,51 @@
+#pragma once
+
+// common
+#include "../common/types.hpp"
+
+// std
+#include <algorithm>
+
+namespace client {
+
+// These are the sizes the GUI uses when rendering
+// lines and text. They live here since the bounding
+// box of a draw depends on them.
+
+constexpr int TEXT_FONT_SIZE { 20 };
+
+constexpr float LINE_THICKNESS { 1.2f };
+
+// NOTE: a stroke of width one (or zero) is as thick as a line
+[[nodiscard]] inline float stroke_thickness(const StrokeDraw& draw)
+{
+    return LINE_THICKNESS * static_cast<float>(std::max<int>(draw.width, 1));
+}
+
+// An axis aligned bounding box in world space. It is
+// used to figure out whether a draw can possibly
+// appear within the region of the canvas the camera
+// is currently looking at.
+
+struct Bounds {
+    float x0 { 0 };
+    float y0 { 0 };
+    float x1 { 0 };
+    float y1 { 0 };
+
+    [[nodiscard]] bool overlaps(const Bounds& other) const
+    {
+        return x0 <= other.x1 && other.x0 <= x1 && y0 <= other.y1
+               && other.y0 <= y1;
+    }
+
+    [[nodiscard]] bool contains(const Bounds& other) const
+    {
+        return x0 <= other.x0 && other.x1 <= x1 && y0 <= other.y0
+               && other.y1 <= y1;
+    }
+};
+
+[[nodiscard]] Bounds bounds_of(const Draw& draw);
+
+} // namespace client
@@ -0,0 +1,529 @@
+// client
+#include "canvas.hpp"
+
+// std
+#include <algorithm>
+#include <variant>
+
+namespace client {
+
+// a private copy of the draws (and offsets) the span sees
+static std::shared_ptr<CanvasSnapshot::Chunk>
+copy_of(const CanvasSnapshot::Span& span)
+{
+    auto mine = span.chunk->mine.begin();
+
+    return std::make_shared<CanvasSnapshot::Chunk>(CanvasSnapshot::Chunk {
+        TaggedDrawVector(span.begin(), span.end()),
+        std::vector<size_t>(mine, mine + static_cast<long>(span.mine)),
+        span.size,
+        span.mine });
+}
+
+TaggedDrawVector::const_iterator CanvasSnapshot::Span::begin() const
+{
+    return chunk->draws.begin();
+}
+
+TaggedDrawVector::const_iterator CanvasSnapshot::Span::end() const
+{
+    return chunk->draws.begin() + static_cast<long>(size);
+}
+
+CanvasSnapshot::const_iterator::const_iterator(
+    const CanvasSnapshot* snapshot,
+    size_t chunk,
+    size_t offset
+)
+    : m_snapshot(snapshot)
+    , m_chunk(chunk)
+    , m_offset(offset)
+{
+}
+
+CanvasSnapshot::const_iterator::reference
+CanvasSnapshot::const_iterator::operator*() const
+{
+    return m_snapshot->span(m_chunk).chunk->draws[m_offset];
+}
+
+CanvasSnapshot::const_iterator::pointer
+CanvasSnapshot::const_iterator::operator->() const
+{
+    return &**this;
+}
+
+CanvasSnapshot::const_iterator& CanvasSnapshot::const_iterator::operator++()
+{
+    m_offset++;
+
+    if (m_offset == m_snapshot->span(m_chunk).size) {
+        m_chunk++;
+        m_offset = 0;
+    }
+
+    return *this;
+}
+
+bool CanvasSnapshot::const_iterator::operator==(const const_iterator& other
+) const
+{
+    return m_chunk == other.m_chunk && m_offset == other.m_offset;
+}
+
+bool CanvasSnapshot::const_iterator::operator!=(const const_iterator& other
+) const
+{
+    return !(*this == other);
+}
+
+CanvasSnapshot::CanvasSnapshot(UserId owner)
+    : m_owner(owner)
+{
+}
+
+CanvasSnapshot::CanvasSnapshot(UserId owner, const TaggedDrawVector& draws)
+    : m_size(draws.size())
+    , m_owner(owner)
+{
+    std::vector<Span> chunks {};
+
+    chunks.reserve(draws.size() / CANVAS_CHUNK_SIZE + 1);
+
+    for (size_t begin = 0; begin < draws.size(); begin += CANVAS_CHUNK_SIZE) {
+        size_t end = std::min(begin + CANVAS_CHUNK_SIZE, draws.size());
+
+        chunks.push_back(make_span(TaggedDrawVector(
+            draws.begin() + static_cast<long>(begin),
+            draws.begin() + static_cast<long>(end)
+        )));
+    }
+
+    assign(std::move(chunks));
+}
+
+CanvasSnapshot::CanvasSnapshot(UserId owner, TaggedDrawVector&& draws)
+    : m_size(draws.size())
+    , m_owner(owner)
+{
+    std::vector<Span> chunks {};
+
+    chunks.reserve(draws.size() / CANVAS_CHUNK_SIZE + 1);
+
+    for (size_t begin = 0; begin < draws.size(); begin += CANVAS_CHUNK_SIZE) {
+        size_t end = std::min(begin + CANVAS_CHUNK_SIZE, draws.size());
+
+        chunks.push_back(make_span(TaggedDrawVector(
+            std::make_move_iterator(draws.begin() + static_cast<long>(begin)),
+            std::make_move_iterator(draws.begin() + static_cast<long>(end))
+        )));
+    }
+
+    // the draws are all moved out by now
+    draws = {};
+
+    assign(std::move(chunks));
+}
+
+size_t CanvasSnapshot::size() const
+{
+    return m_size;
+}
+
+bool CanvasSnapshot::empty() const
+{
+    return m_size == 0;
+}
+
+const TaggedDraw& CanvasSnapshot::at(size_t index) const
+{
+    auto [chunk, offset] = locate(index);
+
+    return span(chunk).chunk->draws[offset];
+}
+
+std::optional<size_t>
+CanvasSnapshot::last_index_of(UserId user) const
+{
+    size_t end = m_size;
+
+    for (size_t chunk = chunk_count(); chunk > 0; chunk--) {
+        const Span& current = span(chunk - 1);
+
+        size_t begin = end - current.size;
+
+        for (size_t offset = current.size; offset > 0; offset--) {
+            if (current.chunk->draws[offset - 1].user == user) {
+                return begin + offset - 1;
+            }
+        }
+
+        end = begin;
+    }
+
+    return std::nullopt;
+}
+
+CanvasSnapshot::const_iterator CanvasSnapshot::begin() const
+{
+    return { this, 0, 0 };
+}
+
+CanvasSnapshot::const_iterator CanvasSnapshot::end() const
+{
+    return { this, chunk_count(), 0 };
+}
+
+void CanvasSnapshot::update(const TaggedAction& tagged_action)
+{
+    UserId user = tagged_action.user;
+
+    std::visit(
+        [this, user](const auto& arg) {
+            handle(user, arg);
+        },
+        tagged_action.action
+    );
+}
+
+void CanvasSnapshot::adopt(const Adopt& adopt)
+{
+    std::vector<Span> chunks {};
+
+    chunks.reserve(chunk_count());
+
+    for (size_t chunk = 0; chunk < chunk_count(); chunk++) {
+        Span current = span(chunk);
+
+        bool is_affected = std::any_of(
+            current.begin(),
+            current.end(),
+            [&adopt](const TaggedDraw& tagged_draw) {
+                return tagged_draw.user == adopt.user
+                       && !tagged_draw.adopted;
+            }
+        );
+
+        if (is_affected) {
+            current.chunk = copy_of(current);
+
+            for (auto& tagged_draw : current.chunk->draws) {
+                if (tagged_draw.user == adopt.user) {
+                    tagged_draw.adopted = true;
+                }
+            }
+
+            // NOTE: any chunk with draws of the owner which have
+            // not been adopted yet is affected
+            if (adopt.user == m_owner) {
+                current.chunk->mine.clear();
+                current.chunk->mine_used = 0;
+
+                current.mine = 0;
+            }
+        }
+
+        chunks.push_back(std::move(current));
+    }
+
+    assign(std::move(chunks));
+}
+
+size_t CanvasSnapshot::chunk_count() const
+{
+    return m_chunks->size() + (m_tail.size > 0 ? 1 : 0);
+}
+
+const CanvasSnapshot::Span& CanvasSnapshot::span(size_t chunk) const
+{
+    return chunk < m_chunks->size() ? (*m_chunks)[chunk] : m_tail;
+}
+
+std::pair<size_t, size_t> CanvasSnapshot::locate(size_t index) const
+{
+    // NOTE: a linear scan over the chunks is good enough
+    // since there are only a few thousand of them even for
+    // very large canvases
+    size_t chunk = 0;
+
+    while (index >= span(chunk).size) {
+        index -= span(chunk).size;
+
+        chunk++;
+    }
+
+    return { chunk, index };
+}
+
+CanvasSnapshot::Span& CanvasSnapshot::writable_span(size_t chunk)
+{
+    if (chunk == m_chunks->size()) {
+        return m_tail;
+    }
+
+    auto copy = std::make_shared<std::vector<Span>>(*m_chunks);
+
+    Span& ref = (*copy)[chunk];
+
+    m_chunks = std::move(copy);
+
+    return ref;
+}
+
+void CanvasSnapshot::assign(std::vector<Span>&& chunks)
+{
+    m_tail = {};
+
+    if (!chunks.empty()) {
+        m_tail = std::move(chunks.back());
+
+        chunks.pop_back();
+    }
+
+    m_chunks = std::make_shared<const std::vector<Span>>(std::move(chunks));
+}
+
+CanvasSnapshot::Span CanvasSnapshot::make_span(TaggedDrawVector&& draws
+) const
+{
+    std::vector<size_t> mine {};
+
+    for (size_t offset = 0; offset < draws.size(); offset++) {
+        if (draws[offset].user == m_owner && !draws[offset].adopted) {
+            mine.push_back(offset);
+        }
+    }
+
+    size_t size = draws.size();
+    size_t mine_size = mine.size();
+
+    return { std::make_shared<Chunk>(
+                 Chunk { std::move(draws), std::move(mine), size, mine_size }
+             ),
+             size,
+             mine_size };
+}
+
+void CanvasSnapshot::erase(size_t index)
+{
+    auto [chunk, offset] = locate(index);
+
+    if (span(chunk).size == 1 && chunk == m_chunks->size()) {
+        m_tail = {};
+    } else if (span(chunk).size == 1) {
+        auto chunks = std::make_shared<std::vector<Span>>(*m_chunks);
+
+        chunks->erase(chunks->begin() + static_cast<long>(chunk));
+
+        m_chunks = std::move(chunks);
+    } else {
+        Span& current = writable_span(chunk);
+
+        // NOTE: the last draw (usually the one being undone) is
+        // simply left out of the span, without copying the chunk
+        if (offset + 1 == current.size) {
+            if (current.mine > 0
+                && current.chunk->mine[current.mine - 1] == offset) {
+                current.mine--;
+            }
+
+            current.size--;
+        } else {
+            current.chunk = copy_of(current);
+
+            Chunk& draws = *current.chunk;
+
+            draws.draws.erase(draws.draws.begin() + static_cast<long>(offset));
+
+            auto iter = std::lower_bound(
+                draws.mine.begin(),
+                draws.mine.end(),
+                offset
+            );
+
+            if (iter != draws.mine.end() && *iter == offset) {
+                iter = draws.mine.erase(iter);
+            }
+
+            // the draws after the erased one all move down by one
+            for (; iter != draws.mine.end(); iter++) {
+                (*iter)--;
+            }
+
+            current.size = draws.used = draws.draws.size();
+            current.mine = draws.mine_used = draws.mine.size();
+        }
+    }
+
+    m_size--;
+}
+
+void CanvasSnapshot::handle(UserId user, const Draw& arg)
+{
+    // a full tail joins the other chunks
+    if (m_tail.size >= CANVAS_CHUNK_SIZE) {
+        auto chunks = std::make_shared<std::vector<Span>>(*m_chunks);
+
+        chunks->push_back(std::move(m_tail));
+
+        m_chunks = std::move(chunks);
+
+        m_tail = {};
+    }
+
+    // NOTE: when another snapshot sees more draws of the tail
+    // than this one (or there is no room left) the tail is
+    // copied into a new chunk with room for a whole chunk, the
+    // draws after that are appended to it in place
+    if (!m_tail.chunk || m_tail.size != m_tail.chunk->used
+        || m_tail.mine != m_tail.chunk->mine_used
+        || m_tail.size == m_tail.chunk->draws.size()) {
+        auto chunk = std::make_shared<Chunk>(Chunk {
+            TaggedDrawVector(CANVAS_CHUNK_SIZE),
+            std::vector<size_t>(CANVAS_CHUNK_SIZE),
+            m_tail.size,
+            m_tail.mine });
+
+        if (m_tail.chunk) {
+            std::copy(m_tail.begin(), m_tail.end(), chunk->draws.begin());
+
+            std::copy_n(
+                m_tail.chunk->mine.begin(),
+                m_tail.mine,
+                chunk->mine.begin()
+            );
+        }
+
+        m_tail.chunk = std::move(chunk);
+    }
+
+    // none of the snapshots sees the draw being written to
+    m_tail.chunk->draws[m_tail.size] = TaggedDraw { false, user, arg };
+
+    if (user == m_owner) {
+        m_tail.chunk->mine[m_tail.mine] = m_tail.size;
+
+        m_tail.mine++;
+
+        m_tail.chunk->mine_used = m_tail.mine;
+    }
+
+    m_tail.size++;
+
+    m_tail.chunk->used = m_tail.size;
+
+    m_size++;
+}
+
+void CanvasSnapshot::handle(UserId user, const Select& arg)
+{
+    // NOTE: the server crashes on an invalid id so this should
+    // never happen, but it is better to be safe
+    if (arg.id < 0 || static_cast<size_t>(arg.id) >= m_size)
+        return;
+
+    auto index = static_cast<size_t>(arg.id);
+
+    auto [chunk, offset] = locate(index);
+
+    Span& current = writable_span(chunk);
+
+    current.chunk = copy_of(current);
+
+    Chunk& draws = *current.chunk;
+
+    draws.draws[offset] = { false, user, arg.draw };
+
+    // the draw might have changed hands (and it is no longer
+    // adopted)
+    auto iter = std::lower_bound(draws.mine.begin(), draws.mine.end(), offset);
+
+    bool was_mine = iter != draws.mine.end() && *iter == offset;
+
+    if (user == m_owner && !was_mine) {
+        draws.mine.insert(iter, offset);
+    }
+
+    if (user != m_owner && was_mine) {
+        draws.mine.erase(iter);
+    }
+
+    current.mine = draws.mine_used = draws.mine.size();
+}
+
+void CanvasSnapshot::handle(UserId, const Delete& arg)
+{
+    if (m_size == 0)
+        return;
+
+    long id = std::clamp(arg.id, 0l, static_cast<long>(m_size - 1));
+
+    erase(static_cast<size_t>(id));
+}
+
+void CanvasSnapshot::handle(UserId user, const Undo&)
+{
+    std::optional<size_t> index = last_index_of(user);
+
+    if (index.has_value())
+        erase(*index);
+}
+
+void CanvasSnapshot::handle(UserId user, const Clear& arg)
+{
+    switch (arg.qualifier) {
+    case Qualifier::ALL:
+        assign({});
+
+        m_size = 0;
+
+        break;
+    case Qualifier::MINE:
+        std::vector<Span> filtered_chunks {};
+
+        filtered_chunks.reserve(chunk_count());
+
+        m_size = 0;
+
+        for (size_t chunk = 0; chunk < chunk_count(); chunk++) {
+            const Span& current = span(chunk);
+
+            bool is_affected = std::any_of(
+                current.begin(),
+                current.end(),
+                [user](const TaggedDraw& tagged_draw) {
+                    return tagged_draw.user == user;
+                }
+            );
+
+            // untouched chunks are shared as is
+            if (!is_affected) {
+                filtered_chunks.push_back(current);
+
+                m_size += current.size;
+
+                continue;
+            }
+
+            TaggedDrawVector filtered_chunk {};
+
+            for (auto& tagged_draw : current) {
+                if (tagged_draw.user != user) {
+                    filtered_chunk.push_back(tagged_draw);
+                }
+            }
+
+            if (!filtered_chunk.empty()) {
+                m_size += filtered_chunk.size();
+
+                filtered_chunks.push_back(make_span(std::move(filtered_chunk)));
+            }
+        }
+
+        assign(std::move(filtered_chunks));
+
+        break;
+    }
+}
+
+} // namespace client
@@ -0,0 +1,195 @@
+#pragma once
+
+// common
+#include "../common/types.hpp"
+
+// std
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// The maximum number of draws which are stored within a
+// single chunk of a snapshot
+#define CANVAS_CHUNK_SIZE (512)
+
+namespace client {
+
+// A CanvasSnapshot is an immutable (once published) view of
+// the canvas. The reader never modifies a published snapshot,
+// instead it makes a copy, applies the update to the copy
+// and then atomically swaps the shared pointer the GUI and
+// the input handler read from (RCU style). Readers never
+// block and always see a consistent canvas.
+//
+// To keep the copies cheap the draws are split up into
+// chunks which are shared between snapshots, an update only
+// copies the chunks it actually touches. New draws are
+// appended to the last chunk (the tail) in place, so a draw
+// costs a single copy of the draw rather than one of the
+// whole tail. The semantics of the updates are the same as
+// those of TaggedDrawVectorWrapper.
+//
+// A snapshot also keeps track of which draws belong to its
+// owner (the local user) and have not been adopted, that
+// way showing or listing only the user's own draws does not
+// require going over the whole canvas. Their offsets are
+// kept within the chunks, so they are shared (and appended
+// to) the same way the draws are.
+
+class CanvasSnapshot {
+   public:
+    // NOTE: a chunk which is shared between snapshots is only
+    // ever appended to (by the reader), a snapshot sees as
+    // many of its draws as the span it holds says
+    struct Chunk {
+        TaggedDrawVector draws {};
+
+        // the (sorted) offsets of the draws which belong to the
+        // owner and have not been adopted
+        std::vector<size_t> mine {};
+
+        // the number of draws (and offsets) used by any
+        // snapshot, only a snapshot which sees all of them can
+        // append in place
+        size_t used { 0 };
+        size_t mine_used { 0 };
+    };
+
+    // the first size draws (and the first mine offsets) of a
+    // chunk
+    struct Span {
+        std::shared_ptr<Chunk> chunk {};
+
+        size_t size { 0 };
+        size_t mine { 0 };
+
+        [[nodiscard]] TaggedDrawVector::const_iterator begin() const;
+
+        [[nodiscard]] TaggedDrawVector::const_iterator end() const;
+    };
+
+    class const_iterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TaggedDraw;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TaggedDraw*;
+        using reference = const TaggedDraw&;
+
+        const_iterator(
+            const CanvasSnapshot* snapshot,
+            size_t chunk,
+            size_t offset
+        );
+
+        reference operator*() const;
+
+        pointer operator->() const;
+
+        const_iterator& operator++();
+
+        bool operator==(const const_iterator& other) const;
+
+        bool operator!=(const const_iterator& other) const;
+
+       private:
+        const CanvasSnapshot* m_snapshot;
+        size_t m_chunk;
+        size_t m_offset;
+    };
+
+    CanvasSnapshot() = default;
+
+    explicit CanvasSnapshot(UserId owner);
+
+    CanvasSnapshot(UserId owner, const TaggedDrawVector& draws);
+
+    // NOTE: moves the draws into the chunks, so a large canvas
+    // (like the one a user joins with) is not held twice
+    CanvasSnapshot(UserId owner, TaggedDrawVector&& draws);
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] bool empty() const;
+
+    // NOTE: the index has to be smaller than the size
+    [[nodiscard]] const TaggedDraw& at(size_t index) const;
+
+    // the index of the last draw issued by the given user
+    [[nodiscard]] std::optional<size_t>
+    last_index_of(UserId user) const;
+
+    // calls func(index, tagged_draw) for each of the draws
+    // which belong to the owner and have not been adopted
+    template <typename Func> void for_each_mine(Func func) const
+    {
+        size_t chunk_begin = 0;
+
+        for (size_t chunk = 0; chunk < chunk_count(); chunk++) {
+            const Span& current = span(chunk);
+
+            for (size_t mine = 0; mine < current.mine; mine++) {
+                size_t offset = current.chunk->mine[mine];
+
+                func(chunk_begin + offset, current.chunk->draws[offset]);
+            }
+
+            chunk_begin += current.size;
+        }
+    }
+
+    [[nodiscard]] const_iterator begin() const;
+
+    [[nodiscard]] const_iterator end() const;
+
+    void update(const TaggedAction& tagged_action);
+
+    void adopt(const Adopt& adopt);
+
+   private:
+    // the number of chunks, including the tail
+    [[nodiscard]] size_t chunk_count() const;
+
+    [[nodiscard]] const Span& span(size_t chunk) const;
+
+    // returns the chunk and the offset within the chunk
+    [[nodiscard]] std::pair<size_t, size_t> locate(size_t index) const;
+
+    // same as span but the span can be modified without
+    // affecting any other snapshot (the chunk is still shared,
+    // it has to be replaced with a copy before modifying it)
+    [[nodiscard]] Span& writable_span(size_t chunk);
+
+    // the last of the chunks becomes the tail
+    void assign(std::vector<Span>&& chunks);
+
+    // a new chunk with the given draws
+    [[nodiscard]] Span make_span(TaggedDrawVector&& draws) const;
+
+    void erase(size_t index);
+
+    void handle(UserId user, const Draw& arg);
+    void handle(UserId user, const Select& arg);
+    void handle(UserId user, const Delete& arg);
+    void handle(UserId user, const Undo& arg);
+    void handle(UserId user, const Clear& arg);
+
+    // all the chunks but the tail, they are shared as a whole
+    // so appending to the tail does not copy them
+    //
+    // NOTE: a chunk is never empty, only the tail can be
+    // (with no chunk at all)
+    std::shared_ptr<const std::vector<Span>> m_chunks {
+        std::make_shared<const std::vector<Span>>()
+    };
+
+    Span m_tail {};
+
+    size_t m_size { 0 };
+
+    UserId m_owner { 0 };
+};
+
+} // namespace client
@@ -3,7 +3,6 @@
 #include "share.hpp"
 
 // common
-#include "../common/overload.hpp"
 #include "../common/threading.hpp"
 #include "../common/types.hpp"
 
@@ -12,14 +11,35 @@
 #include <raylib.h>
 #include <raymath.h>
 
+// cstd
+#include <ctime>
+
+// std
+#include <memory>
+
 // spdlog
 #include <spdlog/spdlog.h>
 
 namespace client {
 
-[[nodiscard]] Color to_raylib_colour(Colour colour)
+// Calls func with the current snapshot of the canvas.
+//
+// NOTE: holding on to the snapshot keeps it alive even if
+// the reader publishes a newer one in the meantime, please
+// look at the note in client/canvas.hpp.
+template <typename Func> static void with_canvas(Func func)
+{
+    std::shared_ptr<const CanvasSnapshot> canvas
+        = std::atomic_load(&share::canvas);
+
+    func(*canvas);
+}
+
+[[nodiscard]] static bool is_same_camera(const Camera2D& a, const Camera2D& b)
 {
-    return { colour.r, colour.g, colour.b, 255 };
+    return a.offset.x == b.offset.x && a.offset.y == b.offset.y
+           && a.target.x == b.target.x && a.target.y == b.target.y
+           && a.rotation == b.rotation && a.zoom == b.zoom;
 }
 
 void Gui::operator()()
@@ -79,110 +99,189 @@ void Gui::operator()()
                 GetScreenWidth(),
                 GetScreenHeight()
             );
+
+            m_needs_redraw = true;
+        }
+
+        // the status bar shows the position of
+        // the mouse so it has to be kept up to date
+        Vector2 mouse_delta = GetMouseDelta();
+
+        if (mouse_delta.x != 0 || mouse_delta.y != 0) {
+            m_needs_redraw = true;
+        }
+
+        // NOTE: the camera can also change without the mouse
+        // moving (e.g. when it is reset)
+        if (!is_same_camera(m_camera, m_drawn_camera)) {
+            m_needs_redraw = true;
+        }
+
+        update_view();
+
+        consume_dirty_regions();
+
+        m_use_tiles
+            = TileCache::is_usable(m_camera.zoom) && !share::show_mine;
+
+        if (m_use_tiles) {
+            update_tiles();
+        } else if (is_batch_stale()) {
+            rebuild_batch();
+
+            m_needs_redraw = true;
         }
 
-        draw();
+        // NOTE: even if nothing changed we still redraw every
+        // so often since some window managers do not preserve
+        // the contents of a window which was covered up
+        if (m_needs_redraw || GetTime() - m_last_redraw > KEEP_ALIVE_SECS) {
+            draw();
+
+            m_needs_redraw = false;
+
+            m_drawn_camera = m_camera;
+
+            m_last_redraw = GetTime();
+        } else {
+            idle();
+        }
     }
 
+    // the textures have to be unloaded whilst the OpenGL
+    // context is still around
+    m_tiles.clear();
+
     CloseWindow(); // Close window and OpenGL context
 }
 
-void Gui::process_draw(Draw& draw)
+void Gui::update_view()
 {
-    std::visit(
-        overload {
-            [](TextDraw& arg) {
-                DrawText(
-                    arg.string.c_str(),
-                    arg.x,
-                    arg.y,
-                    20, // NOTE: maybe change this?
-                    to_raylib_colour(arg.colour)
-                );
-            },
-            [](CircleDraw& arg) {
-                DrawCircle(arg.x, arg.y, arg.r, to_raylib_colour(arg.colour));
-            },
-            [](RectangleDraw& arg) {
-                DrawRectangle(
-                    arg.x0,
-                    arg.y0,
-                    arg.x1 - arg.x0,
-                    arg.y1 - arg.y0,
-                    to_raylib_colour(arg.colour)
-                );
-            },
-            [](LineDraw& arg) {
-                DrawLineEx(
-                    { static_cast<float>(arg.x0), static_cast<float>(arg.y0) },
-                    { static_cast<float>(arg.x1), static_cast<float>(arg.y1) },
-                    1.2f, // NOTE: maybe change this?
-                    to_raylib_colour(arg.colour)
-                );
-            },
-        },
-        draw
+    Vector2 top_left_world_pos = GetScreenToWorld2D({ 0, 0 }, m_camera);
+
+    Vector2 bottom_right_world_pos = GetScreenToWorld2D(
+        { static_cast<float>(GetScreenWidth()),
+          static_cast<float>(GetScreenHeight()) },
+        m_camera
     );
+
+    m_view = { top_left_world_pos.x,
+               top_left_world_pos.y,
+               bottom_right_world_pos.x,
+               bottom_right_world_pos.y };
 }
 
-inline void Gui::draw_scene()
+void Gui::consume_dirty_regions()
 {
-    // NOTE: please look at the separate note in
-    // client/share.hpp about double instance locking
-    // it is a technique which is a good middle ground
-    // between just a full mutex and a completely lock-free
-    // data structure (which is way harder in terms of code
-    // complexity).
-
-    for (;;) {
-        {
-            threading::unique_rwlock_rdguard guard {
-                share::rwlock1,
-                threading::unique_guard_policy::try_to_lock
-            };
-
-            if (guard.is_owning()) {
-                if (share::show_mine) {
-                    for (auto& tagged_draw : share::vec1) {
-                        if (tagged_draw.username == share::username
-                            && !tagged_draw.adopted)
-                            process_draw(tagged_draw.draw);
-                    }
-                } else {
-                    for (auto& tagged_draw : share::vec1) {
-                        process_draw(tagged_draw.draw);
-                    }
-                }
-
-                return;
-            }
+    threading::mutex_guard guard { share::dirty_regions_mutex };
+
+    if (share::is_everything_dirty) {
+        m_tiles.invalidate_all();
+    } else {
+        for (auto& region : share::dirty_regions) {
+            m_tiles.invalidate(region);
         }
+    }
 
-        {
-            threading::unique_rwlock_rdguard guard {
-                share::rwlock2,
-                threading::unique_guard_policy::try_to_lock
-            };
-
-            if (guard.is_owning()) {
-                if (share::show_mine) {
-                    for (auto& tagged_draw : share::vec2) {
-                        if (tagged_draw.username == share::username
-                            && !tagged_draw.adopted)
-                            process_draw(tagged_draw.draw);
-                    }
-                } else {
-                    for (auto& tagged_draw : share::vec2) {
-                        process_draw(tagged_draw.draw);
-                    }
-                }
-
-                return;
-            }
+    share::is_everything_dirty = false;
+
+    share::dirty_regions.clear();
+}
+
+void Gui::update_tiles()
+{
+    std::vector<TileKey> keys = m_tiles.stale_tiles(m_view, m_camera.zoom);
+
+    if (keys.empty()) {
+        return;
+    }
+
+    with_canvas([this, &keys](const CanvasSnapshot& draws) {
+        m_tiles.rasterize(keys, draws);
+    });
+
+    m_needs_redraw = true;
+}
+
+bool Gui::is_batch_stale() const
+{
+    return !m_has_batch || m_batch_version != share::canvas_version
+           || m_batch_show_mine != share::show_mine
+           || m_batch_zoom != m_camera.zoom
+           || !m_batch_region.contains(m_view);
+}
+
+bool Gui::is_visible(const TaggedDraw& tagged_draw) const
+{
+    return m_batch_region.overlaps(bounds_of(tagged_draw.draw));
+}
+
+void Gui::rebuild_batch()
+{
+    // NOTE: the version has to be read before we go through
+    // the canvas, if an update sneaks in whilst we are
+    // building the batch we will just rebuild it again on
+    // the next frame
+    m_batch_version = share::canvas_version;
+    m_batch_show_mine = share::show_mine;
+    m_batch_zoom = m_camera.zoom;
+
+    // the batch covers a bit more than what is visible so
+    // that small pans do not require a rebuild
+    float margin_x = (m_view.x1 - m_view.x0) / 2;
+    float margin_y = (m_view.y1 - m_view.y0) / 2;
+
+    m_batch_region = { m_view.x0 - margin_x,
+                       m_view.y0 - margin_y,
+                       m_view.x1 + margin_x,
+                       m_view.y1 + margin_y };
+
+    m_batch.clear();
+
+    with_canvas([this](const CanvasSnapshot& draws) { batch_draws(draws); }
+    );
+
+    m_has_batch = true;
+}
+
+void Gui::batch_draws(const CanvasSnapshot& draws)
+{
+    if (m_batch_show_mine) {
+        draws.for_each_mine([this](size_t, const TaggedDraw& tagged_draw) {
+            if (is_visible(tagged_draw))
+                m_batch.add(tagged_draw.draw, m_batch_zoom);
+        });
+    } else {
+        for (auto& tagged_draw : draws) {
+            if (is_visible(tagged_draw))
+                m_batch.add(tagged_draw.draw, m_batch_zoom);
         }
     }
 }
 
+void Gui::idle()
+{
+    // Nothing has changed, so instead of drawing a frame
+    // which is identical to the previous one we just process
+    // the pending input events and sleep for a frame.
+    PollInputEvents();
+
+    struct timespec spec { };
+
+    spec.tv_nsec = 1000000000l / m_target_fps;
+
+    nanosleep(&spec, nullptr);
+}
+
+inline void Gui::draw_scene()
+{
+    if (m_use_tiles) {
+        m_tiles.draw(m_view, m_camera.zoom);
+    } else {
+        m_batch.submit();
+    }
+}
+
 void Gui::draw()
 {
     BeginDrawing();
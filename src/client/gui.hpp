@@ -6,6 +6,19 @@
 // common
 #include "../common/types.hpp"
 
+// client
+#include "batch.hpp"
+#include "bounds.hpp"
+#include "canvas.hpp"
+#include "tiles.hpp"
+
+// cstd
+#include <cstdint>
+
+// Even when nothing changes on the canvas the scene is
+// still redrawn at least once every KEEP_ALIVE_SECS
+#define KEEP_ALIVE_SECS (1.0)
+
 namespace client {
 
 class Gui {
@@ -13,16 +26,52 @@ class Gui {
     void operator()();
 
    private:
-    void process_draw(Draw& draw);
+    void update_view();
+
+    void consume_dirty_regions();
+
+    void update_tiles();
+
+    [[nodiscard]] bool is_batch_stale() const;
+
+    [[nodiscard]] bool is_visible(const TaggedDraw& tagged_draw) const;
+
+    void rebuild_batch();
+
+    void batch_draws(const CanvasSnapshot& draws);
+
+    void idle();
 
     void draw_scene();
 
     void draw();
 
-    void game_loop();
-
     Camera2D m_camera { { 0, 0 }, { 0, 0 }, 0, 1.0 };
 
+    // the region of the canvas (in world space) which
+    // is currently visible on the screen
+    Bounds m_view {};
+
+    // retained scene along with the state it was built
+    // from, if any of it changes the batch is rebuilt
+    SceneBatch m_batch {};
+    bool m_has_batch { false };
+    std::uint64_t m_batch_version { 0 };
+    bool m_batch_show_mine { false };
+    float m_batch_zoom { 1.0 };
+    Bounds m_batch_region {};
+
+    // when zoomed out far enough the scene is composited
+    // from cached tiles instead of the batch
+    TileCache m_tiles {};
+    bool m_use_tiles { false };
+
+    // the camera the last frame was drawn with
+    Camera2D m_drawn_camera { { 0, 0 }, { 0, 0 }, 0, 1.0 };
+
+    bool m_needs_redraw { true };
+    double m_last_redraw { 0 };
+
     // defaults
     const std::string m_window_name { "NetSketch Whiteboard" };
     const int m_target_fps { 60 };
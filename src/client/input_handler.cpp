@@ -1,4 +1,5 @@
 // client
+#include "canvas.hpp"
 #include "input_handler.hpp"
 #include "input_parser.hpp"
 #include "share.hpp"
@@ -6,6 +7,7 @@
 // std
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -14,6 +16,7 @@
 // common
 #include "../common/abort.hpp"
 #include "../common/overload.hpp"
+#include "../common/stroke.hpp"
 #include "../common/threading.hpp"
 #include "../common/types.hpp"
 
@@ -49,37 +52,39 @@ void InputHandler::shutdown()
     share::run_gui = false;
 }
 
-static void print_draw(size_t index, Draw draw)
+static void print_draw(size_t index, const std::string& owner, Draw draw)
 {
     std::visit(
         overload {
-            [index](TextDraw& arg) {
+            [index, &owner](TextDraw& arg) {
                 fmt::println(
-                    "[{}] => [text] [{} {} {}] [{} {} \"{}\"]",
+                    "[{}] => [text] [{} {} {}] [{} {} \"{}\"] [by {}]",
                     index,
                     arg.colour.r,
                     arg.colour.g,
                     arg.colour.b,
                     arg.x,
                     arg.y,
-                    arg.string
+                    arg.string,
+                    owner
                 );
             },
-            [index](CircleDraw& arg) {
+            [index, &owner](CircleDraw& arg) {
                 fmt::println(
-                    "[{}] => [circle] [{} {} {}] [{} {} {}]",
+                    "[{}] => [circle] [{} {} {}] [{} {} {}] [by {}]",
                     index,
                     arg.colour.r,
                     arg.colour.g,
                     arg.colour.b,
                     arg.x,
                     arg.y,
-                    arg.r
+                    arg.r,
+                    owner
                 );
             },
-            [index](RectangleDraw& arg) {
+            [index, &owner](RectangleDraw& arg) {
                 fmt::println(
-                    "[{}] => [rectangle] [{} {} {}] [{} {} {} {}]",
+                    "[{}] => [rectangle] [{} {} {}] [{} {} {} {}] [by {}]",
                     index,
                     arg.colour.r,
                     arg.colour.g,
@@ -87,12 +92,13 @@ static void print_draw(size_t index, Draw draw)
                     arg.x0,
                     arg.y0,
                     arg.x1,
-                    arg.y1
+                    arg.y1,
+                    owner
                 );
             },
-            [index](LineDraw& arg) {
+            [index, &owner](LineDraw& arg) {
                 fmt::println(
-                    "[{}] => [line] [{} {} {}] [{} {} {} {}]",
+                    "[{}] => [line] [{} {} {}] [{} {} {} {}] [by {}]",
                     index,
                     arg.colour.r,
                     arg.colour.g,
@@ -100,7 +106,30 @@ static void print_draw(size_t index, Draw draw)
                     arg.x0,
                     arg.y0,
                     arg.x1,
-                    arg.y1
+                    arg.y1,
+                    owner
+                );
+            },
+            [index, &owner](StrokeDraw& arg) {
+                std::string points {};
+
+                stroke::for_each_point(arg, [&points](int x, int y) {
+                    if (!points.empty()) {
+                        points += ' ';
+                    }
+
+                    points += fmt::format("{} {}", x, y);
+                });
+
+                fmt::println(
+                    "[{}] => [stroke] [{} {} {}] [{}] [{}] [by {}]",
+                    index,
+                    arg.colour.r,
+                    arg.colour.g,
+                    arg.colour.b,
+                    arg.width,
+                    points,
+                    owner
                 );
             },
         },
@@ -108,79 +137,67 @@ static void print_draw(size_t index, Draw draw)
     );
 }
 
-static void
-list_draws(Option tool_type, Option user_qual, TaggedDrawVector& draw_vector)
+static bool is_of_type(Option tool_type, const Draw& draw)
 {
-    size_t index = 0;
-
-    for (auto& tagged_draw : draw_vector) {
-        switch (user_qual) {
-        case Option::ALL:
-            switch (tool_type) {
-            case Option::ALL:
-                print_draw(index, tagged_draw.draw);
-                break;
-            case Option::LINE:
-                if (std::holds_alternative<LineDraw>(tagged_draw.draw)) {
-                    print_draw(index, tagged_draw.draw);
-                }
-                break;
-            case Option::RECTANGLE:
-                if (std::holds_alternative<RectangleDraw>(tagged_draw.draw)) {
-                    print_draw(index, tagged_draw.draw);
-                }
-                break;
-            case Option::CIRCLE:
-                if (std::holds_alternative<CircleDraw>(tagged_draw.draw)) {
-                    print_draw(index, tagged_draw.draw);
-                }
-                break;
-            case Option::TEXT:
-                if (std::holds_alternative<TextDraw>(tagged_draw.draw)) {
-                    print_draw(index, tagged_draw.draw);
-                }
-                break;
-            default:
-                ABORT("unreachable");
-            }
-            break;
-        case Option::MINE:
-            if (share::username == tagged_draw.username && !tagged_draw.adopted) {
-                switch (tool_type) {
-                case Option::ALL:
-                    print_draw(index, tagged_draw.draw);
-                    break;
-                case Option::LINE:
-                    if (std::holds_alternative<LineDraw>(tagged_draw.draw)) {
-                        print_draw(index, tagged_draw.draw);
-                    }
-                    break;
-                case Option::RECTANGLE:
-                    if (std::holds_alternative<RectangleDraw>(tagged_draw.draw
-                        )) {
-                        print_draw(index, tagged_draw.draw);
-                    }
-                    break;
-                case Option::CIRCLE:
-                    if (std::holds_alternative<CircleDraw>(tagged_draw.draw)) {
-                        print_draw(index, tagged_draw.draw);
-                    }
-                    break;
-                case Option::TEXT:
-                    if (std::holds_alternative<TextDraw>(tagged_draw.draw)) {
-                        print_draw(index, tagged_draw.draw);
-                    }
-                    break;
-                default:
-                    ABORT("unreachable");
-                }
+    switch (tool_type) {
+    case Option::ALL:
+        return true;
+    case Option::LINE:
+        return std::holds_alternative<LineDraw>(draw);
+    case Option::RECTANGLE:
+        return std::holds_alternative<RectangleDraw>(draw);
+    case Option::CIRCLE:
+        return std::holds_alternative<CircleDraw>(draw);
+    case Option::TEXT:
+        return std::holds_alternative<TextDraw>(draw);
+    case Option::STROKE:
+        return std::holds_alternative<StrokeDraw>(draw);
+    default:
+        ABORT("unreachable");
+    }
+}
+
+static void list_draws(
+    Option tool_type,
+    Option user_qual,
+    const CanvasSnapshot& draw_vector
+)
+{
+    switch (user_qual) {
+    case Option::ALL: {
+        threading::mutex_guard guard { share::user_names_mutex };
+
+        size_t index = 0;
+
+        for (auto& tagged_draw : draw_vector) {
+            if (is_of_type(tool_type, tagged_draw.draw)) {
+                auto iter = share::user_names.find(tagged_draw.user);
+
+                print_draw(
+                    index,
+                    iter != share::user_names.end()
+                        ? iter->second
+                        : fmt::format("#{}", tagged_draw.user),
+                    tagged_draw.draw
+                );
             }
-            break;
-        default:
-            ABORT("unreachable");
-        }
 
-        index++;
+            index++;
+        }
+    } break;
+    case Option::MINE:
+        // NOTE: the snapshot already knows which of the draws
+        // are ours so there is no need to go over all of them
+        draw_vector.for_each_mine(
+            [tool_type](size_t index, const TaggedDraw& tagged_draw) {
+                if (is_of_type(tool_type, tagged_draw.draw)) {
+                    print_draw(index, share::username, tagged_draw.draw);
+                }
+            }
+        );
+        break;
+    default:
+        ABORT("unreachable");
     }
 }
 
@@ -223,8 +240,8 @@ void InputHandler::process_line(std::string_view line_view)
 
         fmt::println(
             " 1. help - list all available commands and their usage"
-            "\n 2. tool {{line | rectangle | circle | text}} - select a tool "
-            "for drawing"
+            "\n 2. tool {{line | rectangle | circle | text | stroke}} - select "
+            "a tool for drawing"
             "\n 3. colour {{RED}} {{GREEN}} {{BLUE}} - sets the drawing colour "
             "using RED, GREEN, BLUE values"
             "\n 4. draw {{...}}... - draw a shape according to the selected "
@@ -238,8 +255,11 @@ void InputHandler::process_line(std::string_view line_view)
             "a circle at (X, Y) with radius RADIUS"
             "\n    \twhen tool is 'text', draw {{X}} {{Y}} {{STRING}} - draw a "
             "string at (X, Y) with the characters in STRING"
-            "\n 5. list {{all | line | rectangle | circle | text}} {{all | "
-            "mine}} "
+            "\n    \twhen tool is 'stroke', draw {{WIDTH}} {{X0}} {{Y0}} "
+            "{{X1}} {{Y1}}... - draw a freehand stroke of width WIDTH "
+            "through the points (X0, Y0), (X1, Y1) and so on"
+            "\n 5. list {{all | line | rectangle | circle | text | stroke}} "
+            "{{all | mine}} "
             "- displays issued draw commands in, filtered by tool type and/or "
             "user"
             "\n 6. select {{none | ID}} - select an existing draw command "
@@ -295,9 +315,22 @@ void InputHandler::process_line(std::string_view line_view)
             return;
         }
 
+        if (second_token == "stroke") {
+            // NOTE: the server drops the strokes of a connection
+            // which did not settle on them
+            if ((share::capabilities & CAPABILITY_STROKES) == 0) {
+                fmt::println(stderr, "warn: the server does not take strokes");
+                return;
+            }
+
+            m_tool = Option::STROKE;
+            return;
+        }
+
         fmt::println(
             stderr,
-            "warn: expected one of {{'line' | 'rectangle' | 'circle' | 'text'}}"
+            "warn: expected one of {{'line' | 'rectangle' | 'circle' | 'text' "
+            "| 'stroke'}}"
         );
 
         return;
@@ -481,13 +514,7 @@ void InputHandler::process_line(std::string_view line_view)
                 action = Select { *m_selected_id, draw };
             }
 
-            {
-                threading::mutex_guard guard { share::writer_mutex };
-
-                share::writer_queue.push(action);
-            }
-
-            share::writer_cond.notify_one();
+            share::writer_queue.push(action);
         } break;
         case Option::RECTANGLE: {
             if (tokens.size() != 5) {
@@ -564,13 +591,7 @@ void InputHandler::process_line(std::string_view line_view)
                 action = Select { *m_selected_id, draw };
             }
 
-            {
-                threading::mutex_guard guard { share::writer_mutex };
-
-                share::writer_queue.push(action);
-            }
-
-            share::writer_cond.notify_one();
+            share::writer_queue.push(action);
         } break;
         case Option::CIRCLE: {
             if (tokens.size() != 4) {
@@ -642,13 +663,7 @@ void InputHandler::process_line(std::string_view line_view)
                 action = Select { *m_selected_id, draw };
             }
 
-            {
-                threading::mutex_guard guard { share::writer_mutex };
-
-                share::writer_queue.push(action);
-            }
-
-            share::writer_cond.notify_one();
+            share::writer_queue.push(action);
         } break;
         case Option::TEXT: {
             if (tokens.size() != 4) {
@@ -699,13 +714,95 @@ void InputHandler::process_line(std::string_view line_view)
                 action = Select { *m_selected_id, draw };
             }
 
-            {
-                threading::mutex_guard guard { share::writer_mutex };
+            share::writer_queue.push(action);
+        } break;
+        case Option::STROKE: {
+            if (tokens.size() < 4 || tokens.size() % 2 != 0) {
+                fmt::println(
+                    stderr,
+                    "warn: an unexpected number of tokens for draw with stroke "
+                    "selected"
+                );
+
+                return;
+            }
+
+            if ((tokens.size() - 2) / 2 > STROKE_MAX_POINTS) {
+                fmt::println(
+                    stderr,
+                    "warn: a stroke can have at most {} points",
+                    STROKE_MAX_POINTS
+                );
+
+                return;
+            }
+
+            int width {};
+
+            try {
+                width = std::stoi(tokens[1]);
+            } catch (std::invalid_argument&) {
+                width = 0;
+            } catch (std::out_of_range&) {
+                width = 0;
+            }
+
+            if (!(0 < width && width < 256)) {
+                fmt::println(
+                    stderr,
+                    "warn: expected an integer in the range 1-255 (inclusive) "
+                    "for WIDTH"
+                );
 
-                share::writer_queue.push(action);
+                return;
             }
 
-            share::writer_cond.notify_one();
+            std::vector<int> coords {};
+
+            coords.reserve(tokens.size() - 2);
+
+            for (size_t i = 2; i < tokens.size(); i++) {
+                try {
+                    coords.push_back(std::stoi(tokens[i]));
+                } catch (std::invalid_argument&) {
+                    fmt::println(
+                        stderr,
+                        "warn: expected integer (32-bit) for {}{}",
+                        i % 2 == 0 ? 'x' : 'y',
+                        (i - 2) / 2
+                    );
+
+                    return;
+                } catch (std::out_of_range&) {
+                    fmt::println(
+                        stderr,
+                        "warn: expected integer (32-bit) for {}{}",
+                        i % 2 == 0 ? 'x' : 'y',
+                        (i - 2) / 2
+                    );
+
+                    return;
+                }
+            }
+
+            stroke::Builder builder { m_colour,
+                                      static_cast<uint8_t>(width),
+                                      coords[0],
+                                      coords[1] };
+
+            for (size_t i = 2; i < coords.size(); i += 2) {
+                builder.add(coords[i], coords[i + 1]);
+            }
+
+            StrokeDraw draw = builder.build();
+
+            Action action { draw };
+
+            if (m_selected_id) {
+                action = Select { *m_selected_id, draw };
+            }
+
+            share::writer_queue.push(action);
         } break;
         default:
             ABORT("unreachable");
@@ -756,11 +853,16 @@ void InputHandler::process_line(std::string_view line_view)
             second_match = true;
         }
 
+        if (second_token == "stroke") {
+            tool_qual = Option::STROKE;
+            second_match = true;
+        }
+
         if (!second_match) {
             fmt::println(
                 stderr,
                 "warn: expected one of {{'all' | 'line' | 'rectangle' | "
-                "'circle' | 'text'}}"
+                "'circle' | 'text' | 'stroke'}}"
             );
 
             return;
@@ -788,33 +890,12 @@ void InputHandler::process_line(std::string_view line_view)
             return;
         }
 
-        for (;;) {
-            {
-                threading::unique_rwlock_rdguard guard {
-                    share::rwlock1,
-                    threading::unique_guard_policy::try_to_lock
-                };
-
-                if (guard.is_owning()) {
-                    list_draws(tool_qual, user_qual, share::vec1);
+        // NOTE: the snapshot stays valid for as long as we
+        // hold on to it, no matter what the reader does
+        std::shared_ptr<const CanvasSnapshot> canvas
+            = std::atomic_load(&share::canvas);
 
-                    return;
-                }
-            }
-
-            {
-                threading::unique_rwlock_rdguard guard {
-                    share::rwlock2,
-                    threading::unique_guard_policy::try_to_lock
-                };
-
-                if (guard.is_owning()) {
-                    list_draws(tool_qual, user_qual, share::vec2);
-
-                    return;
-                }
-            }
-        }
+        list_draws(tool_qual, user_qual, *canvas);
 
         return;
     }
@@ -897,13 +978,7 @@ void InputHandler::process_line(std::string_view line_view)
             return;
         }
 
-        {
-            threading::mutex_guard guard { share::writer_mutex };
-
-            share::writer_queue.emplace(Delete { id });
-        }
-
-        share::writer_cond.notify_one();
+        share::writer_queue.push(Delete { id });
 
         return;
     }
@@ -918,13 +993,7 @@ void InputHandler::process_line(std::string_view line_view)
             return;
         }
 
-        {
-            threading::mutex_guard guard { share::writer_mutex };
-
-            share::writer_queue.emplace(Undo {});
-        }
-
-        share::writer_cond.notify_one();
+        share::writer_queue.push(Undo {});
 
         return;
     }
@@ -942,25 +1011,13 @@ void InputHandler::process_line(std::string_view line_view)
         std::string_view second_token = tokens[1];
 
         if (second_token == "all") {
-            {
-                threading::mutex_guard guard { share::writer_mutex };
-
-                share::writer_queue.emplace(Clear { Qualifier::ALL });
-            }
-
-            share::writer_cond.notify_one();
+            share::writer_queue.push(Clear { Qualifier::ALL });
 
             return;
         }
 
         if (second_token == "mine") {
-            {
-                threading::mutex_guard guard { share::writer_mutex };
-
-                share::writer_queue.emplace(Clear { Qualifier::MINE });
-            }
-
-            share::writer_cond.notify_one();
+            share::writer_queue.push(Clear { Qualifier::MINE });
 
             return;
         }
@@ -16,7 +16,8 @@ enum class Option : uint8_t {
     LINE,
     RECTANGLE,
     CIRCLE,
-    TEXT
+    TEXT,
+    STROKE
 };
 
 class InputHandler {
@@ -1,16 +1,23 @@
 // client
+#include "bounds.hpp"
+#include "canvas.hpp"
 #include "reader.hpp"
 #include "share.hpp"
 
 // common
+#include "../common/overload.hpp"
 #include "../common/serial.hpp"
-#include "../common/tagged_draw_vector_wrapper.hpp"
 #include "../common/threading.hpp"
 
 // fmt
 #include <fmt/chrono.h>
 #include <fmt/core.h>
 
+// std
+#include <memory>
+#include <optional>
+#include <vector>
+
 // unix
 #include <netinet/in.h>
 #include <poll.h>
@@ -27,6 +34,96 @@
 
 namespace client {
 
+// Works out which regions of the canvas are going to be
+// touched by applying the given action, std::nullopt
+// meaning that the whole canvas might change. NOTE: this
+// has to be called before the action is applied since the
+// draws which are deleted or replaced are needed.
+static std::optional<std::vector<Bounds>>
+affected_regions(const CanvasSnapshot& draws, const TaggedAction& arg)
+{
+    return std::visit(
+        overload {
+            [](const Draw& action) -> std::optional<std::vector<Bounds>> {
+                return std::vector<Bounds> { bounds_of(action) };
+            },
+            [&draws](const Select& action
+            ) -> std::optional<std::vector<Bounds>> {
+                std::vector<Bounds> regions { bounds_of(action.draw) };
+
+                if (action.id >= 0
+                    && static_cast<size_t>(action.id) < draws.size()) {
+                    regions.push_back(
+                        bounds_of(draws.at(static_cast<size_t>(action.id)).draw)
+                    );
+                }
+
+                return regions;
+            },
+            [&draws](const Delete& action
+            ) -> std::optional<std::vector<Bounds>> {
+                if (draws.empty()) {
+                    return std::vector<Bounds> {};
+                }
+
+                // same clamping as in CanvasSnapshot
+                long id = std::clamp(
+                    action.id,
+                    0l,
+                    static_cast<long>(draws.size() - 1)
+                );
+
+                return std::vector<Bounds> {
+                    bounds_of(draws.at(static_cast<size_t>(id)).draw)
+                };
+            },
+            [&draws, &arg](const Undo&) -> std::optional<std::vector<Bounds>> {
+                std::optional<size_t> index = draws.last_index_of(arg.user);
+
+                if (!index.has_value()) {
+                    return std::vector<Bounds> {};
+                }
+
+                return std::vector<Bounds> { bounds_of(draws.at(*index).draw) };
+            },
+            [](const Clear&) -> std::optional<std::vector<Bounds>> {
+                return std::nullopt;
+            },
+        },
+        arg.action
+    );
+}
+
+static void publish(std::shared_ptr<const CanvasSnapshot> canvas)
+{
+    std::atomic_store(&share::canvas, std::move(canvas));
+
+    share::canvas_version++;
+}
+
+static void mark_dirty(const std::optional<std::vector<Bounds>>& regions)
+{
+    threading::mutex_guard guard { share::dirty_regions_mutex };
+
+    if (!regions.has_value()) {
+        share::is_everything_dirty = true;
+
+        share::dirty_regions.clear();
+
+        return;
+    }
+
+    if (share::is_everything_dirty) {
+        return;
+    }
+
+    share::dirty_regions.insert(
+        share::dirty_regions.end(),
+        regions->begin(),
+        regions->end()
+    );
+}
+
 Reader::Reader(const Channel& channel)
     : m_channel(channel)
 {
@@ -80,64 +177,88 @@ bool Reader::handle_payload(ByteString& bytes)
         return false;
     }
 
-    // NOTE: again please go look at client/share.hpp
-    // for a reason as to why we are updating two separate
-    // objects which contain the same things using a rwlock
+    // NOTE: the reader is the only one which ever publishes a
+    // new snapshot of the canvas, so there is no need for any
+    // locking here, please go look at client/canvas.hpp
     return std::visit(
         overload {
             [](Adopt& arg) {
-                threading::mutex_guard guard {
-                    share::tagged_draw_vector_mutex
-                };
+                auto canvas = std::make_shared<CanvasSnapshot>(
+                    *std::atomic_load(&share::canvas)
+                );
 
-                {
-                    threading::rwlock_wrguard wrguard { share::rwlock1 };
+                canvas->adopt(arg);
 
-                    TaggedDrawVectorWrapper { share::vec1 }.adopt(arg);
-                }
+                publish(std::move(canvas));
 
-                {
-                    threading::rwlock_wrguard wrguard { share::rwlock2 };
+                return true;
+            },
+            [](Snapshot& arg) {
+                publish(std::make_shared<CanvasSnapshot>(
+                    share::user,
+                    std::move(arg.draws)
+                ));
 
-                    TaggedDrawVectorWrapper { share::vec2 }.adopt(arg);
-                }
+                mark_dirty(std::nullopt);
 
                 return true;
             },
-            [](TaggedDrawVector& arg) {
-                threading::mutex_guard guard {
-                    share::tagged_draw_vector_mutex
-                };
+            [](TaggedAction& arg) {
+                auto canvas = std::make_shared<CanvasSnapshot>(
+                    *std::atomic_load(&share::canvas)
+                );
 
-                {
-                    threading::rwlock_wrguard wrguard { share::rwlock1 };
+                auto regions = affected_regions(*canvas, arg);
 
-                    share::vec1 = arg;
-                }
+                canvas->update(arg);
 
-                {
-                    threading::rwlock_wrguard wrguard { share::rwlock2 };
+                publish(std::move(canvas));
 
-                    share::vec2 = arg;
-                }
+                mark_dirty(regions);
 
                 return true;
             },
-            [](TaggedAction& arg) {
-                threading::mutex_guard guard {
-                    share::tagged_draw_vector_mutex
+            [](ActionBatch& arg) {
+                auto canvas = std::make_shared<CanvasSnapshot>(
+                    *std::atomic_load(&share::canvas)
+                );
+
+                std::optional<std::vector<Bounds>> regions {
+                    std::vector<Bounds> {}
                 };
 
-                {
-                    threading::rwlock_wrguard wrguard { share::rwlock1 };
+                // NOTE: the whole batch is published as a single
+                // snapshot, so the GUI never sees half a batch
+                for (size_t i = 0; i < arg.actions.size(); i++) {
+                    TaggedAction tagged_action = arg.at(i);
+
+                    auto affected = affected_regions(*canvas, tagged_action);
 
-                    TaggedDrawVectorWrapper { share::vec1 }.update(arg);
+                    if (!affected.has_value()) {
+                        regions = std::nullopt;
+                    } else if (regions.has_value()) {
+                        regions->insert(
+                            regions->end(),
+                            affected->begin(),
+                            affected->end()
+                        );
+                    }
+
+                    canvas->update(tagged_action);
                 }
 
-                {
-                    threading::rwlock_wrguard wrguard { share::rwlock2 };
+                publish(std::move(canvas));
+
+                mark_dirty(regions);
+
+                return true;
+            },
+            [](UserNames& arg) {
+                threading::mutex_guard guard { share::user_names_mutex };
 
-                    TaggedDrawVectorWrapper { share::vec2 }.update(arg);
+                for (auto& user_name : arg.names) {
+                    share::user_names[user_name.user]
+                        = std::move(user_name.username);
                 }
 
                 return true;
@@ -162,6 +162,16 @@ bool Runner::setup(
         return false;
     }
 
+    share::user = std::get<Accept>(payload).user;
+    share::capabilities = std::get<Accept>(payload).capabilities;
+
+    // the canvas keeps track of the draws which belong to
+    // the local user so it has to know who that is
+    std::atomic_store(
+        &share::canvas,
+        std::make_shared<const CanvasSnapshot>(share::user)
+    );
+
     fmt::println(
         "========================================================\n"
         "Connected to NetSketch server at {}:{}\n"
@@ -174,13 +184,13 @@ bool Runner::setup(
         username
     );
 
+    SETUP_BENCHMARKS;
+
     return true;
 }
 
 [[nodiscard]] bool Runner::run() const
 {
-    START_BENCHMARK_THREAD;
-
     share::reader_thread = threading::thread { Reader { m_channel } };
     share::writer_thread = threading::thread { Writer { m_channel } };
     share::input_thread = threading::thread { InputHandler {} };
@@ -205,7 +215,9 @@ Runner::~Runner()
     if (share::input_thread.is_initialized())
         share::input_thread.join();
 
-    END_BENCHMARK_THREAD;
+    REPORT_BENCHMARKS;
+
+    REPORT_LOCKS;
 }
 
 } // namespace client
@@ -9,25 +9,27 @@ threading::thread input_thread {};
 
 std::string username {};
 
-bool show_mine { false };
+UserId user { 0 };
 
-bool run_gui { true };
+Capabilities capabilities { 0 };
 
-threading::mutex writer_mutex {};
-threading::cond_var writer_cond {};
-std::queue<Action> writer_queue {};
+threading::mutex user_names_mutex { "user_names_mutex" };
+std::unordered_map<UserId, std::string> user_names {};
 
-// double instance locking state
+bool show_mine { false };
+
+bool run_gui { true };
 
-// NOTE: I am not sure if rwlocks in POSIX favour the writer as identified by
-// but I don't think that should be an issue in our implementation
+threading::spsc_queue<Action> writer_queue { WRITER_QUEUE_CAPACITY };
 
-threading::mutex tagged_draw_vector_mutex {};
+std::shared_ptr<const CanvasSnapshot> canvas {
+    std::make_shared<const CanvasSnapshot>()
+};
 
-threading::rwlock rwlock1 {};
-threading::rwlock rwlock2 {};
+std::atomic<std::uint64_t> canvas_version { 0 };
 
-TaggedDrawVector vec1 {};
-TaggedDrawVector vec2 {};
+threading::mutex dirty_regions_mutex { "dirty_regions_mutex" };
+std::vector<Bounds> dirty_regions {};
+bool is_everything_dirty { false };
 
 } // namespace client::share
@@ -4,9 +4,21 @@
 #include "../common/threading.hpp"
 #include "../common/types.hpp"
 
+// client
+#include "bounds.hpp"
+#include "canvas.hpp"
+
 // std
-#include <queue>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// The number of actions which can be waiting to be sent, the
+// input handler blocks once it is full
+#define WRITER_QUEUE_CAPACITY (1024)
 
 namespace client::share {
 
@@ -16,23 +28,40 @@ extern threading::thread input_thread;
 
 extern std::string username;
 
+// the identifier the server gave us
+extern UserId user;
+
+// what the handshake settled on
+extern Capabilities capabilities;
+
+// the usernames of all the users the server told us about
+extern threading::mutex user_names_mutex;
+extern std::unordered_map<UserId, std::string> user_names;
+
 extern bool show_mine;
 
 extern bool run_gui;
 
-extern threading::mutex writer_mutex;
-extern threading::cond_var writer_cond;
-extern std::queue<Action> writer_queue;
-
-// double instance locking state
-// (http://concurrencyfreaks.blogspot.com/2013/11/double-instance-locking.html)
+// NOTE: the queue is lock-free, the input handler pushes
+// onto it and only the writer pops from it
+extern threading::spsc_queue<Action> writer_queue;
 
-extern threading::mutex tagged_draw_vector_mutex;
+// The current snapshot of the canvas. It is only ever
+// accessed through std::atomic_load and std::atomic_store,
+// the reader publishes a new snapshot after every update
+// whilst the GUI and the input handler just grab whichever
+// snapshot is current (please look at client/canvas.hpp).
+extern std::shared_ptr<const CanvasSnapshot> canvas;
 
-extern threading::rwlock rwlock1;
-extern threading::rwlock rwlock2;
+// bumped by the reader every time the canvas changes, the
+// GUI uses it to figure out when it has to redraw
+extern std::atomic<std::uint64_t> canvas_version;
 
-extern TaggedDrawVector vec1;
-extern TaggedDrawVector vec2;
+// the regions of the canvas (in world space) which changed
+// since the GUI last looked, these are used to invalidate
+// only the cached tiles which are actually affected
+extern threading::mutex dirty_regions_mutex;
+extern std::vector<Bounds> dirty_regions;
+extern bool is_everything_dirty;
 
 } // namespace client::share
@@ -0,0 +1,244 @@
+// client
+#include "tiles.hpp"
+#include "batch.hpp"
+
+// std
+#include <cmath>
+
+namespace client {
+
+bool TileCache::is_usable(float zoom)
+{
+    return zoom < TILE_ZOOM_THRESHOLD;
+}
+
+int TileCache::level_for(float zoom)
+{
+    // pick the coarsest level which still has at least
+    // as many pixels as the screen, that way the tiles
+    // never have to be magnified
+    for (int level = TILE_LEVELS - 1; level > 0; level--) {
+        if (scale_of(level) >= zoom) {
+            return level;
+        }
+    }
+
+    return 0;
+}
+
+float TileCache::scale_of(int level)
+{
+    return std::ldexp(1.0f, -(level + 1));
+}
+
+float TileCache::world_size_of(int level)
+{
+    return static_cast<float>(TILE_SIZE_PX) / scale_of(level);
+}
+
+Bounds TileCache::region_of(const TileKey& key)
+{
+    float size = world_size_of(key.level);
+
+    float x0 = static_cast<float>(key.x) * size;
+    float y0 = static_cast<float>(key.y) * size;
+
+    return { x0, y0, x0 + size, y0 + size };
+}
+
+void TileCache::invalidate(const Bounds& region)
+{
+    for (auto& [key, tile] : m_tiles) {
+        if (region_of(key).overlaps(region)) {
+            tile.is_dirty = true;
+        }
+    }
+}
+
+void TileCache::invalidate_all()
+{
+    for (auto& [key, tile] : m_tiles) {
+        tile.is_dirty = true;
+    }
+}
+
+std::vector<TileKey> TileCache::stale_tiles(const Bounds& view, float zoom)
+{
+    m_frame++;
+
+    int level = level_for(zoom);
+
+    float size = world_size_of(level);
+
+    auto x0 = static_cast<int>(std::floor(view.x0 / size));
+    auto y0 = static_cast<int>(std::floor(view.y0 / size));
+    auto x1 = static_cast<int>(std::floor(view.x1 / size));
+    auto y1 = static_cast<int>(std::floor(view.y1 / size));
+
+    std::vector<TileKey> keys {};
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            TileKey key { level, x, y };
+
+            auto iter = m_tiles.find(key);
+
+            if (iter == m_tiles.end()) {
+                Tile tile {};
+
+                tile.render_texture
+                    = LoadRenderTexture(TILE_SIZE_PX, TILE_SIZE_PX);
+
+                SetTextureFilter(
+                    tile.render_texture.texture,
+                    TEXTURE_FILTER_BILINEAR
+                );
+
+                iter = m_tiles.emplace(key, tile).first;
+            }
+
+            Tile& tile = iter->second;
+
+            tile.last_used = m_frame;
+
+            if (tile.is_dirty && keys.size() < MAX_TILE_RENDERS_PER_FRAME) {
+                keys.push_back(key);
+            }
+        }
+    }
+
+    evict();
+
+    return keys;
+}
+
+void TileCache::rasterize(
+    const std::vector<TileKey>& keys,
+    const CanvasSnapshot& draws
+)
+{
+    if (keys.empty()) {
+        return;
+    }
+
+    // NOTE: all the tiles are batched in a single pass over
+    // the canvas, since going over the canvas is the
+    // expensive part for large canvases
+    std::vector<Bounds> regions {};
+    std::vector<SceneBatch> batches { keys.size() };
+
+    regions.reserve(keys.size());
+
+    for (auto& key : keys) {
+        regions.push_back(region_of(key));
+    }
+
+    for (auto& tagged_draw : draws) {
+        Bounds bounds = client::bounds_of(tagged_draw.draw);
+
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (regions[i].overlaps(bounds)) {
+                batches[i].add(tagged_draw.draw, scale_of(keys[i].level));
+            }
+        }
+    }
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        Tile& tile = m_tiles.at(keys[i]);
+
+        Camera2D camera { { 0, 0 },
+                          { regions[i].x0, regions[i].y0 },
+                          0,
+                          scale_of(keys[i].level) };
+
+        BeginTextureMode(tile.render_texture);
+        {
+            ClearBackground(BLANK);
+
+            BeginMode2D(camera);
+            {
+                batches[i].submit();
+            }
+            EndMode2D();
+        }
+        EndTextureMode();
+
+        tile.has_content = true;
+        tile.is_dirty = false;
+    }
+}
+
+void TileCache::draw(const Bounds& view, float zoom)
+{
+    int level = level_for(zoom);
+
+    float size = world_size_of(level);
+
+    auto x0 = static_cast<int>(std::floor(view.x0 / size));
+    auto y0 = static_cast<int>(std::floor(view.y0 / size));
+    auto x1 = static_cast<int>(std::floor(view.x1 / size));
+    auto y1 = static_cast<int>(std::floor(view.y1 / size));
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            auto iter = m_tiles.find({ level, x, y });
+
+            // NOTE: a dirty tile which has content is still
+            // drawn, showing a slightly outdated version of the
+            // canvas is better than showing nothing at all
+            if (iter == m_tiles.end() || !iter->second.has_content) {
+                continue;
+            }
+
+            Bounds region = region_of(iter->first);
+
+            // render textures are stored upside down hence the
+            // negative height of the source
+            DrawTexturePro(
+                iter->second.render_texture.texture,
+                { 0,
+                  0,
+                  static_cast<float>(TILE_SIZE_PX),
+                  -static_cast<float>(TILE_SIZE_PX) },
+                { region.x0, region.y0, size, size },
+                { 0, 0 },
+                0,
+                WHITE
+            );
+        }
+    }
+}
+
+void TileCache::evict()
+{
+    while (m_tiles.size() > MAX_CACHED_TILES) {
+        auto oldest = m_tiles.end();
+
+        for (auto iter = m_tiles.begin(); iter != m_tiles.end(); iter++) {
+            if (oldest == m_tiles.end()
+                || iter->second.last_used < oldest->second.last_used) {
+                oldest = iter;
+            }
+        }
+
+        // never throw away a tile which is on the screen
+        if (oldest->second.last_used == m_frame) {
+            break;
+        }
+
+        UnloadRenderTexture(oldest->second.render_texture);
+
+        m_tiles.erase(oldest);
+    }
+}
+
+void TileCache::clear()
+{
+    for (auto& [key, tile] : m_tiles) {
+        UnloadRenderTexture(tile.render_texture);
+    }
+
+    m_tiles.clear();
+}
+
+} // namespace client
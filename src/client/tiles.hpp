@@ -0,0 +1,131 @@
+#pragma once
+
+// raylib
+#include <raylib.h>
+
+// common
+#include "../common/types.hpp"
+
+// client
+#include "bounds.hpp"
+#include "canvas.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// The size (in pixels) of the texture backing a tile
+#define TILE_SIZE_PX (256)
+
+// The number of levels of detail, the scale of level L
+// is 2^-(L + 1), i.e. 0.5, 0.25 and 0.125
+#define TILE_LEVELS (3)
+
+// Tiles are only used when the camera is zoomed out
+// further than this
+#define TILE_ZOOM_THRESHOLD (0.5f)
+
+// The maximum number of tiles which are rasterized
+// within a single frame (the rest are left for the
+// following frames)
+#define MAX_TILE_RENDERS_PER_FRAME (8)
+
+// The maximum number of tiles kept around, when exceeded
+// the least recently used tiles are thrown away
+#define MAX_CACHED_TILES (256)
+
+namespace client {
+
+// When zoomed out the canvas is split up into a grid of
+// square tiles, each of which is rasterized into a render
+// texture once and then composited on every frame. Thus,
+// the cost of drawing a frame depends on the number of
+// tiles on the screen rather than the number of draws on
+// the canvas. Each level of detail has its own grid, a
+// tile of a coarser level covering more of the canvas
+// with the same number of pixels.
+
+struct TileKey {
+    int level { 0 };
+    int x { 0 };
+    int y { 0 };
+
+    bool operator==(const TileKey& other) const
+    {
+        return level == other.level && x == other.x && y == other.y;
+    }
+};
+
+struct TileKeyHash {
+    std::size_t operator()(const TileKey& key) const noexcept
+    {
+        auto x = static_cast<std::uint32_t>(key.x);
+        auto y = static_cast<std::uint32_t>(key.y);
+
+        return std::hash<std::uint64_t> {}(
+            (static_cast<std::uint64_t>(x) << 32 | y)
+            ^ static_cast<std::uint64_t>(key.level)
+        );
+    }
+};
+
+struct Tile {
+    RenderTexture2D render_texture {};
+    bool has_content { false };
+    bool is_dirty { true };
+    std::uint64_t last_used { 0 };
+};
+
+class TileCache {
+   public:
+    TileCache() = default;
+
+    TileCache(const TileCache&) = delete;
+
+    TileCache& operator=(const TileCache&) = delete;
+
+    [[nodiscard]] static bool is_usable(float zoom);
+
+    void invalidate(const Bounds& region);
+
+    void invalidate_all();
+
+    // Returns the visible tiles which have to be (re)rasterized
+    // before the view can be composited, creating any which
+    // are missing. At most MAX_TILE_RENDERS_PER_FRAME are
+    // returned.
+    [[nodiscard]] std::vector<TileKey>
+    stale_tiles(const Bounds& view, float zoom);
+
+    // NOTE: this has to be called outside of BeginDrawing
+    void rasterize(
+        const std::vector<TileKey>& keys,
+        const CanvasSnapshot& draws
+    );
+
+    // NOTE: this has to be called within BeginMode2D
+    void draw(const Bounds& view, float zoom);
+
+    // unloads all the render textures (has to be done
+    // before the window is closed)
+    void clear();
+
+   private:
+    [[nodiscard]] static int level_for(float zoom);
+
+    [[nodiscard]] static float scale_of(int level);
+
+    [[nodiscard]] static float world_size_of(int level);
+
+    [[nodiscard]] static Bounds region_of(const TileKey& key);
+
+    void evict();
+
+    std::unordered_map<TileKey, Tile, TileKeyHash> m_tiles {};
+
+    std::uint64_t m_frame { 0 };
+};
+
+} // namespace client
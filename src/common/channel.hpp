@@ -7,26 +7,32 @@
 #include <arpa/inet.h>
 
 // common
+#include "compression.hpp"
 #include "network.hpp"
 #include "serial.hpp"
 
 #define MAGIC_BYTES (static_cast<short>(0x2003))
 
+// The flags of a frame
+#define FRAME_COMPRESSED (0x01)
+
 struct Header {
     std::uint16_t magic_bytes;
     std::size_t payload_size;
+    std::uint8_t flags { 0 };
 
     [[nodiscard]] constexpr static std::size_t size()
     {
         return sizeof(decltype(Header::magic_bytes))
                + sizeof(decltype(Header::payload_size))
+               + sizeof(decltype(Header::flags))
                + 1; // to record the endianness (used cereal)
     }
 
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(magic_bytes, payload_size);
+        archive(magic_bytes, payload_size, flags);
     }
 };
 
@@ -187,25 +193,68 @@ class Channel {
             return std::make_pair(ByteString {}, ChannelErrorCode::END_OF_FILE);
         }
 
-        return std::make_pair(read_result.get_bytes(), ChannelErrorCode::OK);
+        return unpack(header, read_result.get_bytes());
     }
 
-    [[nodiscard]] ChannelError write(const ByteString& payload)
+    // Undoes whatever the flags of the header say was done to
+    // the payload, i.e. it gives back the payload as it was
+    // before it was framed
+    [[nodiscard]] static std::pair<ByteString, ChannelError>
+    unpack(const Header& header, ByteString bytes)
     {
-        ByteString header { serialize(Header { MAGIC_BYTES, payload.size() }) };
+        if ((header.flags & FRAME_COMPRESSED) == 0) {
+            return std::make_pair(std::move(bytes), ChannelErrorCode::OK);
+        }
 
-        ByteString packet {};
+        auto payload = compression::decompress(bytes);
 
-        packet.reserve(header.size() + payload.size());
+        if (!payload) {
+            return std::make_pair(
+                ByteString {},
+                ChannelErrorCode::DESERIALIZATION_FAILED
+            );
+        }
+
+        return std::make_pair(std::move(*payload), ChannelErrorCode::OK);
+    }
+
+    // Prepends the header to the payload, i.e. this
+    // produces exactly what write puts on the wire
+    [[nodiscard]] static ByteString frame(const ByteString& payload)
+    {
+        return frame(payload, 0);
+    }
 
-        for (auto& byte : header) {
-            packet.push_back(byte);
+    // Compresses the payload before framing it, as long as
+    // the payload is large enough and actually shrinks (it is
+    // framed as is otherwise)
+    //
+    // NOTE: only to be used for peers which asked for
+    // compression in the handshake
+    [[nodiscard]] static ByteString frame_compressed(const ByteString& payload)
+    {
+        if (payload.size() < COMPRESSION_THRESHOLD) {
+            return frame(payload);
         }
 
-        for (auto& byte : payload) {
-            packet.push_back(byte);
+        ByteString compressed = compression::compress(payload);
+
+        if (compressed.size() >= payload.size()) {
+            return frame(payload);
         }
 
+        return frame(compressed, FRAME_COMPRESSED);
+    }
+
+    [[nodiscard]] ChannelError write(const ByteString& payload)
+    {
+        return write_frames(frame(payload));
+    }
+
+    // Writes bytes which are already framed (possibly many
+    // frames back to back) with a single write
+    [[nodiscard]] ChannelError write_frames(const ByteString& packet)
+    {
         PollResult poll_result {};
 
         try {
@@ -232,5 +281,22 @@ class Channel {
     }
 
    private:
+    [[nodiscard]] static ByteString
+    frame(const ByteString& payload, std::uint8_t flags)
+    {
+        ByteString header { serialize(
+            Header { MAGIC_BYTES, payload.size(), flags }
+        ) };
+
+        ByteString packet {};
+
+        packet.reserve(header.size() + payload.size());
+
+        packet.append(header);
+        packet.append(payload);
+
+        return packet;
+    }
+
     IPv4SocketRef m_conn_sock {};
 };
@@ -0,0 +1,757 @@
+#pragma once
+
+// common
+#include "bytes.hpp"
+#include "overload.hpp"
+#include "types.hpp"
+
+// std
+#include <cmath>
+#include <cstring>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// cstd
+#include <cstddef>
+#include <cstdint>
+
+// The largest number of colours a palette holds, colours seen
+// after it is full are always written out in full
+#define COMPACT_PALETTE_SIZE (256)
+
+// The number of slots of the table the writer finds colours in
+// (a power of two, comfortably larger than the palette)
+#define COMPACT_PALETTE_SLOTS (1024)
+
+// The flags every draw starts with, the lowest two bits are
+// the kind of draw (the index within the Draw variant)
+#define COMPACT_KIND_MASK (0x03)
+#define COMPACT_SAME_COLOUR (0x04)
+#define COMPACT_PALETTE_COLOUR (0x08)
+#define COMPACT_FLOAT_RADIUS (0x10)
+// the kind of draw is four more than the lowest two bits say
+//
+// NOTE: only strokes have it, so the draws a peer without
+// strokes can read are written the way they always were
+#define COMPACT_MORE_KINDS (0x80)
+
+// The flags which are left for whoever writes the draw, the
+// snapshot uses them for the rest of the tagged draw
+#define COMPACT_ADOPTED (0x20)
+#define COMPACT_SAME_USER (0x40)
+
+// The compact encoding is used for the payloads which carry
+// many draws, i.e. snapshots and action batches. Cereal writes
+// every coordinate as a full 32 bit integer, whereas here every
+// number is a varint (zig-zag encoded when it can be negative).
+// The first point of a draw is written relative to the first
+// point of the previous draw and the rest of its points relative
+// to its first point, so draws which are close together (like
+// the segments of a stroke) take a byte or two per coordinate.
+//
+// Colours go through a palette which is built up as the draws
+// are written (and the same way as they are read). A colour
+// which was seen before takes a single byte, and nothing at all
+// when it is the colour of the previous draw.
+//
+// NOTE: the palette and the previous draw only live for as long
+// as a single payload, so every payload can be read on its own.
+
+namespace compact {
+
+class Writer {
+   public:
+    void byte(uint8_t value)
+    {
+        m_bytes.push_back(static_cast<char>(value));
+    }
+
+    void varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            byte(static_cast<uint8_t>(value | 0x80));
+
+            value >>= 7;
+        }
+
+        byte(static_cast<uint8_t>(value));
+    }
+
+    void zigzag(int64_t value)
+    {
+        varint(
+            (static_cast<uint64_t>(value) << 1)
+            ^ static_cast<uint64_t>(value >> 63)
+        );
+    }
+
+    void string(const std::string& value)
+    {
+        varint(value.size());
+
+        m_bytes.append(value);
+    }
+
+    void reserve(size_t size)
+    {
+        m_bytes.reserve(size);
+    }
+
+    [[nodiscard]] const ByteString& bytes() const
+    {
+        return m_bytes;
+    }
+
+   private:
+    ByteString m_bytes {};
+};
+
+// NOTE: like Cereal, the reader throws once the bytes do not
+// make sense (deserialize catches whatever is thrown)
+class Reader {
+   public:
+    explicit Reader(const ByteString& bytes)
+        : m_bytes(bytes)
+    {
+    }
+
+    uint8_t byte()
+    {
+        if (m_offset >= m_bytes.size()) {
+            throw std::out_of_range { "compact: unexpected end of bytes" };
+        }
+
+        return static_cast<uint8_t>(m_bytes[m_offset++]);
+    }
+
+    uint64_t varint()
+    {
+        uint64_t value { 0 };
+
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t next = byte();
+
+            value |= static_cast<uint64_t>(next & 0x7f) << shift;
+
+            if ((next & 0x80) == 0) {
+                return value;
+            }
+        }
+
+        throw std::runtime_error { "compact: varint is too long" };
+    }
+
+    int64_t zigzag()
+    {
+        uint64_t value = varint();
+
+        return static_cast<int64_t>(value >> 1)
+               ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // reads the delta from a coordinate to the next one, which
+    // has to fit in an int as well
+    int coordinate(int64_t base)
+    {
+        int64_t delta = zigzag();
+
+        if ((delta > 0 && base > std::numeric_limits<int>::max() - delta)
+            || (delta < 0 && base < std::numeric_limits<int>::min() - delta)) {
+            throw std::out_of_range { "compact: coordinate is out of range" };
+        }
+
+        return static_cast<int>(base + delta);
+    }
+
+    std::string string()
+    {
+        uint64_t size = varint();
+
+        if (size > remaining()) {
+            throw std::out_of_range { "compact: string is too long" };
+        }
+
+        std::string value = m_bytes.substr(m_offset, size);
+
+        m_offset += size;
+
+        return value;
+    }
+
+    // reads a count of things, every one of which takes at
+    // least a byte (which keeps a bad count from allocating
+    // more than the bytes could ever hold)
+    size_t count()
+    {
+        uint64_t value = varint();
+
+        if (value > remaining()) {
+            throw std::out_of_range { "compact: count is too large" };
+        }
+
+        return static_cast<size_t>(value);
+    }
+
+    [[nodiscard]] size_t remaining() const
+    {
+        return m_bytes.size() - m_offset;
+    }
+
+   private:
+    const ByteString& m_bytes;
+
+    size_t m_offset { 0 };
+};
+
+// Checks the points of a stroke (everything but the first
+// point), which have to be whole pairs of offsets, lead to
+// points which fit in an int and be no more than a stroke can
+// have
+inline size_t check_points(const StrokeDraw& draw)
+{
+    Reader reader { draw.points };
+
+    int x = draw.x;
+    int y = draw.y;
+
+    size_t count { 0 };
+
+    while (reader.remaining() > 0) {
+        x = reader.coordinate(x);
+        y = reader.coordinate(y);
+
+        if (++count >= STROKE_MAX_POINTS) {
+            throw std::out_of_range { "compact: stroke has too many points" };
+        }
+    }
+
+    return count;
+}
+
+// Keeps track of the previous draw and the palette, the same
+// codec has to be used for all the draws of a payload
+class DrawCodec {
+   public:
+    // the extra flags are written along with the flags of the
+    // draw (and handed back by read)
+    void write(Writer& writer, const Draw& draw, uint8_t extra)
+    {
+        uint8_t flags = static_cast<uint8_t>(draw.index() & COMPACT_KIND_MASK)
+                        | extra;
+
+        if (draw.index() > COMPACT_KIND_MASK) {
+            flags |= COMPACT_MORE_KINDS;
+        }
+
+        Colour colour = std::visit(
+            [](const auto& arg) {
+                return arg.colour;
+            },
+            draw
+        );
+
+        uint32_t key = to_key(colour);
+
+        size_t slot = find(key);
+
+        if (key == to_key(m_colour)) {
+            flags |= COMPACT_SAME_COLOUR;
+        } else if (m_slots[slot] >= 0) {
+            flags |= COMPACT_PALETTE_COLOUR;
+        }
+
+        if (std::holds_alternative<CircleDraw>(draw)
+            && !is_whole(std::get<CircleDraw>(draw).r)) {
+            flags |= COMPACT_FLOAT_RADIUS;
+        }
+
+        writer.byte(flags);
+
+        if ((flags & COMPACT_PALETTE_COLOUR) != 0) {
+            writer.byte(static_cast<uint8_t>(m_slots[slot]));
+        } else if ((flags & COMPACT_SAME_COLOUR) == 0) {
+            writer.byte(colour.r);
+            writer.byte(colour.g);
+            writer.byte(colour.b);
+
+            if (m_slots[slot] < 0 && m_palette.size() < COMPACT_PALETTE_SIZE) {
+                m_slots[slot] = static_cast<int16_t>(m_palette.size());
+            }
+
+            remember(colour);
+        }
+
+        m_colour = colour;
+
+        std::visit(
+            overload {
+                [this, &writer](const LineDraw& arg) {
+                    write_points(writer, arg.x0, arg.y0, arg.x1, arg.y1);
+                },
+                [this, &writer](const RectangleDraw& arg) {
+                    write_points(writer, arg.x0, arg.y0, arg.x1, arg.y1);
+                },
+                [this, &writer, flags](const CircleDraw& arg) {
+                    write_point(writer, arg.x, arg.y);
+
+                    if ((flags & COMPACT_FLOAT_RADIUS) != 0) {
+                        uint32_t bits { 0 };
+
+                        std::memcpy(&bits, &arg.r, sizeof(bits));
+
+                        for (int i = 0; i < 4; i++) {
+                            writer.byte(static_cast<uint8_t>(bits >> (8 * i)));
+                        }
+                    } else {
+                        writer.varint(static_cast<uint64_t>(arg.r));
+                    }
+                },
+                [this, &writer](const TextDraw& arg) {
+                    write_point(writer, arg.x, arg.y);
+
+                    writer.string(arg.string);
+                },
+                [this, &writer](const StrokeDraw& arg) {
+                    write_point(writer, arg.x, arg.y);
+
+                    writer.byte(arg.width);
+
+                    // NOTE: the points are already as compact
+                    // as they get
+                    writer.string(arg.points);
+                },
+            },
+            draw
+        );
+    }
+
+    Draw read(Reader& reader, uint8_t& extra)
+    {
+        uint8_t flags = reader.byte();
+
+        extra = flags & ~(COMPACT_KIND_MASK | COMPACT_SAME_COLOUR
+                          | COMPACT_PALETTE_COLOUR | COMPACT_FLOAT_RADIUS
+                          | COMPACT_MORE_KINDS);
+
+        Colour colour = m_colour;
+
+        if ((flags & COMPACT_PALETTE_COLOUR) != 0) {
+            uint8_t index = reader.byte();
+
+            if (index >= m_palette.size()) {
+                throw std::out_of_range { "compact: unknown colour" };
+            }
+
+            colour = m_palette[index];
+        } else if ((flags & COMPACT_SAME_COLOUR) == 0) {
+            colour.r = reader.byte();
+            colour.g = reader.byte();
+            colour.b = reader.byte();
+
+            remember(colour);
+        }
+
+        m_colour = colour;
+
+        size_t kind = flags & COMPACT_KIND_MASK;
+
+        if ((flags & COMPACT_MORE_KINDS) != 0) {
+            kind += COMPACT_KIND_MASK + 1;
+        }
+
+        switch (kind) {
+        case 0: {
+            LineDraw draw { colour };
+
+            read_points(reader, draw.x0, draw.y0, draw.x1, draw.y1);
+
+            return draw;
+        }
+        case 1: {
+            RectangleDraw draw { colour };
+
+            read_points(reader, draw.x0, draw.y0, draw.x1, draw.y1);
+
+            return draw;
+        }
+        case 2: {
+            CircleDraw draw { colour };
+
+            read_point(reader, draw.x, draw.y);
+
+            if ((flags & COMPACT_FLOAT_RADIUS) != 0) {
+                uint32_t bits { 0 };
+
+                for (int i = 0; i < 4; i++) {
+                    bits |= static_cast<uint32_t>(reader.byte()) << (8 * i);
+                }
+
+                std::memcpy(&draw.r, &bits, sizeof(bits));
+            } else {
+                draw.r = static_cast<float>(reader.varint());
+            }
+
+            return draw;
+        }
+        case 3: {
+            TextDraw draw { colour };
+
+            read_point(reader, draw.x, draw.y);
+
+            draw.string = reader.string();
+
+            return draw;
+        }
+        case 4: {
+            StrokeDraw draw { colour };
+
+            read_point(reader, draw.x, draw.y);
+
+            draw.width = reader.byte();
+            draw.points = reader.string();
+
+            check_points(draw);
+
+            return draw;
+        }
+        default:
+            throw std::out_of_range { "compact: unknown draw" };
+        }
+    }
+
+   private:
+    static uint32_t to_key(Colour colour)
+    {
+        return (static_cast<uint32_t>(colour.r) << 16)
+               | (static_cast<uint32_t>(colour.g) << 8)
+               | static_cast<uint32_t>(colour.b);
+    }
+
+    // whether the radius survives being written as a varint
+    static bool is_whole(float r)
+    {
+        return r >= 0 && r <= 16777216.0f && std::floor(r) == r;
+    }
+
+    // the slot which holds the colour, or the empty slot it
+    // would go in
+    size_t find(uint32_t key) const
+    {
+        size_t slot = (key * 2654435761u) & (COMPACT_PALETTE_SLOTS - 1);
+
+        while (m_slots[slot] >= 0 && to_key(m_palette[m_slots[slot]]) != key) {
+            slot = (slot + 1) & (COMPACT_PALETTE_SLOTS - 1);
+        }
+
+        return slot;
+    }
+
+    void remember(Colour colour)
+    {
+        if (m_palette.size() < COMPACT_PALETTE_SIZE) {
+            m_palette.push_back(colour);
+        }
+    }
+
+    void write_point(Writer& writer, int x, int y)
+    {
+        writer.zigzag(static_cast<int64_t>(x) - m_x);
+        writer.zigzag(static_cast<int64_t>(y) - m_y);
+
+        m_x = x;
+        m_y = y;
+    }
+
+    void write_points(Writer& writer, int x0, int y0, int x1, int y1)
+    {
+        write_point(writer, x0, y0);
+
+        writer.zigzag(static_cast<int64_t>(x1) - x0);
+        writer.zigzag(static_cast<int64_t>(y1) - y0);
+    }
+
+    void read_point(Reader& reader, int& x, int& y)
+    {
+        x = reader.coordinate(m_x);
+        y = reader.coordinate(m_y);
+
+        m_x = x;
+        m_y = y;
+    }
+
+    void read_points(Reader& reader, int& x0, int& y0, int& x1, int& y1)
+    {
+        read_point(reader, x0, y0);
+
+        x1 = reader.coordinate(x0);
+        y1 = reader.coordinate(y0);
+    }
+
+    int64_t m_x { 0 };
+    int64_t m_y { 0 };
+
+    Colour m_colour {};
+
+    std::vector<Colour> m_palette {};
+
+    // NOTE: only used when writing, every slot holds an index
+    // into the palette (or -1 when it is empty)
+    std::array<int16_t, COMPACT_PALETTE_SLOTS> m_slots = make_slots();
+
+    static std::array<int16_t, COMPACT_PALETTE_SLOTS> make_slots()
+    {
+        std::array<int16_t, COMPACT_PALETTE_SLOTS> slots {};
+
+        slots.fill(-1);
+
+        return slots;
+    }
+};
+
+inline void write_draws(Writer& writer, const TaggedDrawVector& draws)
+{
+    DrawCodec codec {};
+
+    UserId user { 0 };
+
+    // NOTE: most draws take less than this, which saves growing
+    // the buffer over and over for large canvases
+    writer.reserve(draws.size() * 12);
+
+    writer.varint(draws.size());
+
+    for (auto& tagged_draw : draws) {
+        uint8_t extra { 0 };
+
+        if (tagged_draw.adopted) {
+            extra |= COMPACT_ADOPTED;
+        }
+
+        if (tagged_draw.user == user) {
+            extra |= COMPACT_SAME_USER;
+        }
+
+        codec.write(writer, tagged_draw.draw, extra);
+
+        if (tagged_draw.user != user) {
+            writer.varint(tagged_draw.user);
+
+            user = tagged_draw.user;
+        }
+    }
+}
+
+inline TaggedDrawVector read_draws(Reader& reader)
+{
+    DrawCodec codec {};
+
+    UserId user { 0 };
+
+    TaggedDrawVector draws {};
+
+    size_t count = reader.count();
+
+    draws.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t extra { 0 };
+
+        Draw draw = codec.read(reader, extra);
+
+        if ((extra & COMPACT_SAME_USER) == 0) {
+            user = static_cast<UserId>(reader.varint());
+        }
+
+        draws.push_back(TaggedDraw { (extra & COMPACT_ADOPTED) != 0,
+                                     user,
+                                     std::move(draw) });
+    }
+
+    return draws;
+}
+
+inline void
+write_actions(Writer& writer, const std::vector<BatchedAction>& actions)
+{
+    DrawCodec codec {};
+
+    uint64_t sent_at { 0 };
+
+    writer.varint(actions.size());
+
+    for (auto& batched_action : actions) {
+        const Action& action = batched_action.action;
+
+        writer.byte(static_cast<uint8_t>(action.index()));
+
+        std::visit(
+            overload {
+                [&writer, &codec](const Draw& arg) {
+                    codec.write(writer, arg, 0);
+                },
+                [&writer, &codec](const Select& arg) {
+                    writer.zigzag(arg.id);
+
+                    codec.write(writer, arg.draw, 0);
+                },
+                [&writer](const Delete& arg) {
+                    writer.zigzag(arg.id);
+                },
+                [](const Undo&) {
+                },
+                [&writer](const Clear& arg) {
+                    writer.byte(static_cast<uint8_t>(arg.qualifier));
+                },
+            },
+            action
+        );
+
+        // the timestamps of a batch are close together
+        writer.zigzag(static_cast<int64_t>(batched_action.sent_at - sent_at));
+
+        sent_at = batched_action.sent_at;
+    }
+}
+
+inline std::vector<BatchedAction> read_actions(Reader& reader)
+{
+    DrawCodec codec {};
+
+    uint64_t sent_at { 0 };
+
+    std::vector<BatchedAction> actions {};
+
+    size_t count = reader.count();
+
+    actions.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        BatchedAction batched_action {};
+
+        uint8_t extra { 0 };
+
+        switch (reader.byte()) {
+        case 0:
+            batched_action.action = codec.read(reader, extra);
+            break;
+        case 1: {
+            Select select {};
+
+            select.id = static_cast<long>(reader.zigzag());
+            select.draw = codec.read(reader, extra);
+
+            batched_action.action = select;
+        } break;
+        case 2:
+            batched_action.action = Delete { static_cast<long>(reader.zigzag()
+            ) };
+            break;
+        case 3:
+            batched_action.action = Undo {};
+            break;
+        case 4: {
+            uint8_t qualifier = reader.byte();
+
+            if (qualifier != static_cast<uint8_t>(Qualifier::ALL)
+                && qualifier != static_cast<uint8_t>(Qualifier::MINE)) {
+                throw std::out_of_range { "compact: unknown qualifier" };
+            }
+
+            batched_action.action = Clear { static_cast<Qualifier>(qualifier) };
+        } break;
+        default:
+            throw std::out_of_range { "compact: unknown action" };
+        }
+
+        sent_at += static_cast<uint64_t>(reader.zigzag());
+
+        batched_action.sent_at = sent_at;
+
+        actions.push_back(std::move(batched_action));
+    }
+
+    return actions;
+}
+
+} // namespace compact
+
+// NOTE: the payloads only declare how they are saved and loaded,
+// the definitions are here since they need the codec (they are
+// available wherever serial.hpp is included)
+
+template <class Archive>
+void StrokeDraw::save(Archive& archive) const
+{
+    archive(colour, width, x, y, points);
+}
+
+template <class Archive>
+void StrokeDraw::load(Archive& archive)
+{
+    archive(colour, width, x, y, points);
+
+    compact::check_points(*this);
+}
+
+template <class Archive>
+void Snapshot::save(Archive& archive) const
+{
+    archive(compact);
+
+    if (!compact) {
+        archive(draws);
+
+        return;
+    }
+
+    compact::Writer writer {};
+
+    compact::write_draws(writer, draws);
+
+    archive(writer.bytes());
+}
+
+template <class Archive>
+void Snapshot::load(Archive& archive)
+{
+    archive(compact);
+
+    if (!compact) {
+        archive(draws);
+
+        return;
+    }
+
+    ByteString bytes {};
+
+    archive(bytes);
+
+    compact::Reader reader { bytes };
+
+    draws = compact::read_draws(reader);
+}
+
+template <class Archive>
+void ActionBatch::save(Archive& archive) const
+{
+    compact::Writer writer {};
+
+    compact::write_actions(writer, actions);
+
+    archive(user, writer.bytes());
+}
+
+template <class Archive>
+void ActionBatch::load(Archive& archive)
+{
+    ByteString bytes {};
+
+    archive(user, bytes);
+
+    compact::Reader reader { bytes };
+
+    actions = compact::read_actions(reader);
+}
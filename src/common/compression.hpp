@@ -0,0 +1,304 @@
+#pragma once
+
+// common
+#include "bytes.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+// cstd
+#include <cstddef>
+#include <cstdint>
+
+// Payloads smaller than this are never compressed, the few
+// bytes saved are not worth the time
+#define COMPRESSION_THRESHOLD (4096)
+
+// The number of bits of the hash of the match finder (which
+// has a slot for every hash)
+#define COMPRESSION_HASH_BITS (14)
+
+#define COMPRESSION_MIN_MATCH (4)
+#define COMPRESSION_MAX_OFFSET (65535)
+
+// The last bytes of the input are always written as literals,
+// which keeps the match finder from reading past the end
+#define COMPRESSION_LAST_LITERALS (5)
+
+// The largest ratio a compressed payload can have (a run of
+// the same byte), anything claiming more is malformed
+#define COMPRESSION_MAX_RATIO (255)
+
+// A small LZ77 compressor in the style of LZ4, which trades
+// some of the ratio for being fast enough to use on every
+// snapshot. The compressed bytes start off with the size of
+// the original bytes (a varint), followed by sequences of a
+// token, the literals and a match. The token holds the number
+// of literals (the high four bits) and the length of the
+// match (the low four bits, less the minimum match), a nibble
+// of 15 means that the rest of the number follows in bytes
+// (added up until a byte which is not 255). The match is a two
+// byte offset back into the output (little endian). The last
+// sequence only has literals.
+//
+// NOTE: the snapshots compress well since draws of the same
+// user and colour share most of their bytes
+
+namespace compression {
+
+namespace detail {
+
+inline uint32_t read32(const char* bytes)
+{
+    uint32_t value { 0 };
+
+    std::memcpy(&value, bytes, sizeof(value));
+
+    return value;
+}
+
+inline uint32_t hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - COMPRESSION_HASH_BITS);
+}
+
+inline void write_length(ByteString& output, size_t length)
+{
+    while (length >= 255) {
+        output.push_back(static_cast<char>(255));
+
+        length -= 255;
+    }
+
+    output.push_back(static_cast<char>(length));
+}
+
+inline void write_sequence(
+    ByteString& output,
+    const char* literals,
+    size_t literal_length,
+    size_t offset,
+    size_t match_length
+)
+{
+    size_t match_nibble
+        = match_length > 0 ? match_length - COMPRESSION_MIN_MATCH : 0;
+
+    output.push_back(static_cast<char>(
+        (std::min<size_t>(literal_length, 15) << 4)
+        | std::min<size_t>(match_nibble, 15)
+    ));
+
+    if (literal_length >= 15) {
+        write_length(output, literal_length - 15);
+    }
+
+    output.append(literals, literal_length);
+
+    if (match_length == 0) {
+        return;
+    }
+
+    output.push_back(static_cast<char>(offset & 0xff));
+    output.push_back(static_cast<char>(offset >> 8));
+
+    if (match_nibble >= 15) {
+        write_length(output, match_nibble - 15);
+    }
+}
+
+// NOTE: returns false once the input runs out
+inline bool read_length(const ByteString& input, size_t& offset, size_t& length)
+{
+    uint8_t byte { 255 };
+
+    while (byte == 255) {
+        if (offset >= input.size()) {
+            return false;
+        }
+
+        byte = static_cast<uint8_t>(input[offset++]);
+
+        length += byte;
+    }
+
+    return true;
+}
+
+} // namespace detail
+
+inline ByteString compress(const ByteString& input)
+{
+    ByteString output {};
+
+    output.reserve(input.size() / 2 + 16);
+
+    uint64_t size = input.size();
+
+    while (size >= 0x80) {
+        output.push_back(static_cast<char>((size & 0x7f) | 0x80));
+
+        size >>= 7;
+    }
+
+    output.push_back(static_cast<char>(size));
+
+    const char* data = input.data();
+
+    size_t anchor { 0 };
+
+    if (input.size() > COMPRESSION_MIN_MATCH + COMPRESSION_LAST_LITERALS) {
+        std::vector<uint32_t> table(1 << COMPRESSION_HASH_BITS, 0);
+
+        size_t limit
+            = input.size() - COMPRESSION_MIN_MATCH - COMPRESSION_LAST_LITERALS;
+
+        size_t position { 0 };
+
+        while (position <= limit) {
+            uint32_t sequence = detail::read32(data + position);
+
+            uint32_t& slot = table[detail::hash(sequence)];
+
+            size_t candidate = slot;
+
+            slot = static_cast<uint32_t>(position);
+
+            if (candidate >= position
+                || position - candidate > COMPRESSION_MAX_OFFSET
+                || detail::read32(data + candidate) != sequence) {
+                // NOTE: skips ahead faster the longer it goes
+                // without a match, so that bytes which do not
+                // compress do not take long
+                position += 1 + ((position - anchor) >> 6);
+
+                continue;
+            }
+
+            size_t length { COMPRESSION_MIN_MATCH };
+
+            size_t max_length
+                = input.size() - COMPRESSION_LAST_LITERALS - position;
+
+            while (length < max_length
+                   && data[candidate + length] == data[position + length]) {
+                length++;
+            }
+
+            detail::write_sequence(
+                output,
+                data + anchor,
+                position - anchor,
+                position - candidate,
+                length
+            );
+
+            position += length;
+
+            anchor = position;
+        }
+    }
+
+    detail::write_sequence(output, data + anchor, input.size() - anchor, 0, 0);
+
+    return output;
+}
+
+inline std::optional<ByteString> decompress(const ByteString& input)
+{
+    size_t offset { 0 };
+
+    uint64_t size { 0 };
+
+    for (unsigned shift = 0;; shift += 7) {
+        if (offset >= input.size() || shift >= 64) {
+            return {};
+        }
+
+        uint8_t byte = static_cast<uint8_t>(input[offset++]);
+
+        size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+
+    if (size / COMPRESSION_MAX_RATIO > input.size()) {
+        return {};
+    }
+
+    ByteString output {};
+
+    output.reserve(size);
+
+    while (offset < input.size()) {
+        uint8_t token = static_cast<uint8_t>(input[offset++]);
+
+        size_t literal_length = token >> 4;
+
+        if (literal_length == 15
+            && !detail::read_length(input, offset, literal_length)) {
+            return {};
+        }
+
+        if (literal_length > input.size() - offset
+            || literal_length > size - output.size()) {
+            return {};
+        }
+
+        output.append(input, offset, literal_length);
+
+        offset += literal_length;
+
+        // the last sequence has no match
+        if (offset == input.size()) {
+            break;
+        }
+
+        if (input.size() - offset < 2) {
+            return {};
+        }
+
+        size_t match_offset = static_cast<uint8_t>(input[offset])
+                              | (static_cast<uint8_t>(input[offset + 1]) << 8);
+
+        offset += 2;
+
+        size_t match_length = token & 0x0f;
+
+        if (match_length == 15
+            && !detail::read_length(input, offset, match_length)) {
+            return {};
+        }
+
+        match_length += COMPRESSION_MIN_MATCH;
+
+        if (match_offset == 0 || match_offset > output.size()
+            || match_length > size - output.size()) {
+            return {};
+        }
+
+        size_t start = output.size();
+
+        output.resize(start + match_length);
+
+        // NOTE: the match can overlap with itself (which is
+        // how runs are written), so it is copied a byte at a
+        // time
+        for (size_t i = 0; i < match_length; i++) {
+            output[start + i] = output[start - match_offset + i];
+        }
+    }
+
+    if (output.size() != size) {
+        return {};
+    }
+
+    return output;
+}
+
+} // namespace compression
@@ -0,0 +1,157 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// cstd
+#include <cmath>
+
+// The number of bits used for the linear sub-buckets within
+// each power of two, the relative error of a recorded value
+// is at most 2^-(HISTOGRAM_SUB_BUCKET_BITS - 1), i.e. < 1.6%
+#define HISTOGRAM_SUB_BUCKET_BITS (7)
+
+// This is a log-linear histogram (along the lines of HDR
+// histograms). Values below 2^HISTOGRAM_SUB_BUCKET_BITS
+// are recorded exactly, above that every power of two is
+// split up into the same number of linear buckets. Thus,
+// the memory footprint is fixed and small, recording is a
+// couple of bit operations and percentiles are accurate to
+// within a constant relative error no matter the range of
+// the values (we use it for latencies in microseconds).
+//
+// NOTE: the number of sub-bucket bits can be lowered where
+// many histograms are kept around (trading accuracy for
+// memory), the bucketing is exposed so that other counters
+// can share the same layout.
+
+template <std::size_t SubBucketBits>
+class BasicHistogram {
+   public:
+    static constexpr std::size_t SUB_BUCKET_COUNT { 1u << SubBucketBits };
+
+    static constexpr std::size_t HALF_SUB_BUCKET_COUNT {
+        SUB_BUCKET_COUNT / 2
+    };
+
+    // the first SUB_BUCKET_COUNT buckets hold exact values,
+    // then every remaining power of two gets half as many
+    static constexpr std::size_t BUCKET_COUNT {
+        SUB_BUCKET_COUNT + (64 - SubBucketBits) * HALF_SUB_BUCKET_COUNT
+    };
+
+    void record(std::uint64_t value, std::uint64_t count = 1)
+    {
+        if (count == 0) {
+            return;
+        }
+
+        m_counts[index_of(value)] += count;
+
+        m_count += count;
+
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+    }
+
+    void merge(const BasicHistogram& other)
+    {
+        for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+            m_counts[i] += other.m_counts[i];
+        }
+
+        m_count += other.m_count;
+
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    [[nodiscard]] std::uint64_t count() const
+    {
+        return m_count;
+    }
+
+    [[nodiscard]] std::uint64_t min() const
+    {
+        return m_count == 0 ? 0 : m_min;
+    }
+
+    [[nodiscard]] std::uint64_t max() const
+    {
+        return m_max;
+    }
+
+    // the percentile has to be within [0, 100], the value
+    // returned is the highest value which is equivalent to
+    // (i.e. falls within the same bucket as) the value at
+    // the given percentile
+    [[nodiscard]] std::uint64_t percentile(double percentile) const
+    {
+        if (m_count == 0) {
+            return 0;
+        }
+
+        auto rank = static_cast<std::uint64_t>(
+            std::ceil(percentile / 100.0 * static_cast<double>(m_count))
+        );
+
+        rank = std::clamp<std::uint64_t>(rank, 1, m_count);
+
+        std::uint64_t seen = 0;
+
+        for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+            seen += m_counts[i];
+
+            if (seen >= rank) {
+                return std::min(highest_equivalent_of(i), m_max);
+            }
+        }
+
+        return m_max;
+    }
+
+    [[nodiscard]] static std::size_t index_of(std::uint64_t value)
+    {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<std::size_t>(value);
+        }
+
+        auto msb = static_cast<std::size_t>(63 - __builtin_clzll(value));
+
+        std::size_t shift = msb - (SubBucketBits - 1);
+
+        auto sub_bucket = static_cast<std::size_t>(value >> shift);
+
+        return SUB_BUCKET_COUNT + (shift - 1) * HALF_SUB_BUCKET_COUNT
+               + (sub_bucket - HALF_SUB_BUCKET_COUNT);
+    }
+
+    [[nodiscard]] static std::uint64_t highest_equivalent_of(std::size_t index)
+    {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+
+        std::size_t shift
+            = (index - SUB_BUCKET_COUNT) / HALF_SUB_BUCKET_COUNT + 1;
+
+        std::uint64_t sub_bucket
+            = (index - SUB_BUCKET_COUNT) % HALF_SUB_BUCKET_COUNT
+              + HALF_SUB_BUCKET_COUNT;
+
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+   private:
+    std::array<std::uint64_t, BUCKET_COUNT> m_counts {};
+
+    std::uint64_t m_count { 0 };
+
+    std::uint64_t m_min { std::numeric_limits<std::uint64_t>::max() };
+    std::uint64_t m_max { 0 };
+};
+
+using Histogram = BasicHistogram<HISTOGRAM_SUB_BUCKET_BITS>;
@@ -0,0 +1,267 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+// pthreads
+#include <pthread.h>
+
+// The maximum number of distinct (named) locks which can be
+// profiled, any others are not profiled
+#define LOCKPROF_MAX_LOCKS (64)
+
+// The maximum number of read locks a single thread can hold
+// at once and still have their hold time measured
+#define LOCKPROF_MAX_READ_HOLDS (8)
+
+namespace threading::lockprof {
+
+// The lock contention profiler (turned on with the LOCKPROF
+// build option) keeps the statistics of every named lock. The
+// wrappers in threading.hpp record into these statistics: how
+// often a lock is acquired, how often it was already held (and
+// how long was spent waiting for it) and how long it is held.
+// Locks which share a name share their statistics.
+//
+// NOTE: contention is detected by trying to lock first, so an
+// uncontended acquisition costs a try lock and two reads of
+// the clock (one when acquired and one when released).
+
+enum class Kind : uint8_t {
+    MUTEX,
+    READ,
+    WRITE,
+    COND_VAR,
+};
+
+inline const char* kind_name(Kind kind)
+{
+    switch (kind) {
+    case Kind::MUTEX:
+        return "mutex";
+    case Kind::READ:
+        return "rwlock (read)";
+    case Kind::WRITE:
+        return "rwlock (write)";
+    case Kind::COND_VAR:
+        return "cond_var";
+    }
+
+    return "unknown";
+}
+
+inline uint64_t now_ns()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        )
+            .count()
+    );
+}
+
+inline void update_max(std::atomic<uint64_t>& max, uint64_t value)
+{
+    uint64_t current = max.load(std::memory_order_relaxed);
+
+    while (value > current
+           && !max.compare_exchange_weak(
+               current,
+               value,
+               std::memory_order_relaxed
+           )) { }
+}
+
+struct LockStats {
+    const char* name { nullptr };
+    Kind kind { Kind::MUTEX };
+
+    // for a condition variable an acquisition is a wait and the
+    // wait time is the time spent waiting to be woken up
+    std::atomic<uint64_t> acquisitions { 0 };
+    std::atomic<uint64_t> contentions { 0 };
+
+    std::atomic<uint64_t> wait_ns { 0 };
+    std::atomic<uint64_t> max_wait_ns { 0 };
+
+    std::atomic<uint64_t> hold_ns { 0 };
+    std::atomic<uint64_t> max_hold_ns { 0 };
+
+    void acquired()
+    {
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void contended()
+    {
+        contentions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void waited(uint64_t duration_ns)
+    {
+        wait_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+
+        update_max(max_wait_ns, duration_ns);
+    }
+
+    void held(uint64_t duration_ns)
+    {
+        hold_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+
+        update_max(max_hold_ns, duration_ns);
+    }
+};
+
+namespace details {
+    struct Registry {
+        pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+        std::array<LockStats, LOCKPROF_MAX_LOCKS> stats {};
+
+        std::atomic<size_t> size { 0 };
+    };
+
+    inline Registry& registry()
+    {
+        static Registry registry {};
+
+        return registry;
+    }
+
+    struct ReadHold {
+        const void* lock { nullptr };
+        uint64_t since_ns { 0 };
+    };
+
+    inline thread_local std::array<ReadHold, LOCKPROF_MAX_READ_HOLDS>
+        read_holds {};
+} // namespace details
+
+// gives the statistics the lock with the given name records
+// into, or nullptr if there is no room for any more locks
+inline LockStats* register_lock(const char* name, Kind kind)
+{
+    auto& registry = details::registry();
+
+    // NOTE: registering happens when a lock is created (which
+    // is mostly before main), so a plain mutex is good enough
+    pthread_mutex_lock(&registry.mutex);
+
+    size_t size = registry.size.load(std::memory_order_relaxed);
+
+    LockStats* stats { nullptr };
+
+    for (size_t i = 0; i < size; i++) {
+        if (registry.stats[i].kind == kind
+            && std::strcmp(registry.stats[i].name, name) == 0) {
+            stats = &registry.stats[i];
+
+            break;
+        }
+    }
+
+    if (stats == nullptr && size < LOCKPROF_MAX_LOCKS) {
+        stats = &registry.stats[size];
+
+        stats->name = name;
+        stats->kind = kind;
+
+        registry.size.store(size + 1, std::memory_order_release);
+    }
+
+    pthread_mutex_unlock(&registry.mutex);
+
+    return stats;
+}
+
+// remembers when the calling thread took a read lock
+inline void read_acquired(const void* lock)
+{
+    for (auto& hold : details::read_holds) {
+        if (hold.lock == nullptr) {
+            hold.lock = lock;
+            hold.since_ns = now_ns();
+
+            return;
+        }
+    }
+}
+
+// gives how long the calling thread held a read lock for (or
+// zero if it was not remembered)
+inline uint64_t read_released(const void* lock)
+{
+    for (auto& hold : details::read_holds) {
+        if (hold.lock == lock) {
+            hold.lock = nullptr;
+
+            return now_ns() - hold.since_ns;
+        }
+    }
+
+    return 0;
+}
+
+struct Summary {
+    const char* name { nullptr };
+    Kind kind { Kind::MUTEX };
+
+    uint64_t acquisitions { 0 };
+    uint64_t contentions { 0 };
+
+    uint64_t wait_ns { 0 };
+    uint64_t max_wait_ns { 0 };
+
+    uint64_t hold_ns { 0 };
+    uint64_t max_hold_ns { 0 };
+};
+
+// the statistics of every lock which has been acquired, most
+// waited on first
+inline std::vector<Summary> summarize()
+{
+    auto& registry = details::registry();
+
+    size_t size = registry.size.load(std::memory_order_acquire);
+
+    std::vector<Summary> summaries {};
+
+    for (size_t i = 0; i < size; i++) {
+        const auto& stats = registry.stats[i];
+
+        Summary summary {};
+
+        summary.name = stats.name;
+        summary.kind = stats.kind;
+        summary.acquisitions = stats.acquisitions.load(std::memory_order_relaxed);
+        summary.contentions = stats.contentions.load(std::memory_order_relaxed);
+        summary.wait_ns = stats.wait_ns.load(std::memory_order_relaxed);
+        summary.max_wait_ns = stats.max_wait_ns.load(std::memory_order_relaxed);
+        summary.hold_ns = stats.hold_ns.load(std::memory_order_relaxed);
+        summary.max_hold_ns = stats.max_hold_ns.load(std::memory_order_relaxed);
+
+        if (summary.acquisitions > 0) {
+            summaries.push_back(summary);
+        }
+    }
+
+    std::sort(
+        summaries.begin(),
+        summaries.end(),
+        [](const Summary& lhs, const Summary& rhs) {
+            return lhs.wait_ns > rhs.wait_ns;
+        }
+    );
+
+    return summaries;
+}
+
+} // namespace threading::lockprof
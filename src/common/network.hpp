@@ -206,7 +206,7 @@ class IPv4Socket {
 
         int flags = fcntl(m_sock_fd, F_GETFL);
         ABORTIFV(flags == -1, "fcntl(): {}", strerror(errno));
-        int ret = fcntl(m_sock_fd, F_SETFL, flags & O_NONBLOCK);
+        int ret = fcntl(m_sock_fd, F_SETFL, flags | O_NONBLOCK);
         ABORTIFV(ret == -1, "fcntl(): {}", strerror(errno));
     }
 
@@ -440,6 +440,13 @@ class IPv4SocketRef {
     {
     }
 
+    // refers to a socket which was not opened through an
+    // IPv4Socket (like one end of a socketpair)
+    explicit IPv4SocketRef(int sock_fd) noexcept
+        : m_sock_fd(sock_fd)
+    {
+    }
+
     IPv4SocketRef(const IPv4SocketRef& other) noexcept = default;
 
     IPv4SocketRef& operator=(const IPv4SocketRef& other) noexcept
@@ -2,6 +2,7 @@
 
 // common
 #include "bytes.hpp"
+#include "compact.hpp"
 
 // cereal
 #include <cereal/archives/portable_binary.hpp>
@@ -0,0 +1,156 @@
+#pragma once
+
+// common
+#include "compact.hpp"
+#include "types.hpp"
+
+// cstd
+#include <cstddef>
+#include <cstdint>
+
+// std
+#include <variant>
+
+// The points of a stroke (please look at StrokeDraw) are only
+// ever built up a point at a time and gone over from the first
+// to the last, so they are kept the way they are sent.
+
+namespace stroke {
+
+class Builder {
+   public:
+    Builder(Colour colour, uint8_t width, int x, int y)
+        : m_draw { colour, width, x, y }, m_x(x), m_y(y)
+    {
+    }
+
+    // NOTE: returns false (and leaves the stroke as is) once
+    // the stroke has as many points as it can have
+    bool add(int x, int y)
+    {
+        if (m_count >= STROKE_MAX_POINTS) {
+            return false;
+        }
+
+        m_writer.zigzag(static_cast<int64_t>(x) - m_x);
+        m_writer.zigzag(static_cast<int64_t>(y) - m_y);
+
+        m_x = x;
+        m_y = y;
+
+        m_count++;
+
+        return true;
+    }
+
+    // the number of points, including the first one
+    [[nodiscard]] size_t size() const
+    {
+        return m_count;
+    }
+
+    [[nodiscard]] StrokeDraw build() const
+    {
+        StrokeDraw draw = m_draw;
+
+        draw.points = m_writer.bytes();
+
+        return draw;
+    }
+
+   private:
+    StrokeDraw m_draw {};
+
+    compact::Writer m_writer {};
+
+    int m_x { 0 };
+    int m_y { 0 };
+
+    size_t m_count { 1 };
+};
+
+// Calls the function with every point of the stroke (as a pair
+// of ints), in order
+//
+// NOTE: the points of a stroke which was read were checked
+// then, so this does not throw
+template <class Function>
+void for_each_point(const StrokeDraw& draw, Function&& function)
+{
+    int x = draw.x;
+    int y = draw.y;
+
+    function(x, y);
+
+    compact::Reader reader { draw.points };
+
+    while (reader.remaining() > 0) {
+        x = reader.coordinate(x);
+        y = reader.coordinate(y);
+
+        function(x, y);
+    }
+}
+
+// The line a peer without strokes is sent in place of a stroke,
+// from its first point to its last
+//
+// NOTE: a stroke is a single draw and so is the line, the ids
+// of the draws after it are the same for every peer
+inline LineDraw to_line(const StrokeDraw& draw)
+{
+    LineDraw line { draw.colour, draw.x, draw.y, draw.x, draw.y };
+
+    for_each_point(draw, [&line](int x, int y) {
+        line.x1 = x;
+        line.y1 = y;
+    });
+
+    return line;
+}
+
+inline bool is_stroke(const Draw& draw)
+{
+    return std::holds_alternative<StrokeDraw>(draw);
+}
+
+// whether the action draws (or selects) a stroke
+inline bool has_stroke(const Action& action)
+{
+    if (std::holds_alternative<Draw>(action)) {
+        return is_stroke(std::get<Draw>(action));
+    }
+
+    if (std::holds_alternative<Select>(action)) {
+        return is_stroke(std::get<Select>(action).draw);
+    }
+
+    return false;
+}
+
+// Turns the strokes of the action into lines
+inline void to_lines(Action& action)
+{
+    Draw* draw = nullptr;
+
+    if (std::holds_alternative<Draw>(action)) {
+        draw = &std::get<Draw>(action);
+    } else if (std::holds_alternative<Select>(action)) {
+        draw = &std::get<Select>(action).draw;
+    }
+
+    if (draw != nullptr && is_stroke(*draw)) {
+        *draw = to_line(std::get<StrokeDraw>(*draw));
+    }
+}
+
+inline void to_lines(TaggedDrawVector& draws)
+{
+    for (TaggedDraw& tagged : draws) {
+        if (is_stroke(tagged.draw)) {
+            tagged.draw = to_line(std::get<StrokeDraw>(tagged.draw));
+        }
+    }
+}
+
+} // namespace stroke
@@ -41,7 +41,7 @@ class TaggedDrawVectorWrapper {
     void adopt(const Adopt& adopt)
     {
         for (auto iter = m_vector.rbegin(); iter != m_vector.rend(); iter++) {
-            if (iter->username == adopt.username) {
+            if (iter->user == adopt.user) {
                 iter->adopted = true;
             }
         }
@@ -49,24 +49,24 @@ class TaggedDrawVectorWrapper {
 
     void update(const TaggedAction& tagged_action)
     {
-        std::string username = tagged_action.username;
+        UserId user = tagged_action.user;
 
         std::visit(
             overload {
-                [this, username](const Clear& arg) {
-                    handle(username, arg);
+                [this, user](const Clear& arg) {
+                    handle(user, arg);
                 },
-                [this, username](const Undo& arg) {
-                    handle(username, arg);
+                [this, user](const Undo& arg) {
+                    handle(user, arg);
                 },
-                [this, username](const Delete& arg) {
-                    handle(username, arg);
+                [this, user](const Delete& arg) {
+                    handle(user, arg);
                 },
-                [this, username](const Select& arg) {
-                    handle(username, arg);
+                [this, user](const Select& arg) {
+                    handle(user, arg);
                 },
-                [this, username](const Draw& arg) {
-                    handle(username, arg);
+                [this, user](const Draw& arg) {
+                    handle(user, arg);
                 },
             },
             tagged_action.action
@@ -74,15 +74,15 @@ class TaggedDrawVectorWrapper {
     }
 
    private:
-    void handle(const std::string& username, const Draw& arg)
+    void handle(UserId user, const Draw& arg)
     {
-        m_vector.push_back(TaggedDraw { false, username, arg });
+        m_vector.push_back(TaggedDraw { false, user, arg });
     }
-    void handle(const std::string& username, const Select& arg)
+    void handle(UserId user, const Select& arg)
     {
-        m_vector[static_cast<size_t>(arg.id)] = { false, username, arg.draw };
+        m_vector[static_cast<size_t>(arg.id)] = { false, user, arg.draw };
     }
-    void handle(const std::string&, const Delete& arg)
+    void handle(UserId, const Delete& arg)
     {
         if (m_vector.empty())
             return;
@@ -96,20 +96,20 @@ class TaggedDrawVectorWrapper {
 
         m_vector.erase(m_vector.begin() + id);
     }
-    void handle(const std::string& username, const Undo&)
+    void handle(UserId user, const Undo&)
     {
         if (m_vector.empty())
             return;
 
         for (auto iter = m_vector.rbegin(); iter != m_vector.rend(); iter++) {
-            if (iter->username == username) {
+            if (iter->user == user) {
                 m_vector.erase(iter.base() - 1);
 
                 break;
             }
         }
     }
-    void handle(const std::string& username, const Clear& arg)
+    void handle(UserId user, const Clear& arg)
     {
         switch (arg.qualifier) {
         case Qualifier::ALL:
@@ -122,7 +122,7 @@ class TaggedDrawVectorWrapper {
             filtered_vector.reserve(m_vector.size());
 
             for (auto& tagged_draw : m_vector) {
-                if (tagged_draw.username != username) {
+                if (tagged_draw.user != user) {
                     filtered_vector.push_back(std::move(tagged_draw));
                 }
             }
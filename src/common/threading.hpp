@@ -1,9 +1,13 @@
 #pragma once
 
 // std
+#include <atomic>
 #include <cerrno>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <functional>
+#include <memory>
 #include <stdexcept>
 #include <type_traits>
 #include <utility>
@@ -11,8 +15,28 @@
 // pthreads
 #include <pthread.h>
 
+// unix
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#ifdef NETSKETCH_LOCKPROF
+
+// common
+#include "lockprof.hpp"
+
+#endif
+
 #define USE_POP (1)
 
+// The size of a cache line, the indices of the queues which are
+// written by different threads are kept on separate lines
+#define CACHE_LINE_SIZE (64)
+
+// The number of times a queue is retried before blocking, the
+// other side is usually only a moment away and blocking costs
+// a system call on both sides
+#define QUEUE_SPIN_TRIES (128)
+
 namespace threading {
 
 // The below is a list of C++ wrappers around the underlying POSIX mechanism.
@@ -249,6 +273,9 @@ class mutex {
         : mutex_handle {
             std::exchange(other.mutex_handle, PTHREAD_MUTEX_INITIALIZER)
         }
+#ifdef NETSKETCH_LOCKPROF
+        , m_stats { std::exchange(other.m_stats, nullptr) }
+#endif
     {
     }
 
@@ -257,6 +284,10 @@ class mutex {
         mutex_handle
             = std::exchange(other.mutex_handle, PTHREAD_MUTEX_INITIALIZER);
 
+#ifdef NETSKETCH_LOCKPROF
+        m_stats = std::exchange(other.m_stats, nullptr);
+#endif
+
         return *this;
     }
 
@@ -269,6 +300,17 @@ class mutex {
         }
     }
 
+    // NOTE: the name is only used when profiling lock
+    // contention, it is what the mutex is reported as (unnamed
+    // locks are not profiled)
+    explicit mutex([[maybe_unused]] const char* name)
+        : mutex()
+    {
+#ifdef NETSKETCH_LOCKPROF
+        m_stats = lockprof::register_lock(name, lockprof::Kind::MUTEX);
+#endif
+    }
+
     ~mutex() noexcept(false)
     {
         auto ret = pthread_mutex_destroy(&mutex_handle);
@@ -280,6 +322,14 @@ class mutex {
 
     void lock()
     {
+#ifdef NETSKETCH_LOCKPROF
+        if (m_stats != nullptr) {
+            profiled_lock();
+
+            return;
+        }
+#endif
+
         auto ret = pthread_mutex_lock(&mutex_handle);
 
         if (ret != 0) {
@@ -292,6 +342,12 @@ class mutex {
         auto ret = pthread_mutex_trylock(&mutex_handle);
 
         if (ret == EBUSY) {
+#ifdef NETSKETCH_LOCKPROF
+            if (m_stats != nullptr) {
+                m_stats->contended();
+            }
+#endif
+
             return false;
         }
 
@@ -299,11 +355,15 @@ class mutex {
             throw std::runtime_error { strerror(ret) };
         }
 
+        reacquired();
+
         return true;
     }
 
     void unlock()
     {
+        released();
+
         auto ret = pthread_mutex_unlock(&mutex_handle);
 
         if (ret != 0) {
@@ -316,8 +376,62 @@ class mutex {
         return &mutex_handle;
     }
 
+    // NOTE: these are for locking and unlocking the mutex
+    // through its handle (like pthread_cond_wait does), which
+    // would otherwise go unnoticed by the profiler
+
+    void released()
+    {
+#ifdef NETSKETCH_LOCKPROF
+        if (m_stats != nullptr) {
+            m_stats->held(lockprof::now_ns() - m_acquired_ns);
+        }
+#endif
+    }
+
+    void reacquired()
+    {
+#ifdef NETSKETCH_LOCKPROF
+        if (m_stats != nullptr) {
+            m_stats->acquired();
+
+            m_acquired_ns = lockprof::now_ns();
+        }
+#endif
+    }
+
    private:
+#ifdef NETSKETCH_LOCKPROF
+    void profiled_lock()
+    {
+        auto ret = pthread_mutex_trylock(&mutex_handle);
+
+        if (ret == EBUSY) {
+            m_stats->contended();
+
+            uint64_t start = lockprof::now_ns();
+
+            ret = pthread_mutex_lock(&mutex_handle);
+
+            m_stats->waited(lockprof::now_ns() - start);
+        }
+
+        if (ret != 0) {
+            throw std::runtime_error { strerror(ret) };
+        }
+
+        reacquired();
+    }
+#endif
+
     pthread_mutex_t mutex_handle = PTHREAD_MUTEX_INITIALIZER;
+
+#ifdef NETSKETCH_LOCKPROF
+    lockprof::LockStats* m_stats { nullptr };
+
+    // only the holder writes (and reads) this
+    uint64_t m_acquired_ns { 0 };
+#endif
 };
 
 class mutex_guard {
@@ -412,6 +526,11 @@ class unique_mutex_guard {
         return mutex_ref.native_handle_ptr();
     }
 
+    mutex& get_mutex()
+    {
+        return mutex_ref;
+    }
+
    private:
     bool owning { false };
 
@@ -428,6 +547,9 @@ class cond_var {
         : cond_handle {
             std::exchange(other.cond_handle, PTHREAD_COND_INITIALIZER)
         }
+#ifdef NETSKETCH_LOCKPROF
+        , m_stats { std::exchange(other.m_stats, nullptr) }
+#endif
     {
     }
 
@@ -436,6 +558,10 @@ class cond_var {
         cond_handle
             = std::exchange(other.cond_handle, PTHREAD_COND_INITIALIZER);
 
+#ifdef NETSKETCH_LOCKPROF
+        m_stats = std::exchange(other.m_stats, nullptr);
+#endif
+
         return *this;
     }
 
@@ -448,6 +574,16 @@ class cond_var {
         }
     }
 
+    // NOTE: like the mutex, the name is only used when
+    // profiling lock contention
+    explicit cond_var([[maybe_unused]] const char* name)
+        : cond_var()
+    {
+#ifdef NETSKETCH_LOCKPROF
+        m_stats = lockprof::register_lock(name, lockprof::Kind::COND_VAR);
+#endif
+    }
+
     ~cond_var() noexcept(false)
     {
         auto ret = pthread_cond_destroy(&cond_handle);
@@ -477,8 +613,23 @@ class cond_var {
 
     void wait(unique_mutex_guard& lock)
     {
+        lock.get_mutex().released();
+
+#ifdef NETSKETCH_LOCKPROF
+        uint64_t start = lockprof::now_ns();
+#endif
+
         auto ret = pthread_cond_wait(&cond_handle, lock.native_handle_ptr());
 
+#ifdef NETSKETCH_LOCKPROF
+        if (m_stats != nullptr) {
+            m_stats->acquired();
+            m_stats->waited(lockprof::now_ns() - start);
+        }
+#endif
+
+        lock.get_mutex().reacquired();
+
         if (ret != 0) {
             throw std::runtime_error { strerror(ret) };
         }
@@ -487,17 +638,16 @@ class cond_var {
     void wait(unique_mutex_guard& lock, const std::function<bool()>& pred)
     {
         while (pred()) {
-            auto ret
-                = pthread_cond_wait(&cond_handle, lock.native_handle_ptr());
-
-            if (ret != 0) {
-                throw std::runtime_error { strerror(ret) };
-            }
+            wait(lock);
         }
     }
 
    private:
     pthread_cond_t cond_handle = PTHREAD_COND_INITIALIZER;
+
+#ifdef NETSKETCH_LOCKPROF
+    lockprof::LockStats* m_stats { nullptr };
+#endif
 };
 
 class rwlock {
@@ -510,6 +660,10 @@ class rwlock {
         : rwlock_handle {
             std::exchange(other.rwlock_handle, PTHREAD_RWLOCK_INITIALIZER)
         }
+#ifdef NETSKETCH_LOCKPROF
+        , m_read_stats { std::exchange(other.m_read_stats, nullptr) }
+        , m_write_stats { std::exchange(other.m_write_stats, nullptr) }
+#endif
     {
     }
 
@@ -518,6 +672,11 @@ class rwlock {
         rwlock_handle
             = std::exchange(other.rwlock_handle, PTHREAD_RWLOCK_INITIALIZER);
 
+#ifdef NETSKETCH_LOCKPROF
+        m_read_stats = std::exchange(other.m_read_stats, nullptr);
+        m_write_stats = std::exchange(other.m_write_stats, nullptr);
+#endif
+
         return *this;
     }
 
@@ -530,6 +689,18 @@ class rwlock {
         }
     }
 
+    // NOTE: like the mutex, the name is only used when
+    // profiling lock contention (reads and writes are reported
+    // separately)
+    explicit rwlock([[maybe_unused]] const char* name)
+        : rwlock()
+    {
+#ifdef NETSKETCH_LOCKPROF
+        m_read_stats = lockprof::register_lock(name, lockprof::Kind::READ);
+        m_write_stats = lockprof::register_lock(name, lockprof::Kind::WRITE);
+#endif
+    }
+
     ~rwlock() noexcept(false)
     {
         auto ret = pthread_rwlock_destroy(&rwlock_handle);
@@ -541,6 +712,14 @@ class rwlock {
 
     void rdlock()
     {
+#ifdef NETSKETCH_LOCKPROF
+        if (m_read_stats != nullptr) {
+            profiled_lock(false);
+
+            return;
+        }
+#endif
+
         auto ret = pthread_rwlock_rdlock(&rwlock_handle);
 
         if (ret != 0) {
@@ -553,6 +732,12 @@ class rwlock {
         auto ret = pthread_rwlock_tryrdlock(&rwlock_handle);
 
         if (ret == EBUSY) {
+#ifdef NETSKETCH_LOCKPROF
+            if (m_read_stats != nullptr) {
+                m_read_stats->contended();
+            }
+#endif
+
             return false;
         }
 
@@ -560,11 +745,25 @@ class rwlock {
             throw std::runtime_error { strerror(ret) };
         }
 
+#ifdef NETSKETCH_LOCKPROF
+        if (m_read_stats != nullptr) {
+            acquired(false);
+        }
+#endif
+
         return true;
     }
 
     void wrlock()
     {
+#ifdef NETSKETCH_LOCKPROF
+        if (m_write_stats != nullptr) {
+            profiled_lock(true);
+
+            return;
+        }
+#endif
+
         auto ret = pthread_rwlock_wrlock(&rwlock_handle);
 
         if (ret != 0) {
@@ -577,6 +776,12 @@ class rwlock {
         auto ret = pthread_rwlock_trywrlock(&rwlock_handle);
 
         if (ret == EBUSY) {
+#ifdef NETSKETCH_LOCKPROF
+            if (m_write_stats != nullptr) {
+                m_write_stats->contended();
+            }
+#endif
+
             return false;
         }
 
@@ -584,11 +789,31 @@ class rwlock {
             throw std::runtime_error { strerror(ret) };
         }
 
+#ifdef NETSKETCH_LOCKPROF
+        if (m_write_stats != nullptr) {
+            acquired(true);
+        }
+#endif
+
         return true;
     }
 
     void unlock()
     {
+#ifdef NETSKETCH_LOCKPROF
+        // NOTE: no one else can hold the lock while it is
+        // written, so if it is being written this must be the
+        // writer unlocking it
+        if (m_write_stats != nullptr
+            && m_is_written.load(std::memory_order_relaxed)) {
+            m_is_written.store(false, std::memory_order_relaxed);
+
+            m_write_stats->held(lockprof::now_ns() - m_written_ns);
+        } else if (m_read_stats != nullptr) {
+            m_read_stats->held(lockprof::read_released(this));
+        }
+#endif
+
         auto ret = pthread_rwlock_unlock(&rwlock_handle);
 
         if (ret != 0) {
@@ -602,7 +827,58 @@ class rwlock {
     }
 
    private:
+#ifdef NETSKETCH_LOCKPROF
+    void profiled_lock(bool is_write)
+    {
+        auto* stats = is_write ? m_write_stats : m_read_stats;
+
+        auto ret = is_write ? pthread_rwlock_trywrlock(&rwlock_handle)
+                            : pthread_rwlock_tryrdlock(&rwlock_handle);
+
+        if (ret == EBUSY) {
+            stats->contended();
+
+            uint64_t start = lockprof::now_ns();
+
+            ret = is_write ? pthread_rwlock_wrlock(&rwlock_handle)
+                           : pthread_rwlock_rdlock(&rwlock_handle);
+
+            stats->waited(lockprof::now_ns() - start);
+        }
+
+        if (ret != 0) {
+            throw std::runtime_error { strerror(ret) };
+        }
+
+        acquired(is_write);
+    }
+
+    void acquired(bool is_write)
+    {
+        if (is_write) {
+            m_write_stats->acquired();
+
+            m_written_ns = lockprof::now_ns();
+
+            m_is_written.store(true, std::memory_order_relaxed);
+        } else {
+            m_read_stats->acquired();
+
+            lockprof::read_acquired(this);
+        }
+    }
+#endif
+
     pthread_rwlock_t rwlock_handle = PTHREAD_RWLOCK_INITIALIZER;
+
+#ifdef NETSKETCH_LOCKPROF
+    lockprof::LockStats* m_read_stats { nullptr };
+    lockprof::LockStats* m_write_stats { nullptr };
+
+    // only the writer writes these
+    std::atomic<bool> m_is_written { false };
+    uint64_t m_written_ns { 0 };
+#endif
 };
 
 class rwlock_rdguard {
@@ -799,4 +1075,496 @@ class unique_rwlock_wrguard {
     rwlock& rwlock_ref;
 };
 
+// An event is a counter (an eventfd) a thread can block on until
+// another thread notifies it. Blocking on it reads from the
+// eventfd, so unlike a futex it is a cancellation point and a
+// thread blocked on it can be cancelled like one blocked on a
+// condition variable.
+
+class event {
+   public:
+    // NOTE: as a semaphore every notification wakes a single
+    // waiter, otherwise a waiter takes all of the notifications
+    explicit event(bool is_semaphore = false)
+        : m_fd { eventfd(0, EFD_CLOEXEC | (is_semaphore ? EFD_SEMAPHORE : 0)) }
+    {
+        if (m_fd == -1) {
+            throw std::runtime_error { strerror(errno) };
+        }
+    }
+
+    event(const event&) = delete;
+
+    event& operator=(const event&) = delete;
+
+    ~event()
+    {
+        ::close(m_fd);
+    }
+
+    void notify()
+    {
+        uint64_t count { 1 };
+
+        while (::write(m_fd, &count, sizeof(count)) == -1) {
+            if (errno != EINTR) {
+                throw std::runtime_error { strerror(errno) };
+            }
+        }
+    }
+
+    void wait()
+    {
+        uint64_t count { 0 };
+
+        while (::read(m_fd, &count, sizeof(count)) == -1) {
+            if (errno != EINTR) {
+                throw std::runtime_error { strerror(errno) };
+            }
+        }
+    }
+
+    [[nodiscard]] int native_handle() const
+    {
+        return m_fd;
+    }
+
+   private:
+    int m_fd { -1 };
+};
+
+namespace details {
+    // Where the threads waiting on a queue (to become non-empty
+    // or non-full) block. A thread only blocks after announcing
+    // itself and checking the queue once more, and the other side
+    // only notifies when someone has announced themselves, so the
+    // side which does not have to wait never makes a system call.
+    // Every notification claims one of the announced threads, so
+    // a thread which is already being woken up is not notified
+    // again.
+    //
+    // NOTE: both sides fence between their store (announcing or
+    // pushing) and their load (checking the queue or checking for
+    // waiters), so at least one of them sees the other's store
+    // and a wake up can not be lost
+
+    class parking {
+       public:
+        parking() = default;
+
+        template <typename Predicate>
+        void park(const Predicate& is_ready)
+        {
+            m_parked.fetch_add(1, std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (is_ready()) {
+                // NOTE: if every announced thread has been claimed,
+                // so has this one and the notification it was sent
+                // has to be taken
+                if (!claim()) {
+                    m_event.wait();
+                }
+
+                return;
+            }
+
+            pthread_cleanup_push(
+                [](void* untyped_self) {
+                    static_cast<parking*>(untyped_self)->claim();
+                },
+                this
+            );
+
+            m_event.wait();
+
+            pthread_cleanup_pop(0);
+        }
+
+        void unpark()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (m_parked.load(std::memory_order_relaxed) > 0 && claim()) {
+                m_event.notify();
+            }
+        }
+
+       private:
+        bool claim()
+        {
+            uint32_t parked = m_parked.load(std::memory_order_relaxed);
+
+            while (parked > 0) {
+                if (m_parked.compare_exchange_weak(
+                        parked,
+                        parked - 1,
+                        std::memory_order_relaxed
+                    )) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // every notification wakes a single thread
+        event m_event { true };
+
+        std::atomic<uint32_t> m_parked { 0 };
+    };
+
+    // tells the CPU we are spinning
+    inline void relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    inline size_t round_up_to_power_of_two(size_t value)
+    {
+        size_t power { 1 };
+
+        while (power < value) {
+            power <<= 1;
+        }
+
+        return power;
+    }
+} // namespace details
+
+// A bounded lock-free queue with many producers and a single
+// consumer. The cells of the ring carry a sequence number which
+// tells whether they are free to be written (for a given lap of
+// the ring) or hold a value waiting to be read, so producers
+// only contend on claiming a position and never on a lock.
+//
+// push and pop block (on an event) when the queue is full or
+// empty, the other side only makes a system call to wake them
+// when someone is actually blocked.
+//
+// NOTE: the capacity is rounded up to a power of two and the
+// values have to be default constructible, as every cell holds
+// one (moved out when popped)
+
+// ATTRIBUTION
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+
+template <typename T>
+class mpsc_queue {
+   public:
+    explicit mpsc_queue(size_t capacity)
+        : m_capacity { details::round_up_to_power_of_two(capacity) }
+        , m_mask { m_capacity - 1 }
+        , m_cells { std::make_unique<cell[]>(m_capacity) }
+    {
+        for (size_t i = 0; i < m_capacity; i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    // NOTE: the value is only moved from if it was pushed
+    bool try_push(T&& value)
+    {
+        size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+
+        cell* target { nullptr };
+
+        for (;;) {
+            target = &m_cells[position & m_mask];
+
+            size_t sequence = target->sequence.load(std::memory_order_acquire);
+
+            auto difference = static_cast<std::ptrdiff_t>(sequence)
+                              - static_cast<std::ptrdiff_t>(position);
+
+            if (difference == 0) {
+                if (m_enqueue_position.compare_exchange_weak(
+                        position,
+                        position + 1,
+                        std::memory_order_relaxed
+                    )) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // the cell still holds a value from the last lap
+                return false;
+            } else {
+                position = m_enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        target->value = std::move(value);
+
+        target->sequence.store(position + 1, std::memory_order_release);
+
+        m_not_empty.unpark();
+
+        return true;
+    }
+
+    void push(T&& value)
+    {
+        for (uint32_t tries = 1; !try_push(std::move(value)); tries++) {
+            if (tries < QUEUE_SPIN_TRIES) {
+                details::relax();
+
+                continue;
+            }
+
+            m_not_full.park([this]() {
+                return size() < m_capacity;
+            });
+        }
+    }
+
+    void push(const T& value)
+    {
+        T copy = value;
+
+        push(std::move(copy));
+    }
+
+    // NOTE: only ever called by the consumer
+    bool try_pop(T& value)
+    {
+        size_t position = m_dequeue_position.load(std::memory_order_relaxed);
+
+        cell& target = m_cells[position & m_mask];
+
+        if (target.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+
+        value = std::move(target.value);
+
+        target.sequence.store(position + m_capacity, std::memory_order_release);
+
+        m_dequeue_position.store(position + 1, std::memory_order_release);
+
+        m_not_full.unpark();
+
+        return true;
+    }
+
+    T pop()
+    {
+        T value {};
+
+        for (uint32_t tries = 1; !try_pop(value); tries++) {
+            if (tries < QUEUE_SPIN_TRIES) {
+                details::relax();
+
+                continue;
+            }
+
+            m_not_empty.park([this]() {
+                size_t position
+                    = m_dequeue_position.load(std::memory_order_relaxed);
+
+                return m_cells[position & m_mask].sequence.load(
+                           std::memory_order_acquire
+                       )
+                       == position + 1;
+            });
+        }
+
+        return value;
+    }
+
+    // NOTE: only a snapshot, it can be out of date as soon as it
+    // is returned
+    [[nodiscard]] size_t size() const
+    {
+        size_t dequeue = m_dequeue_position.load(std::memory_order_acquire);
+        size_t enqueue = m_enqueue_position.load(std::memory_order_acquire);
+
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return size() == 0;
+    }
+
+    [[nodiscard]] size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+   private:
+    struct cell {
+        std::atomic<size_t> sequence { 0 };
+
+        T value {};
+    };
+
+    size_t m_capacity { 0 };
+    size_t m_mask { 0 };
+
+    std::unique_ptr<cell[]> m_cells {};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueue_position { 0 };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeue_position { 0 };
+
+    details::parking m_not_empty {};
+
+    // NOTE: many producers can be waiting for room at once
+    details::parking m_not_full {};
+};
+
+// A bounded lock-free queue with a single producer and a single
+// consumer (a Lamport ring buffer). Each side only ever writes
+// its own index and keeps a cached copy of the other side's
+// index, which it only reloads when the ring looks full (or
+// empty), so the two sides rarely touch the same cache line.
+// Blocking works like it does for the mpsc_queue.
+
+template <typename T>
+class spsc_queue {
+   public:
+    explicit spsc_queue(size_t capacity)
+        : m_capacity { details::round_up_to_power_of_two(capacity) }
+        , m_mask { m_capacity - 1 }
+        , m_slots { std::make_unique<T[]>(m_capacity) }
+    {
+    }
+
+    spsc_queue(const spsc_queue&) = delete;
+
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    // NOTE: only ever called by the producer, the value is only
+    // moved from if it was pushed
+    bool try_push(T&& value)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_cached_head == m_capacity) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+
+            if (tail - m_cached_head == m_capacity) {
+                return false;
+            }
+        }
+
+        m_slots[tail & m_mask] = std::move(value);
+
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        m_not_empty.unpark();
+
+        return true;
+    }
+
+    void push(T&& value)
+    {
+        for (uint32_t tries = 1; !try_push(std::move(value)); tries++) {
+            if (tries < QUEUE_SPIN_TRIES) {
+                details::relax();
+
+                continue;
+            }
+
+            m_not_full.park([this]() {
+                return size() < m_capacity;
+            });
+        }
+    }
+
+    void push(const T& value)
+    {
+        T copy = value;
+
+        push(std::move(copy));
+    }
+
+    // NOTE: only ever called by the consumer
+    bool try_pop(T& value)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_cached_tail) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+
+            if (head == m_cached_tail) {
+                return false;
+            }
+        }
+
+        value = std::move(m_slots[head & m_mask]);
+
+        m_head.store(head + 1, std::memory_order_release);
+
+        m_not_full.unpark();
+
+        return true;
+    }
+
+    T pop()
+    {
+        T value {};
+
+        for (uint32_t tries = 1; !try_pop(value); tries++) {
+            if (tries < QUEUE_SPIN_TRIES) {
+                details::relax();
+
+                continue;
+            }
+
+            m_not_empty.park([this]() {
+                return !empty();
+            });
+        }
+
+        return value;
+    }
+
+    // NOTE: only a snapshot, it can be out of date as soon as it
+    // is returned
+    [[nodiscard]] size_t size() const
+    {
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+
+        return tail > head ? tail - head : 0;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return size() == 0;
+    }
+
+    [[nodiscard]] size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+   private:
+    size_t m_capacity { 0 };
+    size_t m_mask { 0 };
+
+    std::unique_ptr<T[]> m_slots {};
+
+    // written by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail { 0 };
+    size_t m_cached_head { 0 };
+
+    // written by the consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head { 0 };
+    size_t m_cached_tail { 0 };
+
+    details::parking m_not_empty {};
+    details::parking m_not_full {};
+};
+
 } // namespace threading
@@ -0,0 +1,134 @@
+#pragma once
+
+// common
+#include "bytes.hpp"
+
+// cereal
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+
+// cstd
+#include <cstdint>
+#include <cstdio>
+
+// std
+#include <fstream>
+#include <string>
+#include <vector>
+
+// fmt
+#include <fmt/core.h>
+
+// A trace is a recording of all the traffic a server
+// received. The file starts off with a TraceHeader which is
+// followed by TraceEvents (in the order in which they
+// happened) up until the end of the file, all of them written
+// out through a single portable binary archive.
+
+#define TRACE_MAGIC (0x4E535452) // NSTR
+
+// NOTE: the frames are kept as they were received, so this has
+// to change along with the layout of any payload a client sends
+// (whether or not the version of the protocol changes)
+//
+// 1: the first version
+// 2: draws and actions are tagged with user identifiers rather
+//    than usernames
+// 3: action batches are in the compact encoding
+// 4: draws can be strokes
+#define TRACE_VERSION (4)
+
+struct TraceHeader {
+    uint32_t magic { TRACE_MAGIC };
+    uint16_t version { TRACE_VERSION };
+
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(magic, version);
+    }
+};
+
+enum class TraceEventType : uint8_t {
+    CONNECT,
+    FRAME,
+    DISCONNECT,
+};
+
+struct TraceEvent {
+    TraceEventType type { TraceEventType::FRAME };
+
+    // microseconds since the recording started
+    uint64_t at_us { 0 };
+
+    // identifies a connection within a single trace (unlike
+    // file descriptors these are never reused)
+    uint32_t connection { 0 };
+
+    // the username of a CONNECT and the (unframed) payload of
+    // a FRAME, empty otherwise
+    ByteString data {};
+
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(type, at_us, connection, data);
+    }
+};
+
+// NOTE: a server which was killed might leave a trace with a
+// partially written event at the end, in which case all the
+// events before it are still returned
+
+inline bool read_trace(const std::string& path, std::vector<TraceEvent>& events)
+{
+    std::ifstream file { path, std::ios::binary };
+
+    if (!file) {
+        fmt::println(stderr, "error: could not open {}", path);
+
+        return false;
+    }
+
+    try {
+        cereal::PortableBinaryInputArchive archive { file };
+
+        TraceHeader header {};
+
+        archive(header);
+
+        if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) {
+            fmt::println(stderr, "error: {} is not a (supported) trace", path);
+
+            return false;
+        }
+
+        while (file.peek() != std::ifstream::traits_type::eof()) {
+            TraceEvent event {};
+
+            archive(event);
+
+            events.push_back(std::move(event));
+        }
+    } catch (std::exception& error) {
+        if (events.empty()) {
+            fmt::println(
+                stderr,
+                "error: could not read {}, reason {}",
+                path,
+                error.what()
+            );
+
+            return false;
+        }
+
+        fmt::println(
+            stderr,
+            "warn: {} is truncated after {} events",
+            path,
+            events.size()
+        );
+    }
+
+    return true;
+}
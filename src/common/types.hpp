@@ -1,10 +1,12 @@
 #pragma once
 
 // cstd
+#include <cstddef>
 #include <cstdint>
 
 // std
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -80,11 +82,41 @@ struct TextDraw {
     }
 };
 
+// A freehand stroke, i.e. a polyline through any number of
+// points. Only the first point is kept as is, every other point
+// is kept as its offset from the point before it (a pair of
+// zig-zag encoded varints, please look at common/stroke.hpp),
+// so a point takes two or three bytes rather than the whole
+// LineDraw (and tagged draw) a segment used to take.
+//
+// NOTE: the points are checked when the stroke is read (which
+// is why it declares a save and load rather than a serialize)
+struct StrokeDraw {
+    Colour colour {};
+    uint8_t width { 1 };
+    int x { 0 };
+    int y { 0 };
+    std::string points {};
+
+    template <class Archive>
+    void save(Archive& archive) const;
+
+    template <class Archive>
+    void load(Archive& archive);
+};
+
+// The largest number of points a stroke can have, a longer
+// stroke has to be split up
+#define STROKE_MAX_POINTS (4096)
+
+// NOTE: new kinds of draws have to be added at the end, the
+// index of the kind is what goes on the wire
 using Draw = std::variant<
     LineDraw,
     RectangleDraw,
     CircleDraw,
-    TextDraw
+    TextDraw,
+    StrokeDraw
 >;
 
 struct Select {
@@ -132,45 +164,120 @@ struct Clear {
 
 using Action = std::variant<Draw, Select, Delete, Undo, Clear>;
 
+// The server hands out a small identifier for every username
+// when it is first seen (and keeps it for as long as it runs),
+// everything which belongs to a user is tagged with it rather
+// than with the username itself. The usernames are announced
+// separately (please look at UserNames).
+using UserId = std::uint32_t;
+
 struct TaggedAction {
-    std::string username {};
+    // NOTE: the server overwrites this with the user of the
+    // connection the action arrived on
+    UserId user { 0 };
     Action action {};
 
+    // An opaque timestamp set by the sender (the server just
+    // passes it along), it is used by the test client to
+    // measure end-to-end latencies. Zero means it is unset.
+    std::uint64_t sent_at { 0 };
+
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(username, action);
+        archive(user, action, sent_at);
     }
 };
 
 struct TaggedDraw {
     bool adopted {};
-    std::string username {};
+    UserId user { 0 };
     Draw draw {};
 
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(adopted, username, draw);
+        archive(adopted, user, draw);
     }
 };
 
 using TaggedDrawVector = std::vector<TaggedDraw>;
 
+// The whole canvas, which is what a new connection is sent.
+// It is written in the compact encoding (common/compact.hpp)
+// unless the connection did not settle on it.
+struct Snapshot {
+    TaggedDrawVector draws {};
+    bool compact { true };
+
+    template <class Archive>
+    void save(Archive& archive) const;
+
+    template <class Archive>
+    void load(Archive& archive);
+};
+
+// The versions of the protocol this build speaks, both sides
+// of a connection settle on the highest version they share
+#define PROTOCOL_VERSION_MIN (1)
+#define PROTOCOL_VERSION_MAX (1)
+
+using ProtocolVersion = std::uint16_t;
+
+// The optional features of the protocol, the handshake settles
+// on the ones both sides have (and neither side makes use of a
+// feature the other side does not have)
+using Capabilities = std::uint32_t;
+
+// large frames can be compressed (common/compression.hpp)
+#define CAPABILITY_COMPRESSION (Capabilities { 1 } << 0)
+// many actions can be sent in an action batch (which is
+// always in the compact encoding)
+#define CAPABILITY_BATCHING (Capabilities { 1 } << 1)
+// the snapshot is in the compact encoding
+#define CAPABILITY_COMPACT (Capabilities { 1 } << 2)
+// reconnecting only fetches what changed while disconnected
+//
+// NOTE: reserved, nothing speaks it yet
+#define CAPABILITY_DELTA_RESUME (Capabilities { 1 } << 3)
+// strokes can be sent (a peer without it is sent every stroke
+// as a line from its first point to its last, please look at
+// common/stroke.hpp)
+#define CAPABILITY_STROKES (Capabilities { 1 } << 4)
+
+// Everything this build has
+#define CAPABILITIES_ALL                                                       \
+    (CAPABILITY_COMPRESSION | CAPABILITY_BATCHING | CAPABILITY_COMPACT        \
+     | CAPABILITY_STROKES)
+
+// NOTE: the layout of the handshake (Username followed by
+// Accept or Decline) can never change, since it is how both
+// sides find out which version the other speaks
+
 struct Username {
     std::string username {};
+    ProtocolVersion version_min { PROTOCOL_VERSION_MIN };
+    ProtocolVersion version_max { PROTOCOL_VERSION_MAX };
+    Capabilities capabilities { CAPABILITIES_ALL };
 
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(username);
+        archive(username, version_min, version_max, capabilities);
     }
 };
 
 struct Accept {
+    // the identifier the server gave the user
+    UserId user { 0 };
+    // what the connection settled on
+    ProtocolVersion version { PROTOCOL_VERSION_MAX };
+    Capabilities capabilities { 0 };
+
     template <class Archive>
-    void serialize(Archive&)
+    void serialize(Archive& archive)
     {
+        archive(user, version, capabilities);
     }
 };
 
@@ -185,14 +292,95 @@ struct Decline {
 };
 
 struct Adopt {
+    UserId user { 0 };
+
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(user);
+    }
+};
+
+struct UserName {
+    UserId user { 0 };
     std::string username {};
 
     template <class Archive>
     void serialize(Archive& archive)
     {
-        archive(username);
+        archive(user, username);
     }
 };
 
-using Payload = std::
-    variant<TaggedAction, TaggedDrawVector, Username, Accept, Decline, Adopt>;
+// Which username every identifier stands for. A new connection
+// is sent all of them (before the canvas), after which only the
+// usernames which are new are sent out.
+struct UserNames {
+    std::vector<UserName> names {};
+
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(names);
+    }
+};
+
+// The largest number of pending actions a writer packs into a
+// single batch
+#define ACTION_BATCH_LIMIT (64)
+
+struct BatchedAction {
+    Action action {};
+    std::uint64_t sent_at { 0 };
+
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(action, sent_at);
+    }
+};
+
+// Many actions of the same user in a single frame, which saves
+// the header and the user of every action but the first.
+// Applying a batch is the same as applying its actions (as
+// tagged actions) one after the other. The actions are written
+// in the compact encoding (common/compact.hpp).
+struct ActionBatch {
+    UserId user { 0 };
+    std::vector<BatchedAction> actions {};
+
+    [[nodiscard]] TaggedAction at(std::size_t index) const
+    {
+        return { user, actions[index].action, actions[index].sent_at };
+    }
+
+    template <class Archive>
+    void save(Archive& archive) const;
+
+    template <class Archive>
+    void load(Archive& archive);
+};
+
+// NOTE: new payload types have to be added at the end, the
+// index of the type is what goes on the wire
+using Payload = std::variant<
+    TaggedAction,
+    Snapshot,
+    Username,
+    Accept,
+    Decline,
+    Adopt,
+    ActionBatch,
+    UserNames>;
+
+// A batch of a single action is sent as a plain tagged action
+inline Payload to_payload(ActionBatch batch)
+{
+    if (batch.actions.size() == 1) {
+        return TaggedAction { batch.user,
+                              std::move(batch.actions.front().action),
+                              batch.actions.front().sent_at };
+    }
+
+    return Payload { std::move(batch) };
+}
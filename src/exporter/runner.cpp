@@ -1,10 +1,12 @@
 #include "runner.hpp"
 
 // std
+#include <algorithm>
 #include <variant>
 
 // common
 #include "../common/overload.hpp"
+#include "../common/stroke.hpp"
 #include "../common/types.hpp"
 
 // cstd
@@ -135,37 +137,44 @@ bool Runner::setup(
 
 [[nodiscard]] bool Runner::run()
 {
-    // read full list
+    // read full list (the usernames are sent before it, but
+    // they are not needed)
 
-    auto [bytes, read_status] = m_channel.read();
+    Payload payload {};
 
-    if (read_status != ChannelErrorCode::OK) {
-        fmt::println(
-            stderr,
-            "error: reading failed, reason {}",
-            read_status.what()
-        );
+    do {
+        auto [bytes, read_status] = m_channel.read();
 
-        return false;
-    }
+        if (read_status != ChannelErrorCode::OK) {
+            fmt::println(
+                stderr,
+                "error: reading failed, reason {}",
+                read_status.what()
+            );
 
-    // deserialize
+            return false;
+        }
 
-    auto [payload, deser_status] = deserialize<Payload>(bytes);
+        // deserialize
 
-    if (deser_status != DeserializeErrorCode::OK) {
-        fmt::println(
-            stderr,
-            "error: deserialization failed, reason {}",
-            deser_status.what()
-        );
+        auto [deserialized, deser_status] = deserialize<Payload>(bytes);
 
-        return false;
-    }
+        if (deser_status != DeserializeErrorCode::OK) {
+            fmt::println(
+                stderr,
+                "error: deserialization failed, reason {}",
+                deser_status.what()
+            );
+
+            return false;
+        }
+
+        payload = std::move(deserialized);
+    } while (std::holds_alternative<UserNames>(payload));
 
     // convert to list
 
-    if (!std::holds_alternative<TaggedDrawVector>(payload)) {
+    if (!std::holds_alternative<Snapshot>(payload)) {
         fmt::println(
             stderr,
             "error: unexpected type {}",
@@ -175,7 +184,7 @@ bool Runner::setup(
         return false;
     }
 
-    TaggedDrawVector draws = std::get<TaggedDrawVector>(payload);
+    TaggedDrawVector draws = std::move(std::get<Snapshot>(payload).draws);
 
     // generate image
     if (!generate_image(draws)) {
@@ -236,6 +245,39 @@ void process_draw(Image* image, Draw& draw)
                     to_raylib_colour(arg.colour)
                 );
             },
+            [image](StrokeDraw& arg) {
+                Color colour = to_raylib_colour(arg.colour);
+
+                int width = std::max<int>(arg.width, 1);
+
+                int x0 = arg.x;
+                int y0 = arg.y;
+
+                // NOTE: raylib can only draw lines a pixel thick
+                // onto an image, so a wider segment is drawn as
+                // that many lines side by side (shifted across
+                // whichever axis the segment runs along less)
+                stroke::for_each_point(arg, [&](int x1, int y1) {
+                    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+
+                    for (int i = -(width - 1) / 2; i <= width / 2; i++) {
+                        int dx = steep ? i : 0;
+                        int dy = steep ? 0 : i;
+
+                        ImageDrawLine(
+                            image,
+                            x0 + dx,
+                            y0 + dy,
+                            x1 + dx,
+                            y1 + dy,
+                            colour
+                        );
+                    }
+
+                    x0 = x1;
+                    y0 = y1;
+                });
+            },
         },
         draw
     );
@@ -0,0 +1,14 @@
+#pragma once
+
+// microbench
+#include "harness.hpp"
+
+namespace microbench {
+
+void add_codec_benchmarks(Harness& harness);
+
+void add_channel_benchmarks(Harness& harness);
+
+void add_canvas_benchmarks(Harness& harness);
+
+} // namespace microbench
@@ -0,0 +1,185 @@
+// microbench
+#include "benchmarks.hpp"
+#include "fixtures.hpp"
+
+// common
+#include "../common/tagged_draw_vector_wrapper.hpp"
+#include "../common/types.hpp"
+
+// fmt
+#include <fmt/core.h>
+
+namespace microbench {
+
+void add_canvas_benchmarks(Harness& harness)
+{
+    for (size_t size : { 100, 1000, 10000, 100000 }) {
+        // NOTE: the canvas is shared by all the samples of a
+        // benchmark, every benchmark leaves it as it found it
+        // (outside of the timed region)
+        auto canvas = std::make_shared<TaggedDrawVector>(fixture_canvas(size));
+
+        TaggedAction draw = fixture_action(size);
+
+        harness.add(
+            fmt::format("canvas/draw/{}", size),
+            [canvas, draw, size](Sample& sample, uint64_t iterations) {
+                TaggedDrawVectorWrapper wrapper { *canvas };
+
+                // NOTE: growing the vector is left out, otherwise
+                // the samples which happen to reallocate a large
+                // canvas dwarf the rest
+                sample.pause();
+
+                canvas->reserve(size + iterations);
+
+                sample.resume();
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    wrapper.update(draw);
+                }
+
+                sample.pause();
+
+                canvas->resize(size);
+
+                sample.resume();
+            }
+        );
+
+        harness.add(
+            fmt::format("canvas/select/{}", size),
+            [canvas, draw, size](Sample&, uint64_t iterations) {
+                TaggedDrawVectorWrapper wrapper { *canvas };
+
+                auto middle = static_cast<long>(size / 2);
+
+                TaggedDraw original = (*canvas)[static_cast<size_t>(middle)];
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    wrapper.update(TaggedAction {
+                        draw.user,
+                        Select { middle, std::get<Draw>(draw.action) } });
+                }
+
+                (*canvas)[static_cast<size_t>(middle)] = original;
+            }
+        );
+
+        harness.add(
+            fmt::format("canvas/delete/{}", size),
+            [canvas, draw, size](Sample& sample, uint64_t iterations) {
+                TaggedDrawVectorWrapper wrapper { *canvas };
+
+                auto middle = static_cast<long>(size / 2);
+
+                TaggedAction action { draw.user, Delete { middle } };
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    sample.pause();
+
+                    TaggedDraw original = (*canvas)[static_cast<size_t>(middle)];
+
+                    sample.resume();
+
+                    wrapper.update(action);
+
+                    sample.pause();
+
+                    canvas->insert(canvas->begin() + middle, std::move(original));
+
+                    sample.resume();
+                }
+            }
+        );
+
+        harness.add(
+            fmt::format("canvas/undo/{}", size),
+            [canvas](Sample& sample, uint64_t iterations) {
+                TaggedDrawVectorWrapper wrapper { *canvas };
+
+                TaggedAction action { canvas->back().user, Undo {} };
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    sample.pause();
+
+                    TaggedDraw original = canvas->back();
+
+                    sample.resume();
+
+                    wrapper.update(action);
+
+                    sample.pause();
+
+                    canvas->push_back(std::move(original));
+
+                    sample.resume();
+                }
+            }
+        );
+
+        for (auto qualifier : { Qualifier::MINE, Qualifier::ALL }) {
+            harness.add(
+                fmt::format(
+                    "canvas/clear_{}/{}",
+                    qualifier == Qualifier::MINE ? "mine" : "all",
+                    size
+                ),
+                [canvas, qualifier](Sample& sample, uint64_t iterations) {
+                    TaggedAction action { fixture_user(0),
+                                          Clear { qualifier } };
+
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        sample.pause();
+
+                        TaggedDrawVector copy = *canvas;
+
+                        sample.resume();
+
+                        TaggedDrawVectorWrapper { copy }.update(action);
+
+                        sample.pause();
+
+                        do_not_optimize(copy);
+
+                        // NOTE: destroying the copy is not part of
+                        // the operation
+                        copy = {};
+
+                        sample.resume();
+                    }
+                }
+            );
+        }
+
+        harness.add(
+            fmt::format("canvas/adopt/{}", size),
+            [canvas](Sample&, uint64_t iterations) {
+                TaggedDrawVectorWrapper wrapper { *canvas };
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    wrapper.adopt(Adopt { fixture_user(0) });
+                }
+
+                for (auto& tagged_draw : *canvas) {
+                    tagged_draw.adopted = false;
+                }
+            }
+        );
+
+        harness.add(
+            fmt::format("canvas/hash/{}", size),
+            [canvas](Sample&, uint64_t iterations) {
+                TaggedDrawVectorWrapper wrapper { *canvas };
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    auto hash = wrapper.hash();
+
+                    do_not_optimize(hash);
+                }
+            }
+        );
+    }
+}
+
+} // namespace microbench
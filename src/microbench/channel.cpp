@@ -0,0 +1,210 @@
+// microbench
+#include "benchmarks.hpp"
+#include "fixtures.hpp"
+
+// common
+#include "../common/abort.hpp"
+#include "../common/channel.hpp"
+#include "../common/compression.hpp"
+#include "../common/network.hpp"
+#include "../common/threading.hpp"
+
+// unix
+#include <sys/socket.h>
+#include <unistd.h>
+
+// cstd
+#include <cerrno>
+#include <cstring>
+
+// std
+#include <memory>
+
+// fmt
+#include <fmt/core.h>
+
+namespace microbench {
+
+// Both ends of a socketpair, the channels are what the server
+// and the clients use over TCP, a socketpair keeps the network
+// stack (mostly) out of the measurements
+struct ChannelPair {
+    ChannelPair()
+    {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+            ABORTV("socketpair(): {}", strerror(errno));
+        }
+
+        // NOTE: writing and reading on the same thread only
+        // works if the whole packet fits in the socket buffer
+        int size = 4 << 20;
+
+        for (int fd : fds) {
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        }
+
+        first = IPv4SocketRef { fds[0] };
+        second = IPv4SocketRef { fds[1] };
+    }
+
+    ChannelPair(const ChannelPair&) = delete;
+
+    ChannelPair& operator=(const ChannelPair&) = delete;
+
+    ~ChannelPair()
+    {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    int fds[2] { -1, -1 };
+
+    IPv4SocketRef first {};
+    IPv4SocketRef second {};
+};
+
+// echoes back every packet until the other end shuts down
+class Echo {
+   public:
+    explicit Echo(IPv4SocketRef sock)
+        : m_sock(sock)
+    {
+    }
+
+    void operator()()
+    {
+        Channel channel { m_sock };
+
+        for (;;) {
+            auto [bytes, status] = channel.read();
+
+            if (status != ChannelErrorCode::OK) {
+                break;
+            }
+
+            if (channel.write(bytes) != ChannelErrorCode::OK) {
+                break;
+            }
+        }
+    }
+
+   private:
+    IPv4SocketRef m_sock {};
+};
+
+void add_channel_benchmarks(Harness& harness)
+{
+    for (size_t size : { 64, 4096, 65536 }) {
+        harness.add(
+            fmt::format("channel/write_read/{}", size),
+            [size](Sample& sample, uint64_t iterations) {
+                sample.pause();
+
+                auto pair = std::make_unique<ChannelPair>();
+
+                Channel writer { pair->first };
+                Channel reader { pair->second };
+
+                ByteString payload(size, 'x');
+
+                sample.resume();
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    if (writer.write(payload) != ChannelErrorCode::OK) {
+                        ABORT("writing failed");
+                    }
+
+                    auto [bytes, status] = reader.read();
+
+                    if (status != ChannelErrorCode::OK) {
+                        ABORT("reading failed");
+                    }
+
+                    do_not_optimize(bytes);
+                }
+            },
+            size
+        );
+    }
+
+    for (size_t size : { 64, 65536, 1 << 20 }) {
+        harness.add(
+            fmt::format("channel/round_trip/{}", size),
+            [size](Sample& sample, uint64_t iterations) {
+                sample.pause();
+
+                auto pair = std::make_unique<ChannelPair>();
+
+                threading::thread echo { Echo { pair->second } };
+
+                Channel channel { pair->first };
+
+                ByteString payload(size, 'x');
+
+                sample.resume();
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    if (channel.write(payload) != ChannelErrorCode::OK) {
+                        ABORT("writing failed");
+                    }
+
+                    auto [bytes, status] = channel.read();
+
+                    if (status != ChannelErrorCode::OK) {
+                        ABORT("reading failed");
+                    }
+
+                    do_not_optimize(bytes);
+                }
+
+                sample.pause();
+
+                shutdown(pair->fds[0], SHUT_WR);
+
+                echo.join();
+
+                sample.resume();
+            },
+            2 * size
+        );
+    }
+
+    // NOTE: the snapshots are what gets compressed in practice
+    for (size_t size : { 1000, 10000 }) {
+        ByteString payload
+            = serialize<Payload>(Payload { Snapshot { fixture_canvas(size) } });
+
+        ByteString compressed = compression::compress(payload);
+
+        harness.add(
+            fmt::format("channel/compress/snapshot/{}", size),
+            [payload](Sample&, uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    ByteString result = compression::compress(payload);
+
+                    do_not_optimize(result);
+                }
+            },
+            payload.size()
+        );
+
+        harness.add(
+            fmt::format("channel/decompress/snapshot/{}", size),
+            [compressed](Sample&, uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    auto result = compression::decompress(compressed);
+
+                    if (!result) {
+                        ABORT("decompressing failed");
+                    }
+
+                    do_not_optimize(result);
+                }
+            },
+            payload.size()
+        );
+    }
+}
+
+} // namespace microbench
@@ -0,0 +1,101 @@
+// microbench
+#include "benchmarks.hpp"
+#include "fixtures.hpp"
+
+// common
+#include "../common/serial.hpp"
+#include "../common/types.hpp"
+
+// std
+#include <utility>
+#include <vector>
+
+// fmt
+#include <fmt/core.h>
+
+namespace microbench {
+
+// adds a serialize and a deserialize benchmark for a payload
+static void add_payload(Harness& harness, const std::string& name, Payload payload)
+{
+    ByteString bytes = serialize<Payload>(payload);
+
+    harness.add(
+        fmt::format("codec/serialize/{}", name),
+        [payload](Sample&, uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                ByteString result = serialize<Payload>(payload);
+
+                do_not_optimize(result);
+            }
+        },
+        bytes.size()
+    );
+
+    harness.add(
+        fmt::format("codec/deserialize/{}", name),
+        [bytes](Sample&, uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                auto result = deserialize<Payload>(bytes);
+
+                do_not_optimize(result);
+            }
+        },
+        bytes.size()
+    );
+}
+
+void add_codec_benchmarks(Harness& harness)
+{
+    TaggedAction line = fixture_action(0);
+    TaggedAction text = fixture_action(3);
+
+    add_payload(harness, "tagged_action_line", line);
+    add_payload(harness, "tagged_action_text", text);
+    add_payload(harness, "tagged_action_stroke", fixture_stroke(128));
+    add_payload(
+        harness,
+        "tagged_action_undo",
+        TaggedAction { fixture_user(0), Undo {} }
+    );
+    add_payload(
+        harness,
+        "tagged_action_clear",
+        TaggedAction { fixture_user(0), Clear { Qualifier::MINE } }
+    );
+
+    for (size_t size : { 100, 1000, 10000 }) {
+        add_payload(
+            harness,
+            fmt::format("tagged_draw_vector/{}", size),
+            Snapshot { fixture_canvas(size) }
+        );
+    }
+
+    ActionBatch batch { fixture_user(0) };
+
+    for (size_t i = 0; i < ACTION_BATCH_LIMIT; i++) {
+        TaggedAction action = fixture_action(i);
+
+        batch.actions.push_back(BatchedAction { action.action, action.sent_at });
+    }
+
+    add_payload(harness, fmt::format("action_batch/{}", ACTION_BATCH_LIMIT), batch);
+
+    add_payload(harness, "username", Username { fixture_username(0) });
+    add_payload(harness, "accept", Accept { fixture_user(0) });
+    add_payload(harness, "decline", Decline { "user0 already exists" });
+    add_payload(harness, "adopt", Adopt { fixture_user(0) });
+
+    UserNames user_names {};
+
+    for (size_t i = 0; i < FIXTURE_USERS; i++) {
+        user_names.names.push_back(
+            UserName { fixture_user(i), fixture_username(i) }
+        );
+    }
+
+    add_payload(harness, "user_names", user_names);
+}
+
+} // namespace microbench
@@ -0,0 +1,103 @@
+// microbench
+#include "fixtures.hpp"
+
+// common
+#include "../common/stroke.hpp"
+
+// std
+#include <random>
+
+// fmt
+#include <fmt/core.h>
+
+namespace microbench {
+
+std::string fixture_username(size_t index)
+{
+    return fmt::format("user{}", index % FIXTURE_USERS);
+}
+
+UserId fixture_user(size_t index)
+{
+    return static_cast<UserId>(index % FIXTURE_USERS);
+}
+
+static Draw fixture_draw(std::mt19937& mt, size_t index)
+{
+    std::uniform_int_distribution<int> coord_dist { -2000, 2000 };
+    std::uniform_int_distribution<int> channel_dist { 0, 255 };
+
+    Colour colour { static_cast<uint8_t>(channel_dist(mt)),
+                    static_cast<uint8_t>(channel_dist(mt)),
+                    static_cast<uint8_t>(channel_dist(mt)) };
+
+    switch (index % 4) {
+    case 0:
+        return LineDraw { colour,
+                          coord_dist(mt),
+                          coord_dist(mt),
+                          coord_dist(mt),
+                          coord_dist(mt) };
+    case 1:
+        return RectangleDraw { colour,
+                               coord_dist(mt),
+                               coord_dist(mt),
+                               coord_dist(mt),
+                               coord_dist(mt) };
+    case 2:
+        return CircleDraw { colour,
+                            coord_dist(mt),
+                            coord_dist(mt),
+                            static_cast<float>(channel_dist(mt)) };
+    default:
+        return TextDraw { colour,
+                          coord_dist(mt),
+                          coord_dist(mt),
+                          std::string(32, 'a') };
+    }
+}
+
+TaggedAction fixture_action(size_t index)
+{
+    std::mt19937 mt { static_cast<std::mt19937::result_type>(index) };
+
+    return TaggedAction { fixture_user(index), fixture_draw(mt, index) };
+}
+
+TaggedAction fixture_stroke(size_t points)
+{
+    std::mt19937 mt { static_cast<std::mt19937::result_type>(points) };
+
+    std::uniform_int_distribution<int> step_dist { -6, 6 };
+
+    int x { 0 };
+    int y { 0 };
+
+    stroke::Builder builder { Colour { 255, 0, 0 }, 2, x, y };
+
+    for (size_t i = 1; i < points; i++) {
+        x += step_dist(mt);
+        y += step_dist(mt);
+
+        builder.add(x, y);
+    }
+
+    return TaggedAction { fixture_user(0), Draw { builder.build() } };
+}
+
+TaggedDrawVector fixture_canvas(size_t size)
+{
+    std::mt19937 mt { 42 };
+
+    TaggedDrawVector canvas {};
+
+    canvas.reserve(size);
+
+    for (size_t i = 0; i < size; i++) {
+        canvas.push_back(TaggedDraw { false, fixture_user(i), fixture_draw(mt, i) });
+    }
+
+    return canvas;
+}
+
+} // namespace microbench
@@ -0,0 +1,31 @@
+#pragma once
+
+// common
+#include "../common/types.hpp"
+
+// std
+#include <string>
+
+// cstd
+#include <cstddef>
+
+namespace microbench {
+
+// The number of users the draws of a canvas are spread over
+#define FIXTURE_USERS (8)
+
+std::string fixture_username(size_t index);
+
+UserId fixture_user(size_t index);
+
+TaggedAction fixture_action(size_t index);
+
+// a freehand stroke through the given number of points (each a
+// few pixels away from the one before it)
+TaggedAction fixture_stroke(size_t points);
+
+// a canvas of the given size with a mix of every kind of draw
+// (the same one every time)
+TaggedDrawVector fixture_canvas(size_t size);
+
+} // namespace microbench
@@ -0,0 +1,315 @@
+// microbench
+#include "harness.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <regex>
+
+// fmt
+#include <fmt/core.h>
+
+namespace microbench {
+
+void Sample::pause()
+{
+    m_elapsed += Clock::now() - m_resumed_at;
+
+    m_is_running = false;
+}
+
+void Sample::resume()
+{
+    m_is_running = true;
+
+    m_resumed_at = Clock::now();
+}
+
+Sample::Clock::duration Sample::elapsed() const
+{
+    return m_elapsed;
+}
+
+void Sample::start()
+{
+    m_elapsed = {};
+
+    resume();
+}
+
+void Sample::stop()
+{
+    if (m_is_running) {
+        pause();
+    }
+}
+
+bool Harness::setup(
+    const std::string& filter,
+    uint64_t samples,
+    uint64_t warmup_samples,
+    double min_sample_ms
+)
+{
+    try {
+        std::regex regex { filter };
+    } catch (std::regex_error& error) {
+        fmt::println(stderr, "error: invalid filter, reason {}", error.what());
+
+        return false;
+    }
+
+    if (samples < 3) {
+        fmt::println(stderr, "error: at least three samples are required");
+
+        return false;
+    }
+
+    if (min_sample_ms <= 0) {
+        fmt::println(stderr, "error: the sample time must be positive");
+
+        return false;
+    }
+
+    m_filter = filter;
+    m_samples = samples;
+    m_warmup_samples = warmup_samples;
+    m_min_sample_time = std::chrono::duration_cast<Sample::Clock::duration>(
+        std::chrono::duration<double, std::milli>(min_sample_ms)
+    );
+
+    return true;
+}
+
+void Harness::add(std::string name, Body body, uint64_t bytes_per_iteration)
+{
+    m_benchmarks.push_back(
+        Benchmark { std::move(name), std::move(body), bytes_per_iteration }
+    );
+}
+
+// the value below which the given fraction of the (sorted)
+// values lie, interpolating between the closest two
+static double quantile(const std::vector<double>& sorted, double fraction)
+{
+    double position = fraction * static_cast<double>(sorted.size() - 1);
+
+    auto lower = static_cast<size_t>(std::floor(position));
+    auto upper = static_cast<size_t>(std::ceil(position));
+
+    double weight = position - static_cast<double>(lower);
+
+    return sorted[lower] * (1 - weight) + sorted[upper] * weight;
+}
+
+Result Harness::measure(const Benchmark& benchmark) const
+{
+    Sample sample {};
+
+    // calibrate, doubling the iterations until a sample is
+    // long enough
+    uint64_t iterations = 1;
+
+    for (;;) {
+        sample.start();
+
+        benchmark.body(sample, iterations);
+
+        sample.stop();
+
+        if (sample.elapsed() >= m_min_sample_time) {
+            break;
+        }
+
+        // NOTE: jump straight to roughly the right number of
+        // iterations once the sample is long enough to be
+        // measured reliably
+        if (sample.elapsed() >= m_min_sample_time / 100) {
+            double ratio = static_cast<double>(m_min_sample_time.count())
+                           / static_cast<double>(sample.elapsed().count());
+
+            iterations = static_cast<uint64_t>(
+                std::ceil(static_cast<double>(iterations) * ratio * 1.2)
+            );
+
+            continue;
+        }
+
+        iterations *= 2;
+    }
+
+    for (uint64_t i = 0; i < m_warmup_samples; i++) {
+        sample.start();
+
+        benchmark.body(sample, iterations);
+
+        sample.stop();
+    }
+
+    std::vector<double> per_iteration {};
+
+    per_iteration.reserve(m_samples);
+
+    for (uint64_t i = 0; i < m_samples; i++) {
+        sample.start();
+
+        benchmark.body(sample, iterations);
+
+        sample.stop();
+
+        per_iteration.push_back(
+            static_cast<double>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    sample.elapsed()
+                )
+                    .count()
+            )
+            / static_cast<double>(iterations)
+        );
+    }
+
+    std::sort(per_iteration.begin(), per_iteration.end());
+
+    Result result {};
+
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.samples = m_samples;
+    result.median_ns = quantile(per_iteration, 0.5);
+    result.min_ns = per_iteration.front();
+    result.p90_ns = quantile(per_iteration, 0.9);
+    result.mean_ns
+        = std::accumulate(per_iteration.begin(), per_iteration.end(), 0.0)
+          / static_cast<double>(per_iteration.size());
+
+    std::vector<double> deviations {};
+
+    deviations.reserve(per_iteration.size());
+
+    for (double value : per_iteration) {
+        deviations.push_back(std::abs(value - result.median_ns));
+    }
+
+    std::sort(deviations.begin(), deviations.end());
+
+    result.mad_ns = quantile(deviations, 0.5);
+
+    if (benchmark.bytes_per_iteration > 0 && result.median_ns > 0) {
+        result.bytes_per_sec = static_cast<double>(benchmark.bytes_per_iteration)
+                               / (result.median_ns * 1e-9);
+    }
+
+    return result;
+}
+
+bool Harness::run()
+{
+    std::regex regex { m_filter };
+
+    fmt::println(
+        "{:<48} {:>12} {:>12} {:>12} {:>12} {:>12} {:>10}",
+        "benchmark",
+        "median ns",
+        "mad ns",
+        "min ns",
+        "p90 ns",
+        "MiB/s",
+        "iterations"
+    );
+
+    for (auto& benchmark : m_benchmarks) {
+        if (!std::regex_search(benchmark.name, regex)) {
+            continue;
+        }
+
+        Result result = measure(benchmark);
+
+        fmt::println(
+            "{:<48} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.1f} {:>12} {:>10}",
+            result.name,
+            result.median_ns,
+            result.mad_ns,
+            result.min_ns,
+            result.p90_ns,
+            result.bytes_per_sec > 0
+                ? fmt::format("{:.1f}", result.bytes_per_sec / (1 << 20))
+                : "-",
+            result.iterations
+        );
+
+        m_results.push_back(result);
+    }
+
+    if (m_results.empty()) {
+        fmt::println(stderr, "error: no benchmark matches {}", m_filter);
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Harness::write(const std::string& path, OutputFormat format) const
+{
+    std::ofstream of { path };
+
+    if (!of) {
+        fmt::println(stderr, "error: could not open {}", path);
+
+        return false;
+    }
+
+    switch (format) {
+    case OutputFormat::CSV:
+        of << "name,iterations,samples,median_ns,mad_ns,min_ns,p90_ns,mean_ns,"
+              "bytes_per_sec\n";
+
+        for (auto& result : m_results) {
+            of << fmt::format(
+                "{},{},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},{:.1f}\n",
+                result.name,
+                result.iterations,
+                result.samples,
+                result.median_ns,
+                result.mad_ns,
+                result.min_ns,
+                result.p90_ns,
+                result.mean_ns,
+                result.bytes_per_sec
+            );
+        }
+        break;
+    case OutputFormat::JSON:
+        of << "[\n";
+
+        for (size_t i = 0; i < m_results.size(); i++) {
+            const Result& result = m_results[i];
+
+            of << fmt::format(
+                "  {{\"name\": \"{}\", \"iterations\": {}, \"samples\": {}, "
+                "\"median_ns\": {:.3f}, \"mad_ns\": {:.3f}, \"min_ns\": "
+                "{:.3f}, \"p90_ns\": {:.3f}, \"mean_ns\": {:.3f}, "
+                "\"bytes_per_sec\": {:.1f}}}{}\n",
+                result.name,
+                result.iterations,
+                result.samples,
+                result.median_ns,
+                result.mad_ns,
+                result.min_ns,
+                result.p90_ns,
+                result.mean_ns,
+                result.bytes_per_sec,
+                i + 1 < m_results.size() ? "," : ""
+            );
+        }
+
+        of << "]\n";
+        break;
+    }
+
+    return true;
+}
+
+} // namespace microbench
@@ -0,0 +1,122 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+namespace microbench {
+
+// A sample is a batch of iterations of a benchmark which is
+// timed as a whole, anything which should not be measured
+// (like restoring a canvas after mutating it) is done between
+// a pause and a resume
+
+class Sample {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    void pause();
+
+    void resume();
+
+    [[nodiscard]] Clock::duration elapsed() const;
+
+   private:
+    friend class Harness;
+
+    void start();
+
+    void stop();
+
+    Clock::time_point m_resumed_at {};
+
+    Clock::duration m_elapsed {};
+
+    bool m_is_running { false };
+};
+
+// The body of a benchmark runs the given number of
+// iterations
+using Body = std::function<void(Sample& sample, uint64_t iterations)>;
+
+struct Benchmark {
+    std::string name {};
+
+    Body body {};
+
+    // how many bytes a single iteration processes (zero if it
+    // is not meaningful)
+    uint64_t bytes_per_iteration { 0 };
+};
+
+// All timings are per iteration in nanoseconds, the median
+// and the median absolute deviation are what should be
+// compared since they are robust to the odd outlier (like a
+// context switch in the middle of a sample)
+struct Result {
+    std::string name {};
+    uint64_t iterations { 0 };
+    uint64_t samples { 0 };
+    double median_ns { 0 };
+    double mad_ns { 0 };
+    double min_ns { 0 };
+    double p90_ns { 0 };
+    double mean_ns { 0 };
+    double bytes_per_sec { 0 };
+};
+
+enum class OutputFormat : uint8_t {
+    CSV,
+    JSON,
+};
+
+// The harness first calibrates the number of iterations per
+// sample so that a single sample lasts at least
+// min_sample_time (keeping the overhead of reading the clock
+// out of the picture), runs a few samples to warm up and then
+// collects the samples which are reported.
+
+class Harness {
+   public:
+    Harness() = default;
+
+    bool setup(
+        const std::string& filter,
+        uint64_t samples,
+        uint64_t warmup_samples,
+        double min_sample_ms
+    );
+
+    void add(std::string name, Body body, uint64_t bytes_per_iteration = 0);
+
+    [[nodiscard]] bool run();
+
+    [[nodiscard]] bool write(const std::string& path, OutputFormat format) const;
+
+   private:
+    [[nodiscard]] Result measure(const Benchmark& benchmark) const;
+
+    std::string m_filter {};
+    uint64_t m_samples { 30 };
+    uint64_t m_warmup_samples { 3 };
+    Sample::Clock::duration m_min_sample_time {};
+
+    std::vector<Benchmark> m_benchmarks {};
+
+    std::vector<Result> m_results {};
+};
+
+// stops the compiler from optimising away a value which is
+// otherwise unused
+template <class T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace microbench
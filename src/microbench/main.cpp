@@ -0,0 +1,88 @@
+// microbench
+#include "benchmarks.hpp"
+#include "harness.hpp"
+
+// cli11
+#include <CLI/App.hpp>
+#include <CLI/CLI.hpp>
+#include <CLI/Validators.hpp>
+
+int main(int argc, char** argv)
+{
+    CLI::App app;
+
+    std::string filter { ".*" };
+    app.add_option(
+           "--filter",
+           filter,
+           "Only run the benchmarks whose names match this regular expression"
+    )
+        ->capture_default_str();
+
+    uint64_t samples { 30 };
+    app.add_option(
+           "--samples",
+           samples,
+           "The number of samples which are taken of every benchmark"
+    )
+        ->capture_default_str();
+
+    uint64_t warmup_samples { 3 };
+    app.add_option(
+           "--warmup-samples",
+           warmup_samples,
+           "The number of samples which are thrown away before measuring"
+    )
+        ->capture_default_str();
+
+    double min_sample_ms { 10 };
+    app.add_option(
+           "--min-sample-time",
+           min_sample_ms,
+           "The least time (in milliseconds) a single sample has to take, "
+           "the number of iterations per sample is picked accordingly"
+    )
+        ->capture_default_str();
+
+    std::string output {};
+    app.add_option(
+        "--output",
+        output,
+        "The file to which the results are written"
+    );
+
+    std::string format { "csv" };
+    app.add_option("--format", format, "The format of the output")
+        ->capture_default_str()
+        ->check(CLI::IsMember({ "csv", "json" }));
+
+    bool list { false };
+    app.add_flag("--list", list, "List the benchmarks instead of running them");
+
+    CLI11_PARSE(app, argc, argv);
+
+    microbench::Harness harness {};
+
+    if (!harness.setup(filter, samples, warmup_samples, min_sample_ms)) {
+        return EXIT_FAILURE;
+    }
+
+    microbench::add_codec_benchmarks(harness);
+    microbench::add_channel_benchmarks(harness);
+    microbench::add_canvas_benchmarks(harness);
+
+    if (!harness.run()) {
+        return EXIT_FAILURE;
+    }
+
+    if (!output.empty()
+        && !harness.write(
+            output,
+            format == "json" ? microbench::OutputFormat::JSON
+                             : microbench::OutputFormat::CSV
+        )) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
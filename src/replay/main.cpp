@@ -0,0 +1,94 @@
+// replay
+#include "replayer.hpp"
+
+// std
+#include <regex>
+
+// cli11
+#include <CLI/App.hpp>
+#include <CLI/CLI.hpp>
+#include <CLI/Validators.hpp>
+
+struct IPv4Validator : public CLI::Validator {
+    IPv4Validator()
+    {
+        name_ = "IPv4";
+        func_ = [](const std::string& str) {
+            std::regex ipv4_regex {
+                R"(^((25[0-5]|(2[0-4]|1\d|[1-9]|)\d)\.){3}(25[0-5]|(2[0-4]|1\d|[1-9]|)\d)$)"
+            };
+
+            if (!std::regex_match(str, ipv4_regex))
+                return std::string { "string is not a IPv4 address" };
+            else
+                return std::string {};
+        };
+    }
+};
+
+const static IPv4Validator IPv4;
+
+int main(int argc, char** argv)
+{
+    CLI::App app;
+
+    std::string ipv4_addr_str { "127.0.0.1" };
+    app.add_option(
+           "--server",
+           ipv4_addr_str,
+           "The IPv4 address of a machine hosting a "
+           "NetSketch server"
+    )
+        ->capture_default_str()
+        ->check(IPv4);
+
+    uint16_t port { 6666 };
+    app.add_option("--port", port, "The port number of a NetSketch server")
+        ->capture_default_str();
+
+    std::string trace_path {};
+    app.add_option(
+           "--trace",
+           trace_path,
+           "A trace recorded by the NetSketch server (with --record)"
+    )
+        ->required();
+
+    double speed { 1 };
+    app.add_option(
+           "--speed",
+           speed,
+           "How much faster than it was recorded to replay the trace, zero "
+           "replays it as fast as possible"
+    )
+        ->capture_default_str();
+
+    std::string observer_username { "replay_observer" };
+    app.add_option(
+           "--observer-username",
+           observer_username,
+           "The username of the connection used to verify the replay (it "
+           "must not appear in the trace)"
+    )
+        ->capture_default_str();
+
+    CLI11_PARSE(app, argc, argv);
+
+    replay::Replayer replayer {};
+
+    if (!replayer.setup(
+            ipv4_addr_str,
+            port,
+            trace_path,
+            speed,
+            observer_username
+        )) {
+        return EXIT_FAILURE;
+    }
+
+    if (!replayer.run()) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,836 @@
+// replay
+#include "replayer.hpp"
+
+// common
+#include "../common/channel.hpp"
+#include "../common/overload.hpp"
+#include "../common/serial.hpp"
+#include "../common/tagged_draw_vector_wrapper.hpp"
+
+// unix
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// cstd
+#include <cerrno>
+#include <cstring>
+
+// std
+#include <algorithm>
+#include <optional>
+
+// fmt
+#include <fmt/core.h>
+
+// spdlog
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+// How long to wait for the remaining broadcasts once the
+// whole trace has been sent
+#define DRAIN_TIMEOUT_SECS (30)
+
+// A username can still be taken by the previous connection
+// which used it when replaying quickly, in which case the
+// connection is retried a little later
+#define RECONNECT_DELAY_MS (10)
+#define MAX_CONNECT_ATTEMPTS (100)
+
+namespace replay {
+
+bool Replayer::setup(
+    const std::string& ipv4_addr,
+    uint16_t port,
+    const std::string& trace_path,
+    double speed,
+    const std::string& observer_username
+)
+{
+    // setup network info
+
+    struct in_addr addr { };
+
+    if (inet_pton(AF_INET, ipv4_addr.c_str(), &addr) <= 0) {
+        fmt::println(stderr, "error: invalid IPv4 address");
+
+        return false;
+    }
+
+    // NOTE: this is in host-readable form
+    m_ipv4_addr = ntohl(addr.s_addr);
+
+    m_port = port;
+
+    if (speed < 0) {
+        fmt::println(stderr, "error: the speed cannot be negative");
+
+        return false;
+    }
+
+    m_speed = speed;
+
+    // setup logging
+
+    try {
+        auto logger = spdlog::stdout_color_mt("replay");
+
+        spdlog::set_default_logger(logger);
+
+        spdlog::set_level(spdlog::level::info);
+    } catch (const spdlog::spdlog_ex& ex) {
+        fmt::println(stderr, "error: log init failed, reason {}", ex.what());
+
+        return false;
+    }
+
+    if (!read_trace(trace_path, m_events)) {
+        return false;
+    }
+
+    // work out what the canvas should look like once the
+    // whole trace is replayed, the recorded order is the
+    // order in which the server applied the actions
+
+    TaggedDrawVector expected {};
+
+    m_conns.push_back(ReplayConnection { {}, observer_username });
+
+    for (auto& event : m_events) {
+        switch (event.type) {
+        case TraceEventType::CONNECT:
+            m_indices[event.connection] = m_conns.size();
+
+            m_conns.push_back(ReplayConnection { {}, event.data });
+            break;
+        case TraceEventType::FRAME: {
+            auto [payload, status] = deserialize<Payload>(event.data);
+
+            // the server does the same, the actions are those of
+            // the user of the connection
+            UserId user = local_user(
+                m_conns[m_indices[event.connection]].username
+            );
+
+            if (status == DeserializeErrorCode::OK
+                && std::holds_alternative<TaggedAction>(payload)) {
+                auto& tagged_action = std::get<TaggedAction>(payload);
+
+                tagged_action.user = user;
+
+                TaggedDrawVectorWrapper { expected }.update(tagged_action);
+
+                m_expected_broadcasts++;
+            } else if (status == DeserializeErrorCode::OK
+                       && std::holds_alternative<ActionBatch>(payload)) {
+                auto& batch = std::get<ActionBatch>(payload);
+
+                batch.user = user;
+
+                for (size_t i = 0; i < batch.actions.size(); i++) {
+                    TaggedDrawVectorWrapper { expected }.update(batch.at(i));
+                }
+
+                m_expected_broadcasts += batch.actions.size();
+            }
+        } break;
+        case TraceEventType::DISCONNECT:
+            break;
+        }
+    }
+
+    m_expected_hash = TaggedDrawVectorWrapper { expected }.hash();
+
+    spdlog::info(
+        "loaded {} events over {} connections ({} actions) from {}",
+        m_events.size(),
+        m_conns.size() - 1,
+        m_expected_broadcasts,
+        trace_path
+    );
+
+    // every connection needs its own socket so the default
+    // limit on open files is easily exceeded
+
+    struct rlimit limit { };
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    m_epoll_fd = epoll_create1(0);
+
+    if (m_epoll_fd == -1) {
+        fmt::println(stderr, "error: epoll_create1(): {}", strerror(errno));
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Replayer::open(size_t index)
+{
+    ReplayConnection& conn = m_conns[index];
+
+    // NOTE: connecting is done in blocking mode, it keeps
+    // things simple
+    try {
+        conn.sock = IPv4Socket {};
+
+        conn.sock.open(SOCK_STREAM, 0);
+
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(m_ipv4_addr);
+        addr.sin_port = htons(m_port);
+
+        conn.sock.connect(&addr);
+    } catch (std::runtime_error& error) {
+        spdlog::error(
+            "opening & connecting failed for {}, reason {}",
+            conn.username,
+            error.what()
+        );
+
+        return false;
+    }
+
+    conn.sock.make_non_blocking();
+
+    struct epoll_event event { };
+
+    event.events = EPOLLIN;
+    event.data.u64 = index;
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, conn.sock.native_handle(), &event)
+        == -1) {
+        spdlog::error("epoll_ctl(): {}", strerror(errno));
+
+        return false;
+    }
+
+    conn.state = ReplayConnection::State::HANDSHAKE;
+
+    conn.attempts++;
+
+    conn.in_buffer.clear();
+
+    conn.out_buffer
+        = Channel::frame(serialize<Payload>(Username { conn.username }));
+    conn.out_offset = 0;
+    conn.is_waiting_for_out = false;
+
+    return flush(conn);
+}
+
+void Replayer::dispatch(Clock::time_point now)
+{
+    size_t dispatched = 0;
+
+    while (m_next_event < m_events.size()) {
+        const TraceEvent& event = m_events[m_next_event];
+
+        if (m_speed > 0) {
+            auto due = m_start
+                       + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double, std::micro>(
+                               static_cast<double>(event.at_us) / m_speed
+                           )
+                       );
+
+            if (due > now) {
+                break;
+            }
+        } else if (dispatched >= MAX_DISPATCH_BATCH) {
+            break;
+        }
+
+        m_next_event++;
+
+        dispatched++;
+
+        auto iter = m_indices.find(event.connection);
+
+        if (iter == m_indices.end()) {
+            continue;
+        }
+
+        ReplayConnection& conn = m_conns[iter->second];
+
+        switch (event.type) {
+        case TraceEventType::CONNECT:
+            if (!open(iter->second)) {
+                close(conn);
+            }
+            break;
+        case TraceEventType::FRAME:
+            if (conn.state == ReplayConnection::State::CLOSED) {
+                break;
+            }
+
+            m_frames_sent++;
+
+            if (conn.state != ReplayConnection::State::ACTIVE) {
+                conn.held_frames.append(Channel::frame(event.data));
+
+                break;
+            }
+
+            conn.out_buffer.append(Channel::frame(event.data));
+
+            if (!flush(conn)) {
+                close(conn);
+            }
+            break;
+        case TraceEventType::DISCONNECT:
+            conn.is_closing = true;
+
+            shut_down_if_done(conn);
+            break;
+        }
+    }
+}
+
+void Replayer::retry(Clock::time_point now)
+{
+    for (size_t i = 1; i < m_conns.size(); i++) {
+        ReplayConnection& conn = m_conns[i];
+
+        if (conn.state != ReplayConnection::State::PENDING
+            || conn.attempts == 0 || conn.retry_at > now) {
+            continue;
+        }
+
+        if (!open(i)) {
+            close(conn);
+        }
+    }
+}
+
+bool Replayer::flush(ReplayConnection& conn)
+{
+    while (conn.out_offset < conn.out_buffer.size()) {
+        ssize_t ret = ::send(
+            conn.sock.native_handle(),
+            conn.out_buffer.data() + conn.out_offset,
+            conn.out_buffer.size() - conn.out_offset,
+            MSG_NOSIGNAL
+        );
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            return false;
+        }
+
+        conn.out_offset += static_cast<size_t>(ret);
+    }
+
+    if (conn.out_offset == conn.out_buffer.size()) {
+        conn.out_buffer.clear();
+        conn.out_offset = 0;
+    }
+
+    // only ask to be woken up when the socket becomes
+    // writable if there actually is something to write
+    bool should_wait_for_out = !conn.out_buffer.empty();
+
+    if (should_wait_for_out != conn.is_waiting_for_out) {
+        struct epoll_event event { };
+
+        event.events = EPOLLIN | (should_wait_for_out ? EPOLLOUT : 0u);
+        event.data.u64 = static_cast<uint64_t>(&conn - m_conns.data());
+
+        if (epoll_ctl(
+                m_epoll_fd,
+                EPOLL_CTL_MOD,
+                conn.sock.native_handle(),
+                &event
+            )
+            == -1) {
+            return false;
+        }
+
+        conn.is_waiting_for_out = should_wait_for_out;
+    }
+
+    return true;
+}
+
+bool Replayer::receive(ReplayConnection& conn)
+{
+    // NOTE: only the observer cares about the broadcasts, the
+    // rest of the connections just have to keep up with them
+    // so the server is never blocked writing to them
+    bool is_discarding = &conn != &m_conns.front()
+                         && conn.state == ReplayConnection::State::ACTIVE;
+
+    char buffer[65536];
+
+    for (;;) {
+        ssize_t ret = ::recv(conn.sock.native_handle(), buffer, sizeof(buffer), 0);
+
+        if (ret == 0) {
+            return false;
+        }
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            return false;
+        }
+
+        if (!is_discarding) {
+            conn.in_buffer.append(buffer, static_cast<size_t>(ret));
+        }
+    }
+
+    // split the received bytes up into packets, whatever is
+    // left over is kept around until the rest arrives
+
+    size_t offset = 0;
+
+    while (conn.in_buffer.size() - offset >= Header::size()) {
+        auto [header, status]
+            = deserialize<Header>(conn.in_buffer.substr(offset, Header::size())
+            );
+
+        if (status != DeserializeErrorCode::OK
+            || header.magic_bytes != MAGIC_BYTES) {
+            spdlog::error("{} received an invalid header", conn.username);
+
+            return false;
+        }
+
+        if (conn.in_buffer.size() - offset
+            < Header::size() + header.payload_size) {
+            break;
+        }
+
+        auto [bytes, unpack_status] = Channel::unpack(
+            header,
+            conn.in_buffer.substr(offset + Header::size(), header.payload_size)
+        );
+
+        if (unpack_status != ChannelErrorCode::OK) {
+            spdlog::error("{} received a malformed frame", conn.username);
+
+            return false;
+        }
+
+        if (!handle_packet(conn, bytes)) {
+            return false;
+        }
+
+        offset += Header::size() + header.payload_size;
+
+        // the rest is of no interest (or belongs to a
+        // connection which has been dropped to be retried)
+        if (&conn != &m_conns.front()
+            && conn.state != ReplayConnection::State::HANDSHAKE) {
+            conn.in_buffer.clear();
+
+            return true;
+        }
+    }
+
+    conn.in_buffer.erase(0, offset);
+
+    return true;
+}
+
+bool Replayer::handle_packet(ReplayConnection& conn, const ByteString& bytes)
+{
+    auto [payload, status] = deserialize<Payload>(bytes);
+
+    if (status != DeserializeErrorCode::OK) {
+        spdlog::warn("deserialization failed, reason {}", status.what());
+
+        return true;
+    }
+
+    bool is_observer = &conn == &m_conns.front();
+
+    return std::visit(
+        overload {
+            [this, &conn, is_observer](Accept&) {
+                conn.state = ReplayConnection::State::ACTIVE;
+
+                if (is_observer) {
+                    m_has_started = true;
+
+                    m_start = Clock::now();
+
+                    return true;
+                }
+
+                conn.out_buffer.append(conn.held_frames);
+
+                conn.held_frames.clear();
+
+                return flush(conn);
+            },
+            [this, &conn, is_observer](Decline& arg) {
+                if (is_observer || conn.attempts >= MAX_CONNECT_ATTEMPTS) {
+                    spdlog::error(
+                        "{} was declined, reason {}",
+                        conn.username,
+                        arg.reason
+                    );
+
+                    return false;
+                }
+
+                epoll_ctl(
+                    m_epoll_fd,
+                    EPOLL_CTL_DEL,
+                    conn.sock.native_handle(),
+                    nullptr
+                );
+
+                conn.sock.close();
+
+                conn.state = ReplayConnection::State::PENDING;
+
+                conn.retry_at = Clock::now()
+                                + std::chrono::milliseconds(RECONNECT_DELAY_MS);
+
+                return true;
+            },
+            [this, is_observer](Snapshot& arg) {
+                if (is_observer) {
+                    m_canvas = std::move(arg.draws);
+                }
+
+                return true;
+            },
+            [this, is_observer](TaggedAction& arg) {
+                if (is_observer) {
+                    TaggedDrawVectorWrapper { m_canvas }.update(arg);
+
+                    m_broadcasts++;
+                }
+
+                return true;
+            },
+            [this, is_observer](ActionBatch& arg) {
+                if (is_observer) {
+                    TaggedDrawVectorWrapper wrapper { m_canvas };
+
+                    for (size_t i = 0; i < arg.actions.size(); i++) {
+                        wrapper.update(arg.at(i));
+                    }
+
+                    m_broadcasts += arg.actions.size();
+                }
+
+                return true;
+            },
+            [this, is_observer](UserNames& arg) {
+                if (is_observer) {
+                    for (auto& user_name : arg.names) {
+                        m_server_names[user_name.user]
+                            = std::move(user_name.username);
+                    }
+                }
+
+                return true;
+            },
+            [this, is_observer](Adopt& arg) {
+                if (is_observer) {
+                    TaggedDrawVectorWrapper { m_canvas }.adopt(arg);
+                }
+
+                return true;
+            },
+            [&conn](auto& object) {
+                spdlog::warn(
+                    "{} received an unexpected payload type {}",
+                    conn.username,
+                    typeid(object).name()
+                );
+
+                return true;
+            },
+        },
+        payload
+    );
+}
+
+void Replayer::shut_down_if_done(ReplayConnection& conn)
+{
+    if (!conn.is_closing || conn.is_shut_down
+        || conn.state != ReplayConnection::State::ACTIVE
+        || !conn.out_buffer.empty()) {
+        return;
+    }
+
+    // NOTE: closing a socket which still has unread data
+    // (broadcasts in our case) resets the connection, which
+    // can make the server drop the last frames we sent. So
+    // instead only our side is shut down and the connection
+    // is closed once the server closes its side.
+    ::shutdown(conn.sock.native_handle(), SHUT_WR);
+
+    conn.is_shut_down = true;
+}
+
+void Replayer::close(ReplayConnection& conn)
+{
+    if (conn.state == ReplayConnection::State::CLOSED) {
+        return;
+    }
+
+    if (conn.sock.native_handle() != -1) {
+        epoll_ctl(
+            m_epoll_fd,
+            EPOLL_CTL_DEL,
+            conn.sock.native_handle(),
+            nullptr
+        );
+
+        conn.sock.close();
+    }
+
+    conn.state = ReplayConnection::State::CLOSED;
+
+    if (!conn.is_closing) {
+        m_failed++;
+    }
+}
+
+bool Replayer::is_idle() const
+{
+    return std::all_of(
+        m_conns.begin() + 1,
+        m_conns.end(),
+        [](const ReplayConnection& conn) {
+            switch (conn.state) {
+            case ReplayConnection::State::PENDING:
+                // never connected (the trace ended before it did)
+                return conn.attempts == 0;
+            case ReplayConnection::State::HANDSHAKE:
+                return false;
+            case ReplayConnection::State::ACTIVE:
+                return conn.out_buffer.empty();
+            case ReplayConnection::State::CLOSED:
+                return true;
+            }
+
+            return true;
+        }
+    );
+}
+
+bool Replayer::run()
+{
+    if (!open(0)) {
+        return false;
+    }
+
+    std::vector<struct epoll_event> events(MAX_EPOLL_EVENTS);
+
+    std::optional<Clock::time_point> drained_at {};
+
+    uint64_t drained_broadcasts { 0 };
+
+    for (;;) {
+        auto now = Clock::now();
+
+        if (m_conns.front().state == ReplayConnection::State::CLOSED) {
+            spdlog::error("the observer was disconnected");
+
+            break;
+        }
+
+        if (m_has_started) {
+            retry(now);
+
+            dispatch(now);
+        }
+
+        if (m_has_started && m_next_event == m_events.size() && is_idle()) {
+            if (m_broadcasts >= m_expected_broadcasts) {
+                break;
+            }
+
+            // give up if the broadcasts stop coming in
+            if (!drained_at.has_value() || drained_broadcasts != m_broadcasts) {
+                drained_at = now;
+
+                drained_broadcasts = m_broadcasts;
+            } else if (now - *drained_at
+                       > std::chrono::seconds(DRAIN_TIMEOUT_SECS)) {
+                spdlog::error(
+                    "gave up waiting for the remaining {} broadcasts",
+                    m_expected_broadcasts - m_broadcasts
+                );
+
+                break;
+            }
+        }
+
+        // sleep until the next event is due (or something
+        // happens on one of the sockets)
+        int timeout = 1000;
+
+        if (m_has_started && m_next_event < m_events.size()) {
+            if (m_speed > 0) {
+                auto due = m_start
+                           + std::chrono::duration_cast<Clock::duration>(
+                               std::chrono::duration<double, std::micro>(
+                                   static_cast<double>(
+                                       m_events[m_next_event].at_us
+                                   )
+                                   / m_speed
+                               )
+                           );
+
+                auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+                    due - Clock::now()
+                );
+
+                timeout = static_cast<int>(
+                    std::clamp<long>(wait.count(), 0, timeout)
+                );
+            } else {
+                timeout = 0;
+            }
+        }
+
+        if (m_has_started) {
+            timeout = std::min(timeout, RECONNECT_DELAY_MS);
+        }
+
+        int count = epoll_wait(
+            m_epoll_fd,
+            events.data(),
+            static_cast<int>(events.size()),
+            timeout
+        );
+
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            spdlog::error("epoll_wait(): {}", strerror(errno));
+
+            return false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            const struct epoll_event& event = events[static_cast<size_t>(i)];
+
+            ReplayConnection& conn = m_conns[event.data.u64];
+
+            if (conn.state != ReplayConnection::State::HANDSHAKE
+                && conn.state != ReplayConnection::State::ACTIVE) {
+                continue;
+            }
+
+            if (event.events & EPOLLIN) {
+                if (!receive(conn)) {
+                    close(conn);
+
+                    continue;
+                }
+            } else if (event.events & (EPOLLERR | EPOLLHUP)) {
+                close(conn);
+
+                continue;
+            }
+
+            if (conn.state == ReplayConnection::State::PENDING) {
+                continue;
+            }
+
+            if (event.events & EPOLLOUT) {
+                if (!flush(conn)) {
+                    close(conn);
+
+                    continue;
+                }
+            }
+
+            shut_down_if_done(conn);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = Clock::now() - m_start;
+
+    spdlog::info(
+        "connections: {}, failed: {}, frames sent: {}, elapsed: {:.3f}s "
+        "({:.1f} frames/s)",
+        m_conns.size() - 1,
+        m_failed,
+        m_frames_sent,
+        elapsed.count(),
+        static_cast<double>(m_frames_sent) / elapsed.count()
+    );
+
+    spdlog::info(
+        "broadcasts seen by the observer: {} of {}",
+        m_broadcasts,
+        m_expected_broadcasts
+    );
+
+    for (auto& tagged_draw : m_canvas) {
+        auto iter = m_server_names.find(tagged_draw.user);
+
+        if (iter != m_server_names.end()) {
+            tagged_draw.user = local_user(iter->second);
+        }
+    }
+
+    std::size_t hash = TaggedDrawVectorWrapper { m_canvas }.hash();
+
+    if (hash != m_expected_hash) {
+        spdlog::error(
+            "hash of the replayed canvas {} does not match the expected {}",
+            hash,
+            m_expected_hash
+        );
+
+        return false;
+    }
+
+    spdlog::info(
+        "hash of the replayed canvas: {}, size of the replayed canvas {}",
+        hash,
+        m_canvas.size()
+    );
+
+    return m_failed == 0 && m_broadcasts == m_expected_broadcasts;
+}
+
+UserId Replayer::local_user(const std::string& username)
+{
+    auto [iter, is_new] = m_local_users.emplace(
+        username,
+        static_cast<UserId>(m_local_users.size())
+    );
+
+    return iter->second;
+}
+
+Replayer::~Replayer()
+{
+    if (m_epoll_fd != -1) {
+        ::close(m_epoll_fd);
+    }
+
+    spdlog::info("Finished...");
+}
+
+} // namespace replay
@@ -0,0 +1,167 @@
+#pragma once
+
+// common
+#include "../common/bytes.hpp"
+#include "../common/network.hpp"
+#include "../common/trace.hpp"
+#include "../common/types.hpp"
+
+// std
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+// The maximum number of events handled per call to
+// epoll_wait
+#define MAX_EPOLL_EVENTS (256)
+
+// The maximum number of trace events dispatched in between
+// servicing the sockets when replaying as fast as possible
+#define MAX_DISPATCH_BATCH (1024)
+
+namespace replay {
+
+// The replayer opens a connection for every connection in
+// the trace (with the same username) and sends the recorded
+// frames over them, either spaced out like they were recorded
+// (sped up by some factor) or as fast as possible. Like the
+// load generator of the test client, all of the connections
+// are non-blocking and multiplexed on an epoll loop.
+//
+// To verify the replay, an extra observer connection is made
+// before anything is replayed. It keeps its own copy of the
+// canvas from the broadcasts and, once it has seen a broadcast
+// for every recorded action, its hash is compared against the
+// hash of the canvas the trace should result in.
+//
+// NOTE: the order of the frames of a single connection is
+// always preserved, but frames of different connections which
+// were recorded close together can reach the server in a
+// different order (especially when replaying quickly). The
+// hash does not depend on the order of the draws, so this only
+// matters for traces which select, delete or clear.
+
+struct ReplayConnection {
+    enum class State : uint8_t {
+        PENDING,
+        HANDSHAKE,
+        ACTIVE,
+        CLOSED,
+    };
+
+    IPv4Socket sock {};
+    std::string username {};
+    State state { State::PENDING };
+
+    // frames which are held back until the server accepts the
+    // username, if it declines them the connection is retried
+    ByteString held_frames {};
+    uint32_t attempts { 0 };
+    std::chrono::steady_clock::time_point retry_at {};
+
+    // bytes which have been received but do not yet make up
+    // a whole packet
+    ByteString in_buffer {};
+
+    // bytes which are waiting for the socket to become
+    // writable
+    ByteString out_buffer {};
+    size_t out_offset { 0 };
+    bool is_waiting_for_out { false };
+
+    // set once the trace disconnects, the connection is
+    // shut down as soon as everything has been sent
+    bool is_closing { false };
+    bool is_shut_down { false };
+};
+
+class Replayer {
+   public:
+    Replayer() = default;
+
+    Replayer(const Replayer&) = delete;
+
+    Replayer& operator=(const Replayer&) = delete;
+
+    bool setup(
+        const std::string& ipv4_addr,
+        uint16_t port,
+        const std::string& trace_path,
+        double speed,
+        const std::string& observer_username
+    );
+
+    [[nodiscard]] bool run();
+
+    ~Replayer();
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    bool open(size_t index);
+
+    // dispatches the trace events which are due
+    void dispatch(Clock::time_point now);
+
+    void retry(Clock::time_point now);
+
+    bool flush(ReplayConnection& conn);
+
+    bool receive(ReplayConnection& conn);
+
+    bool handle_packet(ReplayConnection& conn, const ByteString& bytes);
+
+    // shuts down a closing connection once it has sent
+    // everything
+    void shut_down_if_done(ReplayConnection& conn);
+
+    void close(ReplayConnection& conn);
+
+    [[nodiscard]] bool is_idle() const;
+
+    // the identifier the replayer uses for the given username
+    UserId local_user(const std::string& username);
+
+    uint32_t m_ipv4_addr {};
+    uint16_t m_port {};
+    double m_speed { 1 };
+
+    std::vector<TraceEvent> m_events {};
+    size_t m_next_event { 0 };
+
+    // the canvas the trace should result in
+    std::size_t m_expected_hash { 0 };
+    uint64_t m_expected_broadcasts { 0 };
+
+    bool m_has_started { false };
+    Clock::time_point m_start {};
+
+    int m_epoll_fd { -1 };
+
+    // the observer is always the first connection, the rest
+    // are the connections of the trace
+    std::vector<ReplayConnection> m_conns {};
+    std::unordered_map<uint32_t, size_t> m_indices {};
+
+    // the observer's copy of the canvas
+    TaggedDrawVector m_canvas {};
+    uint64_t m_broadcasts { 0 };
+
+    // NOTE: the server replayed to is free to give the users
+    // other identifiers than the one which was recorded, so the
+    // expected canvas is worked out with identifiers of our own
+    // (one for every username) and the observer's canvas is
+    // translated to them (through the usernames the server
+    // announces) before the two are compared
+    std::unordered_map<std::string, UserId> m_local_users {};
+    std::unordered_map<UserId, std::string> m_server_names {};
+
+    uint64_t m_frames_sent { 0 };
+    uint32_t m_failed { 0 };
+};
+
+} // namespace replay
@@ -16,6 +16,7 @@
 // common
 #include "../common/abort.hpp"
 #include "../common/overload.hpp"
+#include "../common/stroke.hpp"
 #include "../common/threading.hpp"
 
 // bench
@@ -28,8 +29,17 @@
 
 namespace server {
 
-ConnHandler::ConnHandler(IPv4SocketRef sock, std::string username)
-    : m_sock(sock), m_channel(m_sock), m_username(std::move(username))
+ConnHandler::ConnHandler(
+    IPv4SocketRef sock,
+    std::string username,
+    UserId user,
+    Capabilities capabilities
+)
+    : m_sock(sock),
+      m_channel(m_sock),
+      m_username(std::move(username)),
+      m_user(user),
+      m_capabilities(capabilities)
 {
 }
 
@@ -61,6 +71,8 @@ void ConnHandler::operator()()
         m_username
     );
 
+    m_connection = share::recorder.connect(m_username);
+
     pthread_cleanup_push(
         [](void* untyped_self) {
             auto* self = static_cast<ConnHandler*>(untyped_self);
@@ -76,6 +88,8 @@ void ConnHandler::operator()()
 
                 share::users.erase(self->m_username);
             }
+
+            share::recorder.disconnect(self->m_connection);
         },
         this
     );
@@ -96,8 +110,30 @@ void ConnHandler::operator()()
     }
 
     for (;;) {
-        auto [res, status]
-            = m_channel.read(static_cast<int>(MINUTE * share::time_out));
+        int time_out = static_cast<int>(MINUTE * share::time_out);
+
+        std::unique_ptr<ActionTrace> trace {};
+
+        if (share::stage_tracer.should_sample()) {
+            // NOTE: the trace only starts once the frame has
+            // arrived, otherwise the handler stage would include
+            // the time spent waiting on the user
+            struct pollfd query = { m_sock.native_handle(), POLLIN, 0 };
+
+            int ready = ::poll(&query, 1, time_out);
+
+            if (ready > 0) {
+                trace = share::stage_tracer.start(
+                    m_username,
+                    m_sock.native_handle()
+                );
+            } else if (ready == 0) {
+                // the whole time out has already passed
+                time_out = 0;
+            }
+        }
+
+        auto [res, status] = m_channel.read(time_out);
 
         if (status != ChannelErrorCode::OK) {
             spdlog::info(
@@ -126,6 +162,12 @@ void ConnHandler::operator()()
             break;
         }
 
+        share::metrics.frames_received.fetch_add(1, std::memory_order_relaxed);
+        share::metrics.bytes_received.fetch_add(
+            Header::size() + res.size(),
+            std::memory_order_relaxed
+        );
+
         spdlog::debug(
             "[{}:{} ({})] payload size {} bytes",
             m_ipv4,
@@ -137,11 +179,11 @@ void ConnHandler::operator()()
         {
             BENCH("handling payload");
 
-            handle_payload(res);
+            handle_payload(res, std::move(trace));
         }
     }
 
-    create_client_timer(m_username);
+    create_client_timer(m_username, m_user);
 
     spdlog::info(
         "[{}:{} ({})] closing connection handler",
@@ -155,19 +197,106 @@ void ConnHandler::operator()()
 
 bool ConnHandler::send_full_list()
 {
-    TaggedDrawVector tagged_draw_vector {};
+    ByteString frames {};
 
     ChannelError status {};
 
+    size_t size { 0 };
+
+    size_t frame_size { 0 };
+
+    std::shared_ptr<share::Connection> connection {};
+
+    {
+        threading::mutex_guard guard { share::connections_mutex };
+
+        connection = share::connections.at(m_sock.native_handle());
+    }
+
+    // NOTE: the write mutex is taken before the update mutex
+    // (the updater never takes it while holding the update
+    // mutex), so every update which is applied after the
+    // snapshot gets to the connection after it, and only the
+    // connection waits while the snapshot is written
+    threading::mutex_guard write_guard { connection->write_mutex };
+
     {
         threading::unique_mutex_guard guard { share::update_mutex };
 
-        tagged_draw_vector = share::tagged_draw_vector;
+        // NOTE: the usernames are taken before the canvas, so every
+        // user on the canvas is known by the time it arrives (and
+        // along with it, since the updater does not send the
+        // usernames it already applied)
+        UserNames user_names {};
 
-        status = m_channel.write(serialize<Payload>(tagged_draw_vector));
+        {
+            threading::mutex_guard users_guard { share::users_mutex };
+
+            user_names.names.reserve(share::user_names.size());
+
+            for (size_t i = 0; i < share::user_names.size(); i++) {
+                user_names.names.push_back(
+                    UserName { static_cast<UserId>(i), share::user_names[i] }
+                );
+            }
+        }
+
+        frames = Channel::frame(serialize<Payload>(user_names));
+
+        bool compact = (m_capabilities & CAPABILITY_COMPACT) != 0;
+
+        size_t index = share::SnapshotCache::index(m_capabilities);
+
+        auto& payload = share::snapshot_cache.payloads[index];
+        auto& compressed_frame
+            = share::snapshot_cache.compressed_frames[index];
+
+        if (payload) {
+            share::metrics.snapshot_cache_hits.fetch_add(
+                1,
+                std::memory_order_relaxed
+            );
+        } else if ((m_capabilities & CAPABILITY_STROKES) != 0) {
+            payload = serialize<Payload>(
+                Snapshot { share::tagged_draw_vector, compact }
+            );
+        } else {
+            Snapshot snapshot { share::tagged_draw_vector, compact };
+
+            stroke::to_lines(snapshot.draws);
+
+            payload = serialize<Payload>(snapshot);
+        }
+
+        size = payload->size();
+
+        connection->snapshot_sequence = share::update_sequence;
+
+        if ((m_capabilities & CAPABILITY_COMPRESSION) != 0) {
+            if (!compressed_frame) {
+                compressed_frame = Channel::frame_compressed(*payload);
+            }
+
+            frame_size = compressed_frame->size();
+
+            frames.append(*compressed_frame);
+        } else {
+            ByteString frame = Channel::frame(*payload);
+
+            frame_size = frame.size();
+
+            frames.append(frame);
+        }
     }
 
+    status = m_channel.write_frames(frames);
+
+    share::metrics.snapshot_size.observe(size);
+    share::metrics.snapshot_frame_size.observe(frame_size);
+
     if (status != ChannelErrorCode::OK) {
+        share::metrics.write_errors.fetch_add(1, std::memory_order_relaxed);
+
         spdlog::info(
             "[{}:{} ({})] writing failed, reason: {}",
             m_ipv4,
@@ -179,14 +308,42 @@ bool ConnHandler::send_full_list()
         return false;
     }
 
+    share::metrics.frames_sent.fetch_add(2, std::memory_order_relaxed);
+    share::metrics.bytes_sent.fetch_add(
+        frames.size(),
+        std::memory_order_relaxed
+    );
+
     return true;
 }
 
-void ConnHandler::handle_payload(const ByteString& bytes)
+// whether the payload (a tagged action or an action batch)
+// has an action with a stroke
+static bool has_stroke(const Payload& payload)
+{
+    if (std::holds_alternative<TaggedAction>(payload)) {
+        return stroke::has_stroke(std::get<TaggedAction>(payload).action);
+    }
+
+    for (const BatchedAction& batched : std::get<ActionBatch>(payload).actions) {
+        if (stroke::has_stroke(batched.action)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ConnHandler::handle_payload(
+    const ByteString& bytes,
+    std::unique_ptr<ActionTrace> trace
+)
 {
     auto [payload, status] = deserialize<Payload>(bytes);
 
     if (status != DeserializeErrorCode::OK) {
+        share::recorder.frame(m_connection, bytes);
+
         spdlog::warn(
             "[{}:{} ({})] deserialization failed, reason {}",
             m_ipv4,
@@ -197,7 +354,10 @@ void ConnHandler::handle_payload(const ByteString& bytes)
         return;
     }
 
-    if (!std::holds_alternative<TaggedAction>(payload)) {
+    if (!std::holds_alternative<TaggedAction>(payload)
+        && !std::holds_alternative<ActionBatch>(payload)) {
+        share::recorder.frame(m_connection, bytes);
+
         spdlog::warn(
             "[{}:{} ({})] unexpected payload type {}",
             m_ipv4,
@@ -209,20 +369,64 @@ void ConnHandler::handle_payload(const ByteString& bytes)
         return;
     }
 
-    TaggedAction tagged_action = std::get<TaggedAction>(payload);
+    if (std::holds_alternative<ActionBatch>(payload)
+        && std::get<ActionBatch>(payload).actions.empty()) {
+        share::recorder.frame(m_connection, bytes);
+
+        return;
+    }
+
+    // NOTE: a peer which did not settle on strokes has no
+    // business sending them, the whole frame is dropped
+    if ((m_capabilities & CAPABILITY_STROKES) == 0 && has_stroke(payload)) {
+        share::recorder.frame(m_connection, bytes);
+
+        spdlog::warn(
+            "[{}:{} ({})] stroke without the capability",
+            m_ipv4,
+            m_port,
+            m_username
+        );
+
+        return;
+    }
+
+    // NOTE: whatever the client put in there, the actions are
+    // always those of the user on this connection
+    if (std::holds_alternative<TaggedAction>(payload)) {
+        std::get<TaggedAction>(payload).user = m_user;
+    } else {
+        std::get<ActionBatch>(payload).user = m_user;
+    }
+
+    if (trace) {
+        // NOTE: a batch is traced as a whole, by its first action
+        const Action& action
+            = std::holds_alternative<TaggedAction>(payload)
+                  ? std::get<TaggedAction>(payload).action
+                  : std::get<ActionBatch>(payload).actions.front().action;
+
+        trace->action = action_type(action);
+
+        trace->mark(Stage::HANDLER);
+    }
 
     // NOTE: if we block on the push queue we might actually
     // miss data or overflow data that is sent to us in
     // buffer the kernel has allocated for the socket.
     // That's what we are doing right now
 
-    {
-        threading::unique_mutex_guard guard { share::update_mutex };
+    QueuedPayload queued { std::move(payload), std::move(trace) };
 
-        share::payload_queue.emplace(tagged_action);
+    // NOTE: recorded by the updater, that way the order of the
+    // actions in the trace is exactly the order in which the
+    // updater applies them
+    if (share::recorder.is_open()) {
+        queued.connection = m_connection;
+        queued.frame = bytes;
     }
 
-    share::update_cond.notify_one();
+    share::payload_queue.push(std::move(queued));
 }
 
 } // namespace server
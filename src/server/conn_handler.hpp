@@ -3,16 +3,28 @@
 // unix
 #include <netinet/in.h>
 
+// std
+#include <memory>
+
 // common
 #include "../common/bytes.hpp"
 #include "../common/channel.hpp"
 #include "../common/network.hpp"
+#include "../common/types.hpp"
+
+// server
+#include "stages.hpp"
 
 namespace server {
 
 class ConnHandler {
    public:
-    explicit ConnHandler(IPv4SocketRef sock, std::string username);
+    explicit ConnHandler(
+        IPv4SocketRef sock,
+        std::string username,
+        UserId user,
+        Capabilities capabilities
+    );
 
     void operator()();
 
@@ -21,7 +33,10 @@ class ConnHandler {
 
     bool send_full_list();
 
-    void handle_payload(const ByteString& bytes);
+    void handle_payload(
+        const ByteString& bytes,
+        std::unique_ptr<ActionTrace> trace
+    );
 
     IPv4SocketRef m_sock {};
 
@@ -31,6 +46,13 @@ class ConnHandler {
     std::string m_port {};
 
     std::string m_username {};
+    UserId m_user { 0 };
+
+    // what the handshake settled on
+    Capabilities m_capabilities { 0 };
+
+    // the identifier of the connection in the recorded trace
+    uint32_t m_connection { 0 };
 };
 
 } // namespace server
@@ -1,5 +1,7 @@
 // server
 #include "runner.hpp"
+#include "stages.hpp"
+#include "updater.hpp"
 
 // cli11
 #include <CLI/CLI.hpp>
@@ -20,11 +22,82 @@ int main(int argc, char** argv)
     )
         ->capture_default_str();
 
+    std::string record_path {};
+    app.add_option(
+        "--record",
+        record_path,
+        "Record all the traffic the server receives to a trace file (which "
+        "can be replayed with netsketch_replay)"
+    );
+
+    std::string metrics_addr { "127.0.0.1" };
+    app.add_option(
+           "--metrics-address",
+           metrics_addr,
+           "The IPv4 address the metrics are served on"
+    )
+        ->capture_default_str();
+
+    uint16_t metrics_port { 0 };
+    app.add_option(
+           "--metrics-port",
+           metrics_port,
+           "The port the metrics are served on (in the Prometheus text "
+           "format over HTTP), zero turns the metrics endpoint off"
+    )
+        ->capture_default_str();
+
+    uint32_t trace_every { 0 };
+    app.add_option(
+           "--trace-every",
+           trace_every,
+           "Trace one in every so many actions through the stages of the "
+           "server (served with the metrics), zero turns tracing off"
+    )
+        ->capture_default_str();
+
+    size_t trace_exemplars { STAGE_DEFAULT_EXEMPLARS };
+    app.add_option(
+           "--trace-exemplars",
+           trace_exemplars,
+           "The number of slowest traced actions which are kept (served "
+           "on the /exemplars path of the metrics endpoint)"
+    )
+        ->capture_default_str();
+
+    size_t batch_limit { UPDATER_DEFAULT_BATCH_LIMIT };
+    app.add_option(
+           "--batch-limit",
+           batch_limit,
+           "The largest number of updates which are applied together (and "
+           "sent to every client in a single write)"
+    )
+        ->capture_default_str();
+
+    bool compression { true };
+    app.add_flag(
+           "--compression, !--no-compression",
+           compression,
+           "Compress large frames (like the canvas sent on joining) for the "
+           "clients which ask for it"
+    )
+        ->capture_default_str();
+
     CLI11_PARSE(app, argc, argv);
 
     server::Runner runner {};
 
-    if (!runner.setup(port, time_out)) {
+    if (!runner.setup(
+            port,
+            time_out,
+            record_path,
+            metrics_addr,
+            metrics_port,
+            trace_every,
+            trace_exemplars,
+            batch_limit,
+            compression
+        )) {
         return EXIT_FAILURE;
     }
 
@@ -0,0 +1,547 @@
+// server
+#include "metrics.hpp"
+#include "share.hpp"
+
+// common
+#include "../common/overload.hpp"
+#include "../common/threading.hpp"
+
+// unix
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+// cstd
+#include <cerrno>
+#include <cstring>
+
+// std
+#include <variant>
+
+// fmt
+#include <fmt/core.h>
+
+// spdlog
+#include <spdlog/spdlog.h>
+
+#define METRICS_BACKLOG (4)
+
+namespace server {
+
+const char* action_type_label(ActionType type)
+{
+    switch (type) {
+    case ActionType::LINE:
+        return "line";
+    case ActionType::RECTANGLE:
+        return "rectangle";
+    case ActionType::CIRCLE:
+        return "circle";
+    case ActionType::TEXT:
+        return "text";
+    case ActionType::STROKE:
+        return "stroke";
+    case ActionType::SELECT:
+        return "select";
+    case ActionType::DELETE:
+        return "delete";
+    case ActionType::UNDO:
+        return "undo";
+    case ActionType::CLEAR_MINE:
+        return "clear_mine";
+    case ActionType::CLEAR_ALL:
+        return "clear_all";
+    case ActionType::COUNT:
+        break;
+    }
+
+    return "unknown";
+}
+
+template <std::size_t N>
+void BucketHistogram<N>::render(
+    std::string& out,
+    const char* name,
+    const char* help,
+    double scale
+) const
+{
+    out += fmt::format("# HELP {} {}\n# TYPE {} histogram\n", name, help, name);
+
+    uint64_t cumulative { 0 };
+
+    for (std::size_t i = 0; i < N; i++) {
+        cumulative += m_counts[i].load(std::memory_order_relaxed);
+
+        out += fmt::format(
+            "{}_bucket{{le=\"{}\"}} {}\n",
+            name,
+            static_cast<double>(m_bounds[i]) * scale,
+            cumulative
+        );
+    }
+
+    cumulative += m_counts[N].load(std::memory_order_relaxed);
+
+    out += fmt::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, cumulative);
+    out += fmt::format(
+        "{}_sum {}\n",
+        name,
+        static_cast<double>(m_sum.load(std::memory_order_relaxed)) * scale
+    );
+    out += fmt::format("{}_count {}\n", name, cumulative);
+}
+
+ActionType action_type(const Action& action)
+{
+    return std::visit(
+        overload {
+            [](const Draw& draw) {
+                return std::visit(
+                    overload {
+                        [](const LineDraw&) {
+                            return ActionType::LINE;
+                        },
+                        [](const RectangleDraw&) {
+                            return ActionType::RECTANGLE;
+                        },
+                        [](const CircleDraw&) {
+                            return ActionType::CIRCLE;
+                        },
+                        [](const TextDraw&) {
+                            return ActionType::TEXT;
+                        },
+                        [](const StrokeDraw&) {
+                            return ActionType::STROKE;
+                        },
+                    },
+                    draw
+                );
+            },
+            [](const Select&) {
+                return ActionType::SELECT;
+            },
+            [](const Delete&) {
+                return ActionType::DELETE;
+            },
+            [](const Undo&) {
+                return ActionType::UNDO;
+            },
+            [](const Clear& clear) {
+                return clear.qualifier == Qualifier::MINE
+                           ? ActionType::CLEAR_MINE
+                           : ActionType::CLEAR_ALL;
+            },
+        },
+        action
+    );
+}
+
+void Metrics::count_action(const Action& action)
+{
+    actions_applied[static_cast<size_t>(action_type(action))].fetch_add(
+        1,
+        std::memory_order_relaxed
+    );
+}
+
+static void render_value(
+    std::string& out,
+    const char* name,
+    const char* type,
+    const char* help,
+    uint64_t value
+)
+{
+    out += fmt::format(
+        "# HELP {} {}\n# TYPE {} {}\n{} {}\n",
+        name,
+        help,
+        name,
+        type,
+        name,
+        value
+    );
+}
+
+#ifdef NETSKETCH_LOCKPROF
+
+// the totals of every profiled lock (see common/lockprof.hpp)
+static void render_locks(std::string& out)
+{
+    auto summaries = threading::lockprof::summarize();
+
+    struct Family {
+        const char* name;
+        const char* help;
+        uint64_t threading::lockprof::Summary::*field;
+        double divisor;
+    };
+
+    const Family families[] = {
+        { "netsketch_lock_acquisitions_total",
+          "The number of times a lock was acquired (or a condition "
+          "variable waited on)",
+          &threading::lockprof::Summary::acquisitions,
+          1 },
+        { "netsketch_lock_contentions_total",
+          "The number of times a lock was already held when acquired",
+          &threading::lockprof::Summary::contentions,
+          1 },
+        { "netsketch_lock_wait_seconds_total",
+          "The time spent waiting to acquire a lock (or to be notified)",
+          &threading::lockprof::Summary::wait_ns,
+          1e9 },
+        { "netsketch_lock_hold_seconds_total",
+          "The time a lock was held for",
+          &threading::lockprof::Summary::hold_ns,
+          1e9 },
+    };
+
+    for (const auto& family : families) {
+        out += fmt::format(
+            "# HELP {} {}\n# TYPE {} counter\n",
+            family.name,
+            family.help,
+            family.name
+        );
+
+        for (const auto& summary : summaries) {
+            out += fmt::format(
+                "{}{{lock=\"{}\",kind=\"{}\"}} {}\n",
+                family.name,
+                summary.name,
+                threading::lockprof::kind_name(summary.kind),
+                static_cast<double>(summary.*family.field) / family.divisor
+            );
+        }
+    }
+}
+
+#endif
+
+std::string render_metrics()
+{
+    Metrics& metrics = share::metrics;
+
+    // NOTE: the state which is guarded by a mutex is read first
+    // (one mutex at a time), so that a scrape holds up the rest
+    // of the server as little as possible
+
+    size_t connection_count { 0 };
+
+    {
+        threading::mutex_guard guard { share::connections_mutex };
+
+        connection_count = share::connections.size();
+    }
+
+    size_t user_count { 0 };
+
+    {
+        threading::mutex_guard guard { share::users_mutex };
+
+        user_count = share::users.size();
+    }
+
+    size_t timer_count { 0 };
+
+    {
+        threading::mutex_guard guard { share::timers_mutex };
+
+        timer_count = share::timers.size();
+    }
+
+    size_t queue_depth = share::payload_queue.size();
+    size_t draw_count { 0 };
+    size_t draw_capacity { 0 };
+
+    {
+        threading::mutex_guard guard { share::update_mutex };
+
+        draw_count = share::tagged_draw_vector.size();
+        draw_capacity = share::tagged_draw_vector.capacity();
+    }
+
+    std::string out {};
+
+    render_value(
+        out,
+        "netsketch_connections",
+        "gauge",
+        "The number of open client connections",
+        connection_count
+    );
+    render_value(
+        out,
+        "netsketch_users",
+        "gauge",
+        "The number of usernames which are in use",
+        user_count
+    );
+    render_value(
+        out,
+        "netsketch_connections_accepted_total",
+        "counter",
+        "The number of connections which have been accepted",
+        metrics.connections_accepted.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_connections_declined_total",
+        "counter",
+        "The number of connections which have been turned away",
+        metrics.connections_declined.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_payload_queue_depth",
+        "gauge",
+        "The number of updates waiting to be applied",
+        queue_depth
+    );
+    render_value(
+        out,
+        "netsketch_pending_adoption_timers",
+        "gauge",
+        "The number of disconnected users whose draws are yet to be adopted",
+        timer_count
+    );
+    render_value(
+        out,
+        "netsketch_canvas_draws",
+        "gauge",
+        "The number of draws on the canvas",
+        draw_count
+    );
+
+    // NOTE: only an estimate, the heap allocated by the strings
+    // of the draws (long texts and the points of strokes) is not
+    // counted
+    render_value(
+        out,
+        "netsketch_canvas_memory_bytes",
+        "gauge",
+        "An estimate of the memory held by the canvas",
+        draw_capacity * sizeof(TaggedDraw)
+    );
+
+    out += "# HELP netsketch_actions_applied_total The number of actions "
+           "applied to the canvas\n"
+           "# TYPE netsketch_actions_applied_total counter\n";
+
+    for (size_t i = 0; i < static_cast<size_t>(ActionType::COUNT); i++) {
+        out += fmt::format(
+            "netsketch_actions_applied_total{{type=\"{}\"}} {}\n",
+            action_type_label(static_cast<ActionType>(i)),
+            metrics.actions_applied[i].load(std::memory_order_relaxed)
+        );
+    }
+
+    render_value(
+        out,
+        "netsketch_adoptions_total",
+        "counter",
+        "The number of times the draws of a user were adopted",
+        metrics.adoptions.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_snapshot_cache_hits_total",
+        "counter",
+        "The number of new connections which were sent the cached full list",
+        metrics.snapshot_cache_hits.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_received_frames_total",
+        "counter",
+        "The number of frames received from clients",
+        metrics.frames_received.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_received_bytes_total",
+        "counter",
+        "The number of bytes received from clients (including headers)",
+        metrics.bytes_received.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_sent_frames_total",
+        "counter",
+        "The number of frames sent to clients",
+        metrics.frames_sent.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_sent_bytes_total",
+        "counter",
+        "The number of bytes sent to clients (including headers)",
+        metrics.bytes_sent.load(std::memory_order_relaxed)
+    );
+    render_value(
+        out,
+        "netsketch_write_errors_total",
+        "counter",
+        "The number of frames which could not be sent",
+        metrics.write_errors.load(std::memory_order_relaxed)
+    );
+
+    metrics.broadcast_duration.render(
+        out,
+        "netsketch_broadcast_duration_seconds",
+        "How long it takes to send an update to every connection",
+        1e-9
+    );
+    metrics.update_batch_size.render(
+        out,
+        "netsketch_update_batch_size",
+        "The number of updates applied (and sent) together",
+        1
+    );
+    metrics.snapshot_size.render(
+        out,
+        "netsketch_snapshot_size_bytes",
+        "The size of the full list sent to new connections",
+        1
+    );
+    metrics.snapshot_frame_size.render(
+        out,
+        "netsketch_snapshot_frame_size_bytes",
+        "The size of the frame the full list is sent in (after compression)",
+        1
+    );
+
+    share::stage_tracer.render_metrics(out);
+
+#ifdef NETSKETCH_LOCKPROF
+    render_locks(out);
+#endif
+
+    return out;
+}
+
+bool MetricsServer::setup(uint32_t ipv4_addr, uint16_t port)
+{
+    try {
+        m_sock.open(SOCK_STREAM, 0);
+
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(ipv4_addr);
+        addr.sin_port = htons(port);
+
+        m_sock.bind(&addr);
+
+        m_sock.listen(METRICS_BACKLOG);
+    } catch (std::runtime_error& error) {
+        fmt::println(
+            stderr,
+            "error: failed to serve metrics, reason {}",
+            error.what()
+        );
+
+        return false;
+    }
+
+    return true;
+}
+
+void MetricsServer::operator()()
+{
+    for (;;) {
+        IPv4Socket conn_sock {};
+
+        try {
+            conn_sock = m_sock.accept();
+        } catch (std::runtime_error& error) {
+            spdlog::warn("metrics: {}", error.what());
+
+            continue;
+        }
+
+        handle(conn_sock);
+    }
+}
+
+void MetricsServer::handle(const IPv4Socket& conn_sock) const
+{
+    // NOTE: only the path of the request matters, but it has
+    // to be read (up to the blank line which ends the headers)
+    // before answering, closing a socket with unread data
+    // resets the connection and the scraper would lose the
+    // response
+    std::string request {};
+
+    char buffer[1024];
+
+    while (request.find("\r\n\r\n") == std::string::npos
+           && request.size() < METRICS_MAX_REQUEST_SIZE) {
+        struct pollfd query = { conn_sock.native_handle(), POLLIN, 0 };
+
+        if (::poll(&query, 1, METRICS_REQUEST_TIMEOUT_MS) <= 0) {
+            return;
+        }
+
+        ssize_t size
+            = ::recv(conn_sock.native_handle(), buffer, sizeof(buffer), 0);
+
+        if (size <= 0) {
+            return;
+        }
+
+        request.append(buffer, static_cast<size_t>(size));
+    }
+
+    // the path is the second word of the request line
+    size_t path_start = request.find(' ');
+    size_t path_end = path_start == std::string::npos
+                          ? std::string::npos
+                          : request.find(' ', path_start + 1);
+
+    std::string path = path_end == std::string::npos
+                           ? std::string {}
+                           : request.substr(path_start + 1, path_end - path_start - 1);
+
+    std::string body = path == METRICS_EXEMPLARS_PATH
+                           ? share::stage_tracer.render_exemplars()
+                           : render_metrics();
+
+    std::string response = fmt::format(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: {}\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "{}",
+        body.size(),
+        body
+    );
+
+    size_t offset { 0 };
+
+    while (offset < response.size()) {
+        ssize_t size = ::send(
+            conn_sock.native_handle(),
+            response.data() + offset,
+            response.size() - offset,
+            MSG_NOSIGNAL
+        );
+
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            spdlog::warn("metrics: send(): {}", strerror(errno));
+
+            return;
+        }
+
+        offset += static_cast<size_t>(size);
+    }
+}
+
+} // namespace server
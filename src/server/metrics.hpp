@@ -0,0 +1,204 @@
+#pragma once
+
+// common
+#include "../common/network.hpp"
+#include "../common/types.hpp"
+
+// std
+#include <array>
+#include <atomic>
+#include <string>
+
+// cstd
+#include <cstdint>
+
+// The largest scrape request which is read (anything after
+// this is ignored)
+#define METRICS_MAX_REQUEST_SIZE (8192)
+
+// How long (in milliseconds) a scraper gets to send its
+// request
+#define METRICS_REQUEST_TIMEOUT_MS (1000)
+
+// The path which serves the slowest traced actions instead of
+// the metrics
+#define METRICS_EXEMPLARS_PATH "/exemplars"
+
+namespace server {
+
+// A histogram with fixed bucket bounds, as Prometheus expects
+// them. Values (and the bounds) are integers in some base unit
+// (e.g. nanoseconds), they are scaled when rendered.
+
+template <std::size_t N>
+class BucketHistogram {
+   public:
+    explicit BucketHistogram(const std::array<uint64_t, N>& bounds)
+        : m_bounds { bounds }
+    {
+    }
+
+    void observe(uint64_t value)
+    {
+        std::size_t i = 0;
+
+        while (i < N && value > m_bounds[i]) {
+            i++;
+        }
+
+        m_counts[i].fetch_add(1, std::memory_order_relaxed);
+
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void render(
+        std::string& out,
+        const char* name,
+        const char* help,
+        double scale
+    ) const;
+
+   private:
+    std::array<uint64_t, N> m_bounds {};
+
+    // the last bucket is +Inf
+    std::array<std::atomic<uint64_t>, N + 1> m_counts {};
+
+    std::atomic<uint64_t> m_sum { 0 };
+};
+
+// The kinds of actions which are counted separately
+enum class ActionType : uint8_t {
+    LINE,
+    RECTANGLE,
+    CIRCLE,
+    TEXT,
+    STROKE,
+    SELECT,
+    DELETE,
+    UNDO,
+    CLEAR_MINE,
+    CLEAR_ALL,
+    COUNT,
+};
+
+ActionType action_type(const Action& action);
+
+const char* action_type_label(ActionType type);
+
+// All the counters of the server, they are bumped where the
+// events happen (without taking any locks). Everything which
+// is already kept elsewhere (like the number of connections or
+// the size of the canvas) is instead read when scraped.
+
+struct Metrics {
+    std::atomic<uint64_t> connections_accepted { 0 };
+    std::atomic<uint64_t> connections_declined { 0 };
+
+    std::atomic<uint64_t> frames_received { 0 };
+    std::atomic<uint64_t> bytes_received { 0 };
+
+    std::atomic<uint64_t> frames_sent { 0 };
+    std::atomic<uint64_t> bytes_sent { 0 };
+    std::atomic<uint64_t> write_errors { 0 };
+
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(ActionType::COUNT)>
+        actions_applied {};
+    std::atomic<uint64_t> adoptions { 0 };
+
+    // how many new connections were sent the cached snapshot
+    std::atomic<uint64_t> snapshot_cache_hits { 0 };
+
+    // how long it takes to write an update to every connection
+    // (in nanoseconds)
+    BucketHistogram<14> broadcast_duration { {
+        10'000,
+        25'000,
+        50'000,
+        100'000,
+        250'000,
+        500'000,
+        1'000'000,
+        2'500'000,
+        5'000'000,
+        10'000'000,
+        25'000'000,
+        50'000'000,
+        100'000'000,
+        1'000'000'000,
+    } };
+
+    // how many updates the updater applies at once (and sends
+    // in a single write to every connection)
+    BucketHistogram<10> update_batch_size { {
+        1,
+        2,
+        4,
+        8,
+        16,
+        32,
+        64,
+        128,
+        256,
+        512,
+    } };
+
+    // the size of the full list sent to every new connection
+    // (in bytes)
+    BucketHistogram<10> snapshot_size { {
+        1 << 10,
+        1 << 12,
+        1 << 14,
+        1 << 16,
+        1 << 18,
+        1 << 20,
+        1 << 22,
+        1 << 24,
+        1 << 26,
+        1 << 28,
+    } };
+
+    // the size of the frame the full list goes out in, which
+    // is smaller than the full list when it is compressed (in
+    // bytes)
+    BucketHistogram<10> snapshot_frame_size { {
+        1 << 10,
+        1 << 12,
+        1 << 14,
+        1 << 16,
+        1 << 18,
+        1 << 20,
+        1 << 22,
+        1 << 24,
+        1 << 26,
+        1 << 28,
+    } };
+
+    void count_action(const Action& action);
+};
+
+// renders every metric in the Prometheus text format
+std::string render_metrics();
+
+// Serves the metrics over HTTP (which is what Prometheus
+// scrapes), every request gets the metrics back no matter
+// the path (except for the exemplars path, which gets the
+// slowest traced actions). Scrapes are handled one at a time.
+
+class MetricsServer {
+   public:
+    MetricsServer() = default;
+
+    // starts listening, so that a bad address or port is
+    // caught before the server starts
+    bool setup(uint32_t ipv4_addr, uint16_t port);
+
+    [[noreturn]] void operator()();
+
+   private:
+    void handle(const IPv4Socket& conn_sock) const;
+
+    IPv4Socket m_sock {};
+};
+
+} // namespace server
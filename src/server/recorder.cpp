@@ -0,0 +1,125 @@
+// server
+#include "recorder.hpp"
+
+// unix
+#include <pthread.h>
+
+// fmt
+#include <fmt/core.h>
+
+namespace server {
+
+bool Recorder::open(const std::string& path)
+{
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+
+    if (!m_file) {
+        fmt::println(stderr, "error: could not open {}", path);
+
+        return false;
+    }
+
+    m_archive = std::make_unique<cereal::PortableBinaryOutputArchive>(m_file);
+
+    (*m_archive)(TraceHeader {});
+
+    m_start = std::chrono::steady_clock::now();
+
+    m_is_open = true;
+
+    return true;
+}
+
+bool Recorder::is_open() const
+{
+    return m_is_open;
+}
+
+uint32_t Recorder::connect(const std::string& username)
+{
+    if (!m_is_open) {
+        return 0;
+    }
+
+    uint32_t connection { 0 };
+
+    {
+        threading::mutex_guard guard { m_mutex };
+
+        connection = m_next_connection++;
+    }
+
+    write(TraceEvent { TraceEventType::CONNECT, 0, connection, username });
+
+    return connection;
+}
+
+void Recorder::frame(uint32_t connection, const ByteString& bytes)
+{
+    if (!m_is_open) {
+        return;
+    }
+
+    write(TraceEvent { TraceEventType::FRAME, 0, connection, bytes });
+}
+
+void Recorder::disconnect(uint32_t connection)
+{
+    if (!m_is_open) {
+        return;
+    }
+
+    write(TraceEvent { TraceEventType::DISCONNECT, 0, connection, {} });
+}
+
+void Recorder::write(TraceEvent event)
+{
+    // NOTE: connection handlers are cancelled on shutdown and
+    // writing to the file is a cancellation point, a handler
+    // cancelled half way through would leave the mutex locked
+    // (and a partial event in the trace)
+    int old_state { 0 };
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+
+    {
+        threading::mutex_guard guard { m_mutex };
+
+        // NOTE: stamped whilst holding the lock so the events
+        // in the trace are in order
+        if (m_archive) {
+            event.at_us = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - m_start
+                )
+                    .count()
+            );
+
+            (*m_archive)(event);
+        }
+    }
+
+    pthread_setcancelstate(old_state, nullptr);
+}
+
+void Recorder::close()
+{
+    if (!m_is_open) {
+        return;
+    }
+
+    threading::mutex_guard guard { m_mutex };
+
+    m_archive.reset();
+
+    m_file.close();
+
+    m_is_open = false;
+}
+
+Recorder::~Recorder()
+{
+    close();
+}
+
+} // namespace server
@@ -0,0 +1,65 @@
+#pragma once
+
+// common
+#include "../common/bytes.hpp"
+#include "../common/threading.hpp"
+#include "../common/trace.hpp"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+
+// cstd
+#include <cstdint>
+
+namespace server {
+
+// The recorder writes every frame the server receives (along
+// with when and on which connection it was received) to a
+// trace, which can later be replayed against a server with
+// netsketch_replay. Unless it is opened every call is a no-op.
+
+class Recorder {
+   public:
+    Recorder() = default;
+
+    Recorder(const Recorder&) = delete;
+
+    Recorder& operator=(const Recorder&) = delete;
+
+    bool open(const std::string& path);
+
+    [[nodiscard]] bool is_open() const;
+
+    // returns the identifier of the new connection which the
+    // rest of its events are recorded under
+    uint32_t connect(const std::string& username);
+
+    void frame(uint32_t connection, const ByteString& bytes);
+
+    void disconnect(uint32_t connection);
+
+    void close();
+
+    ~Recorder();
+
+   private:
+    void write(TraceEvent event);
+
+    std::atomic<bool> m_is_open { false };
+
+    threading::mutex m_mutex { "recorder_mutex" };
+
+    std::ofstream m_file {};
+
+    std::unique_ptr<cereal::PortableBinaryOutputArchive> m_archive {};
+
+    std::chrono::steady_clock::time_point m_start {};
+
+    uint32_t m_next_connection { 0 };
+};
+
+} // namespace server
@@ -1,4 +1,5 @@
 // server
+#include "metrics.hpp"
 #include "runner.hpp"
 #include "server.hpp"
 #include "share.hpp"
@@ -17,6 +18,7 @@
 #include "../bench/bench.hpp"
 
 // unix
+#include <arpa/inet.h>
 #include <poll.h>
 #include <unistd.h>
 
@@ -58,13 +60,39 @@ static void sigint_handler(int)
     }
 
     share::updater_thread.cancel();
+
+    if (share::metrics_thread.is_initialized()) {
+        share::metrics_thread.cancel();
+    }
 }
 
-bool Runner::setup(uint16_t port, float time_out)
+bool Runner::setup(
+    uint16_t port,
+    float time_out,
+    const std::string& record_path,
+    const std::string& metrics_addr,
+    uint16_t metrics_port,
+    uint32_t trace_every,
+    size_t trace_exemplars,
+    size_t batch_limit,
+    bool compression
+)
 {
+    // NOTE: checked before any thread is started, the runner
+    // would wait on them forever otherwise
+    if (batch_limit == 0) {
+        fmt::println(stderr, "error: the batch limit has to be at least 1");
+
+        return false;
+    }
+
     // set timeout
     server::share::time_out = time_out;
 
+    if (!compression) {
+        server::share::capabilities &= ~CAPABILITY_COMPRESSION;
+    }
+
     // setup signal handler
 
     // NOTE: using sigaction because the man page for signal says so
@@ -98,16 +126,62 @@ bool Runner::setup(uint16_t port, float time_out)
         return false;
     }
 
+    if (!record_path.empty()) {
+        if (!share::recorder.open(record_path)) {
+            return false;
+        }
+
+        spdlog::info("recording traffic to {}", record_path);
+    }
+
+    SETUP_BENCHMARKS;
+
+    share::stage_tracer.setup(trace_every, trace_exemplars);
+
+    if (trace_every != 0) {
+        spdlog::info("tracing one in every {} actions", trace_every);
+    }
+
+    if (metrics_port != 0) {
+        in_addr addr {};
+
+        if (inet_pton(AF_INET, metrics_addr.c_str(), &addr) != 1) {
+            fmt::println(
+                stderr,
+                "error: invalid metrics address {}",
+                metrics_addr
+            );
+
+            return false;
+        }
+
+        MetricsServer metrics_server {};
+
+        if (!metrics_server.setup(ntohl(addr.s_addr), metrics_port)) {
+            return false;
+        }
+
+        // NOTE: started here rather than in run() since the
+        // metrics do not depend on anything run() sets up
+        share::metrics_thread
+            = threading::thread { std::move(metrics_server) };
+
+        spdlog::info(
+            "serving metrics on {}:{}",
+            metrics_addr,
+            metrics_port
+        );
+    }
+
     m_port = port;
+    m_batch_limit = batch_limit;
 
     return true;
 }
 
 [[nodiscard]] bool Runner::run() const
 {
-    START_BENCHMARK_THREAD;
-
-    share::updater_thread = threading::thread { Updater {} };
+    share::updater_thread = threading::thread { Updater { m_batch_limit } };
 
     Server server { m_port };
 
@@ -121,6 +195,9 @@ Runner::~Runner()
     if (share::updater_thread.is_initialized())
         share::updater_thread.join();
 
+    if (share::metrics_thread.is_initialized())
+        share::metrics_thread.join();
+
     {
         threading::mutex_guard guard { share::timers_mutex };
 
@@ -130,7 +207,13 @@ Runner::~Runner()
         share::timers.clear();
     }
 
-    END_BENCHMARK_THREAD;
+    share::recorder.close();
+
+    share::stage_tracer.report();
+
+    REPORT_BENCHMARKS;
+
+    REPORT_LOCKS;
 
 #ifdef NETSKETCH_DUMPHASH
     spdlog::debug(
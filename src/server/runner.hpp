@@ -1,15 +1,29 @@
 #pragma once
 
 // cstd
+#include <cstddef>
 #include <cstdint>
 
+// std
+#include <string>
+
 namespace server {
 
 class Runner {
    public:
     Runner() = default;
 
-    bool setup(uint16_t port, float time_out);
+    bool setup(
+        uint16_t port,
+        float time_out,
+        const std::string& record_path,
+        const std::string& metrics_addr,
+        uint16_t metrics_port,
+        uint32_t trace_every,
+        size_t trace_exemplars,
+        size_t batch_limit,
+        bool compression
+    );
 
     [[nodiscard]] bool run() const;
 
@@ -17,6 +31,7 @@ class Runner {
 
    private:
     uint16_t m_port {};
+    size_t m_batch_limit {};
 };
 
 } // namespace client
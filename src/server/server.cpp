@@ -22,6 +22,7 @@
 #include "../common/threading.hpp"
 
 // std
+#include <algorithm>
 #include <optional>
 
 // bench
@@ -58,6 +59,11 @@ void Server::operator()()
 
         share::updater_thread.cancel();
 
+        // NOTE: otherwise the runner would wait on it forever
+        if (share::metrics_thread.is_initialized()) {
+            share::metrics_thread.cancel();
+        }
+
         return;
     }
 
@@ -135,17 +141,22 @@ void Server::request_loop()
 
         conn_sock.make_blocking();
 
-        auto username = is_valid_username(Channel { conn_sock });
+        share::stage_tracer.enable_timestamps(conn_sock.native_handle());
 
-        if (!username.has_value()) {
+        auto handshake = is_valid_username(Channel { conn_sock });
+
+        if (!handshake.has_value()) {
             continue;
         }
 
-        {
-            threading::mutex_guard guard { share::users_mutex };
+        const UserName& user_name = handshake->user_name;
 
-            share::users.insert(*username);
-        }
+        const std::string& username = user_name.username;
+
+        share::metrics.connections_accepted.fetch_add(
+            1,
+            std::memory_order_relaxed
+        );
 
         {
             threading::mutex_guard guard { share::timers_mutex };
@@ -153,10 +164,10 @@ void Server::request_loop()
             for (auto iter = share::timers.cbegin();
                  iter != share::timers.cend();
                  iter++) {
-                if (iter->get()->username == *username) {
+                if (iter->get()->user == user_name.user) {
                     share::timers.erase(iter);
 
-                    spdlog::info("{} reconnected", *username);
+                    spdlog::info("{} reconnected", username);
 
                     break;
                 }
@@ -174,8 +185,14 @@ void Server::request_loop()
         {
             threading::mutex_guard guard { share::connections_mutex };
 
-            share::connections[conn_sock.native_handle()]
-                = std::move(conn_sock);
+            // NOTE: the descriptor is taken before the socket is
+            // moved into the connection
+            int fd = conn_sock.native_handle();
+
+            share::connections[fd] = std::make_shared<share::Connection>(
+                share::Connection { std::move(conn_sock),
+                                    handshake->capabilities }
+            );
         }
 
         {
@@ -185,7 +202,11 @@ void Server::request_loop()
             // as that thread would not be cancelled.
             threading::thread::test_cancel();
 
-            share::threads.emplace_back(ConnHandler { conn_sock_ref, *username }
+            share::threads.emplace_back(
+                ConnHandler { conn_sock_ref,
+                              username,
+                              user_name.user,
+                              handshake->capabilities }
             );
 
             // trim any finished threads
@@ -205,7 +226,23 @@ void Server::request_loop()
     pthread_cleanup_pop(1);
 }
 
-std::optional<std::string> Server::is_valid_username(Channel channel)
+// Lets the client know why it was turned away
+static void decline(Channel& channel, std::string reason)
+{
+    share::metrics.connections_declined.fetch_add(
+        1,
+        std::memory_order_relaxed
+    );
+
+    auto status
+        = channel.write(serialize<Payload>(Decline { std::move(reason) }));
+
+    if (status != ChannelErrorCode::OK) {
+        spdlog::warn("responding failed, reason {}", status.what());
+    }
+}
+
+std::optional<Handshake> Server::is_valid_username(Channel channel)
 {
     auto [res, read_status] = channel.read(60000);
 
@@ -232,7 +269,36 @@ std::optional<std::string> Server::is_valid_username(Channel channel)
         return {};
     }
 
-    auto username = std::get<Username>(payload).username;
+    const auto& request = std::get<Username>(payload);
+
+    auto username = request.username;
+
+    // settle on the highest version both sides speak
+    ProtocolVersion version
+        = std::min<ProtocolVersion>(request.version_max, PROTOCOL_VERSION_MAX);
+
+    if (version < request.version_min || version < PROTOCOL_VERSION_MIN) {
+        spdlog::warn(
+            "{} speaks protocol versions {} to {}, which are not supported",
+            username,
+            request.version_min,
+            request.version_max
+        );
+
+        decline(
+            channel,
+            fmt::format(
+                "the server only speaks protocol versions {} to {}",
+                PROTOCOL_VERSION_MIN,
+                PROTOCOL_VERSION_MAX
+            )
+        );
+
+        return {};
+    }
+
+    // NOTE: a capability is only used when both sides have it
+    Capabilities capabilities = request.capabilities & share::capabilities;
 
     bool is_valid { true };
 
@@ -243,36 +309,72 @@ std::optional<std::string> Server::is_valid_username(Channel channel)
     }
 
     if (is_valid) {
-        ByteString req { serialize<Payload>(Decline {
-            fmt::format("user with name {} already exists", username) }) };
+        decline(
+            channel,
+            fmt::format("user with name {} already exists", username)
+        );
 
-        {
-            auto status = channel.write(req);
+        return {};
+    }
 
-            if (status != ChannelErrorCode::OK) {
-                spdlog::warn(
-                    "responding failed reason {}",
-                    var_type(payload).name()
-                );
+    UserId user { 0 };
 
-                return {};
-            }
+    bool is_new { false };
+
+    {
+        threading::mutex_guard guard { share::users_mutex };
+
+        share::users.insert(username);
+
+        auto iter = share::user_ids.find(username);
+
+        if (iter == share::user_ids.end()) {
+            user = static_cast<UserId>(share::user_names.size());
+
+            share::user_ids.emplace(username, user);
+            share::user_names.push_back(username);
+
+            is_new = true;
+        } else {
+            user = iter->second;
         }
+    }
 
-        return {};
+    // NOTE: announced through the updater so that every client
+    // knows of the username before seeing any of its actions
+    if (is_new) {
+        share::payload_queue.push(QueuedPayload { Payload {
+            UserNames { { UserName { user, username } } } } });
     }
 
-    ByteString req { serialize<Payload>(Accept {}) };
+    ByteString req { serialize<Payload>(
+        Accept { user, version, capabilities }
+    ) };
 
     auto write_status = channel.write(req);
 
     if (write_status != ChannelErrorCode::OK) {
+        {
+            threading::mutex_guard guard { share::users_mutex };
+
+            share::users.erase(username);
+        }
+
         spdlog::warn("writing failed, reason {}", write_status.what());
 
         return {};
     }
 
-    return std::make_optional(username);
+    spdlog::debug(
+        "{} settled on protocol version {} with capabilities {:#x}",
+        username,
+        version,
+        capabilities
+    );
+
+    return std::make_optional(
+        Handshake { UserName { user, username }, version, capabilities }
+    );
 }
 
 } // namespace server
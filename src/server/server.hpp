@@ -6,9 +6,17 @@
 // common
 #include "../common/channel.hpp"
 #include "../common/network.hpp"
+#include "../common/types.hpp"
 
 namespace server {
 
+// What the handshake settled on for a connection
+struct Handshake {
+    UserName user_name {};
+    ProtocolVersion version { PROTOCOL_VERSION_MAX };
+    Capabilities capabilities { 0 };
+};
+
 class Server {
    public:
     explicit Server(uint16_t port);
@@ -18,7 +26,7 @@ class Server {
    private:
     void request_loop();
 
-    std::optional<std::string> is_valid_username(Channel channel);
+    std::optional<Handshake> is_valid_username(Channel channel);
 
     IPv4Socket m_sock {};
 
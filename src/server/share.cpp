@@ -3,24 +3,37 @@
 
 namespace server::share {
 
-threading::mutex users_mutex {};
+threading::mutex users_mutex { "users_mutex" };
 std::unordered_set<std::string> users {};
+std::unordered_map<std::string, UserId> user_ids {};
+std::vector<std::string> user_names {};
 
-threading::mutex threads_mutex {};
+threading::mutex threads_mutex { "threads_mutex" };
 std::list<threading::thread> threads {};
 threading::thread updater_thread {};
 
-threading::mutex connections_mutex {};
-std::unordered_map<int, IPv4Socket> connections {};
+threading::mutex connections_mutex { "connections_mutex" };
+std::unordered_map<int, std::shared_ptr<Connection>> connections {};
 
-threading::mutex timers_mutex {};
+threading::mutex timers_mutex { "timers_mutex" };
 std::list<std::unique_ptr<TimerData>> timers;
 
-threading::mutex update_mutex {};
-threading::cond_var update_cond {};
+threading::mutex update_mutex { "update_mutex" };
 TaggedDrawVector tagged_draw_vector {};
-std::queue<Payload> payload_queue {};
+SnapshotCache snapshot_cache {};
+uint64_t update_sequence { 0 };
+
+threading::mpsc_queue<QueuedPayload> payload_queue { PAYLOAD_QUEUE_CAPACITY };
 
 float time_out { 10 };
 
+Capabilities capabilities { CAPABILITIES_ALL };
+
+Recorder recorder {};
+
+Metrics metrics {};
+threading::thread metrics_thread {};
+
+StageTracer stage_tracer {};
+
 } // namespace server::share
@@ -6,20 +6,69 @@
 #include "../common/types.hpp"
 
 // std
+#include <array>
+#include <limits>
 #include <list>
 #include <memory>
-#include <queue>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 // spdlog
 #include <spdlog/logger.h>
 
 // server
+#include "metrics.hpp"
+#include "recorder.hpp"
+#include "stages.hpp"
 #include "timing.hpp"
 
+// The number of updates which can be waiting for the updater,
+// connection handlers block once it is full
+#define PAYLOAD_QUEUE_CAPACITY (4096)
+
 namespace server::share {
 
+// A connection as the updater sees it
+//
+// NOTE: it is shared so that the updater can write to it
+// without holding the connections mutex, the socket stays open
+// until the updater is done with it
+struct Connection {
+    IPv4Socket sock {};
+    // what the handshake settled on
+    Capabilities capabilities { 0 };
+    // held while writing to the socket, so that the bytes of a
+    // broadcast never end up in the middle of the snapshot
+    threading::mutex write_mutex { "connection_write_mutex" };
+    // the sequence of the last batch of updates the snapshot of
+    // the connection already has, the updater does not send it
+    // any batch up to it (nor any batch before the snapshot)
+    //
+    // NOTE: guarded by the write mutex
+    uint64_t snapshot_sequence { std::numeric_limits<uint64_t>::max() };
+};
+
+// The canvas as it is sent to new connections, serialized
+// (and compressed once a connection asks for it). It is
+// reused by every connection which joins before the canvas
+// changes again, at which point the updater clears it.
+//
+// NOTE: both are indexed by whether the snapshot is in the
+// compact encoding (the lowest bit) and whether it can have
+// strokes, please look at SnapshotCache::index
+struct SnapshotCache {
+    std::array<std::optional<ByteString>, 4> payloads {};
+    std::array<std::optional<ByteString>, 4> compressed_frames {};
+
+    static size_t index(Capabilities capabilities)
+    {
+        return ((capabilities & CAPABILITY_COMPACT) != 0 ? 1 : 0)
+               | ((capabilities & CAPABILITY_STROKES) != 0 ? 2 : 0);
+    }
+};
+
 // NOTE: this namespace contains all the globals the
 // application uses. These globals have been
 // logically grouped according to their specifically
@@ -28,22 +77,41 @@ namespace server::share {
 
 extern threading::mutex users_mutex;
 extern std::unordered_set<std::string> users;
+// every username which ever connected, the identifier of a
+// username is its index into user_names
+extern std::unordered_map<std::string, UserId> user_ids;
+extern std::vector<std::string> user_names;
 
 extern threading::mutex threads_mutex;
 extern std::list<threading::thread> threads;
 extern threading::thread updater_thread;
 
 extern threading::mutex connections_mutex;
-extern std::unordered_map<int, IPv4Socket> connections;
+extern std::unordered_map<int, std::shared_ptr<Connection>> connections;
 
 extern threading::mutex timers_mutex;
 extern std::list<std::unique_ptr<TimerData>> timers;
 
 extern threading::mutex update_mutex;
-extern threading::cond_var update_cond;
 extern TaggedDrawVector tagged_draw_vector;
-extern std::queue<Payload> payload_queue;
+extern SnapshotCache snapshot_cache;
+// the sequence of the last batch of updates the updater applied
+extern uint64_t update_sequence;
+
+// NOTE: the queue is lock-free, the connection handlers (and
+// the timers) push onto it and only the updater pops from it
+extern threading::mpsc_queue<QueuedPayload> payload_queue;
 
 extern float time_out;
 
+// the capabilities the server offers in the handshake
+extern Capabilities capabilities;
+
+extern Recorder recorder;
+
+extern Metrics metrics;
+extern threading::thread metrics_thread;
+
+extern StageTracer stage_tracer;
+
 } // namespace server::share
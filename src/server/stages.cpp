@@ -0,0 +1,322 @@
+// server
+#include "stages.hpp"
+
+// unix
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+
+// cstd
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+// std
+#include <algorithm>
+#include <optional>
+
+// fmt
+#include <fmt/core.h>
+
+// spdlog
+#include <spdlog/spdlog.h>
+
+namespace server {
+
+const char* stage_name(Stage stage)
+{
+    switch (stage) {
+    case Stage::KERNEL:
+        return "kernel";
+    case Stage::HANDLER:
+        return "handler";
+    case Stage::QUEUE:
+        return "queue";
+    case Stage::APPLY:
+        return "apply";
+    case Stage::BROADCAST:
+        return "broadcast";
+    case Stage::COUNT:
+        break;
+    }
+
+    return "total";
+}
+
+static constexpr size_t TOTAL { static_cast<size_t>(Stage::COUNT) };
+
+static bool is_exemplar_faster(const ActionTrace& lhs, const ActionTrace& rhs)
+{
+    return lhs.total_ns() > rhs.total_ns();
+}
+
+// how long the oldest byte which is waiting to be read has
+// been waiting (if the kernel timestamped it)
+static std::optional<uint64_t> waiting_ns(int sock_fd)
+{
+    char byte { 0 };
+
+    struct iovec iov { &byte, 1 };
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+
+    struct msghdr msg { };
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (::recvmsg(sock_fd, &msg, MSG_PEEK | MSG_DONTWAIT) <= 0) {
+        return std::nullopt;
+    }
+
+    struct timespec now { };
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET
+            || cmsg->cmsg_type != SCM_TIMESTAMPING) {
+            continue;
+        }
+
+        scm_timestamping stamps {};
+
+        std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+
+        // NOTE: the software timestamp is the first one
+        const struct timespec& stamp = stamps.ts[0];
+
+        if (stamp.tv_sec == 0 && stamp.tv_nsec == 0) {
+            return std::nullopt;
+        }
+
+        int64_t waited = (now.tv_sec - stamp.tv_sec) * 1'000'000'000
+                         + (now.tv_nsec - stamp.tv_nsec);
+
+        return static_cast<uint64_t>(std::max<int64_t>(waited, 0));
+    }
+
+    return std::nullopt;
+}
+
+void StageTracer::setup(uint32_t sample_every, size_t exemplar_count)
+{
+    m_sample_every = sample_every;
+    m_exemplar_count = exemplar_count;
+}
+
+void StageTracer::enable_timestamps(int sock_fd) const
+{
+    if (!is_enabled()) {
+        return;
+    }
+
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags))
+        == -1) {
+        spdlog::warn(
+            "[{}] could not turn on receive timestamps, reason {}",
+            sock_fd,
+            strerror(errno)
+        );
+    }
+}
+
+bool StageTracer::should_sample()
+{
+    if (!is_enabled()) {
+        return false;
+    }
+
+    return m_frames.fetch_add(1, std::memory_order_relaxed) % m_sample_every
+           == 0;
+}
+
+std::unique_ptr<ActionTrace>
+StageTracer::start(const std::string& username, int sock_fd)
+{
+    auto trace = std::make_unique<ActionTrace>();
+
+    trace->id = m_traced.fetch_add(1, std::memory_order_relaxed);
+    trace->username = username;
+    trace->last = ActionTrace::Clock::now();
+
+    auto waited = waiting_ns(sock_fd);
+
+    if (waited.has_value()) {
+        trace->durations_ns[static_cast<size_t>(Stage::KERNEL)] = *waited;
+        trace->has_kernel = true;
+    }
+
+    return trace;
+}
+
+void StageTracer::finish(std::unique_ptr<ActionTrace> trace)
+{
+    threading::mutex_guard guard { m_mutex };
+
+    for (size_t i = 0; i < TOTAL; i++) {
+        // NOTE: a trace without a kernel timestamp would only
+        // drag the kernel stage down
+        if (i == static_cast<size_t>(Stage::KERNEL) && !trace->has_kernel) {
+            continue;
+        }
+
+        m_histograms[i].record(trace->durations_ns[i]);
+        m_sums_ns[i] += trace->durations_ns[i];
+    }
+
+    m_histograms[TOTAL].record(trace->total_ns());
+    m_sums_ns[TOTAL] += trace->total_ns();
+
+    if (m_exemplar_count == 0) {
+        return;
+    }
+
+    if (m_exemplars.size() < m_exemplar_count) {
+        m_exemplars.push_back(std::move(*trace));
+
+        std::push_heap(
+            m_exemplars.begin(),
+            m_exemplars.end(),
+            is_exemplar_faster
+        );
+    } else if (trace->total_ns() > m_exemplars.front().total_ns()) {
+        std::pop_heap(m_exemplars.begin(), m_exemplars.end(), is_exemplar_faster);
+
+        m_exemplars.back() = std::move(*trace);
+
+        std::push_heap(
+            m_exemplars.begin(),
+            m_exemplars.end(),
+            is_exemplar_faster
+        );
+    }
+}
+
+void StageTracer::render_metrics(std::string& out)
+{
+    if (!is_enabled()) {
+        return;
+    }
+
+    threading::mutex_guard guard { m_mutex };
+
+    out += "# HELP netsketch_stage_duration_seconds How long sampled actions "
+           "spend in every stage of the server\n"
+           "# TYPE netsketch_stage_duration_seconds summary\n";
+
+    for (size_t i = 0; i <= TOTAL; i++) {
+        const char* name = stage_name(static_cast<Stage>(i));
+
+        for (double quantile : { 0.5, 0.9, 0.99, 0.999 }) {
+            out += fmt::format(
+                "netsketch_stage_duration_seconds{{stage=\"{}\",quantile=\"{}"
+                "\"}} {}\n",
+                name,
+                quantile,
+                static_cast<double>(m_histograms[i].percentile(quantile * 100))
+                    / 1e9
+            );
+        }
+
+        out += fmt::format(
+            "netsketch_stage_duration_seconds_sum{{stage=\"{}\"}} {}\n",
+            name,
+            static_cast<double>(m_sums_ns[i]) / 1e9
+        );
+        out += fmt::format(
+            "netsketch_stage_duration_seconds_count{{stage=\"{}\"}} {}\n",
+            name,
+            m_histograms[i].count()
+        );
+    }
+}
+
+std::string StageTracer::render_exemplars()
+{
+    std::vector<ActionTrace> exemplars {};
+
+    {
+        threading::mutex_guard guard { m_mutex };
+
+        exemplars = m_exemplars;
+    }
+
+    std::sort(exemplars.begin(), exemplars.end(), is_exemplar_faster);
+
+    std::string out = fmt::format(
+        "{:>10} {:<16} {:<10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+        "id",
+        "username",
+        "action",
+        "kernel µs",
+        "handler µs",
+        "queue µs",
+        "apply µs",
+        "bcast µs",
+        "total µs"
+    );
+
+    for (const auto& trace : exemplars) {
+        out += fmt::format(
+            "{:>10} {:<16} {:<10}",
+            trace.id,
+            trace.username,
+            action_type_label(trace.action)
+        );
+
+        for (size_t i = 0; i < TOTAL; i++) {
+            if (i == static_cast<size_t>(Stage::KERNEL) && !trace.has_kernel) {
+                out += fmt::format(" {:>10}", "-");
+            } else {
+                out += fmt::format(
+                    " {:>10.1f}",
+                    static_cast<double>(trace.durations_ns[i]) / 1e3
+                );
+            }
+        }
+
+        out += fmt::format(
+            " {:>10.1f}\n",
+            static_cast<double>(trace.total_ns()) / 1e3
+        );
+    }
+
+    return out;
+}
+
+void StageTracer::report()
+{
+    if (!is_enabled()) {
+        return;
+    }
+
+    {
+        threading::mutex_guard guard { m_mutex };
+
+        for (size_t i = 0; i <= TOTAL; i++) {
+            const auto& histogram = m_histograms[i];
+
+            spdlog::info(
+                "stage {}: count {}, p50 {}µs, p90 {}µs, p99 {}µs, "
+                "p99.9 {}µs, max {}µs",
+                stage_name(static_cast<Stage>(i)),
+                histogram.count(),
+                histogram.percentile(50) / 1000,
+                histogram.percentile(90) / 1000,
+                histogram.percentile(99) / 1000,
+                histogram.percentile(99.9) / 1000,
+                histogram.max() / 1000
+            );
+        }
+    }
+
+    spdlog::info("slowest traced actions:\n{}", render_exemplars());
+}
+
+} // namespace server
@@ -0,0 +1,175 @@
+#pragma once
+
+// common
+#include "../common/bytes.hpp"
+#include "../common/histogram.hpp"
+#include "../common/threading.hpp"
+#include "../common/types.hpp"
+
+// server
+#include "metrics.hpp"
+
+// std
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+// The default number of slowest traced actions which are kept
+#define STAGE_DEFAULT_EXEMPLARS (10)
+
+namespace server {
+
+// The stages an action passes through inside the server, in
+// the order in which it passes through them
+enum class Stage : uint8_t {
+    // from arriving at the socket until the connection handler
+    // starts reading it
+    KERNEL,
+    // reading and deserializing it in the connection handler
+    HANDLER,
+    // waiting in the payload queue for the updater
+    QUEUE,
+    // applying it to the canvas (including waiting for the
+    // update mutex)
+    APPLY,
+    // sending it to every connection
+    BROADCAST,
+    COUNT,
+};
+
+const char* stage_name(Stage stage);
+
+// The timings of a single sampled action, it travels along
+// with the action through the server
+struct ActionTrace {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t id { 0 };
+
+    std::string username {};
+
+    // only known once the action has been deserialized
+    ActionType action { ActionType::COUNT };
+
+    std::array<uint64_t, static_cast<size_t>(Stage::COUNT)> durations_ns {};
+
+    // NOTE: the time spent in the kernel can not always be
+    // known (see StageTracer::start)
+    bool has_kernel { false };
+
+    Clock::time_point last {};
+
+    // ends the given stage (which started when the previous
+    // one ended)
+    void mark(Stage stage)
+    {
+        auto now = Clock::now();
+
+        durations_ns[static_cast<size_t>(stage)] = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - last)
+                .count()
+        );
+
+        last = now;
+    }
+
+    [[nodiscard]] uint64_t total_ns() const
+    {
+        uint64_t total { 0 };
+
+        for (auto duration : durations_ns) {
+            total += duration;
+        }
+
+        return total;
+    }
+};
+
+// An update waiting in the payload queue, along with the trace
+// of the action if it is being traced
+struct QueuedPayload {
+    Payload payload {};
+
+    std::unique_ptr<ActionTrace> trace {};
+
+    // the frame the payload was read from (and the connection
+    // it was read on), only kept when recording so that the
+    // updater can record it in the order it is applied
+    uint32_t connection { 0 };
+    ByteString frame {};
+};
+
+// The stage tracer samples one in every so many actions and
+// follows each of them through the stages of the server. The
+// durations of every stage (and in total) are aggregated into
+// histograms, and the slowest actions are kept in full as
+// exemplars of where the time went.
+//
+// NOTE: the time an action spends in the kernel is taken from
+// the receive timestamp of the socket (SO_TIMESTAMPING), so it
+// is only known when the action was already waiting by the time
+// the connection handler went to read it.
+
+class StageTracer {
+   public:
+    StageTracer() = default;
+
+    StageTracer(const StageTracer&) = delete;
+
+    StageTracer& operator=(const StageTracer&) = delete;
+
+    // zero sample_every turns tracing off
+    void setup(uint32_t sample_every, size_t exemplar_count);
+
+    [[nodiscard]] bool is_enabled() const
+    {
+        return m_sample_every != 0;
+    }
+
+    // asks the kernel to timestamp what the socket receives
+    void enable_timestamps(int sock_fd) const;
+
+    // whether the next frame read should be traced
+    [[nodiscard]] bool should_sample();
+
+    // starts tracing the frame which is about to be read from
+    // the socket
+    [[nodiscard]] std::unique_ptr<ActionTrace>
+    start(const std::string& username, int sock_fd);
+
+    // aggregates a trace which has gone through every stage
+    void finish(std::unique_ptr<ActionTrace> trace);
+
+    // appends the stage durations as Prometheus summaries
+    void render_metrics(std::string& out);
+
+    // the slowest traced actions
+    std::string render_exemplars();
+
+    // logs the stage durations and the exemplars
+    void report();
+
+   private:
+    uint32_t m_sample_every { 0 };
+    size_t m_exemplar_count { STAGE_DEFAULT_EXEMPLARS };
+
+    std::atomic<uint64_t> m_frames { 0 };
+    std::atomic<uint64_t> m_traced { 0 };
+
+    threading::mutex m_mutex { "stage_tracer_mutex" };
+
+    // the stages followed by the total
+    std::array<Histogram, static_cast<size_t>(Stage::COUNT) + 1> m_histograms {};
+    std::array<uint64_t, static_cast<size_t>(Stage::COUNT) + 1> m_sums_ns {};
+
+    // the slowest traces, ordered as a min-heap on the total
+    std::vector<ActionTrace> m_exemplars {};
+};
+
+} // namespace server
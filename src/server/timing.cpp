@@ -23,15 +23,9 @@ void handle_timer(union sigval val)
     std::string username { timer->username };
 
     {
-        Adopt adopt { username };
+        Adopt adopt { timer->user };
 
-        {
-            threading::unique_mutex_guard guard { share::update_mutex };
-
-            share::payload_queue.emplace(adopt);
-        }
-
-        share::update_cond.notify_one();
+        share::payload_queue.push(QueuedPayload { Payload { adopt } });
     }
 
     {
@@ -50,11 +44,12 @@ void handle_timer(union sigval val)
     spdlog::info("adopted {}'s draws", username);
 }
 
-void create_client_timer(const std::string& username)
+void create_client_timer(const std::string& username, UserId user)
 {
     std::unique_ptr<TimerData> data = std::make_unique<TimerData>();
 
     data->username = username;
+    data->user = user;
 
     // this is all the C setup for using a timer_create
 
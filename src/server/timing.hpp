@@ -5,16 +5,21 @@
 
 // common
 #include "../common/timer.hpp"
+#include "../common/types.hpp"
+
+// std
+#include <string>
 
 namespace server {
 
 struct TimerData {
     Timer timer {};
     std::string username {};
+    UserId user { 0 };
 };
 
 void handle_timer(union sigval val);
 
-void create_client_timer(const std::string& username);
+void create_client_timer(const std::string& username, UserId user);
 
 } // namespace server
@@ -4,6 +4,7 @@
 
 // common
 #include "../common/channel.hpp"
+#include "../common/stroke.hpp"
 #include "../common/tagged_draw_vector_wrapper.hpp"
 #include "../common/threading.hpp"
 
@@ -14,64 +15,299 @@
 #include <spdlog/spdlog.h>
 
 // std
+#include <array>
+#include <chrono>
+#include <memory>
 #include <variant>
+#include <vector>
 
 namespace server {
 
+// The ways a batch is framed, by whether the connection settled
+// on batching (the lowest bit) and on strokes
+#define FRAMINGS (4)
+
+static size_t framing(Capabilities capabilities)
+{
+    return ((capabilities & CAPABILITY_BATCHING) != 0 ? 1 : 0)
+           | ((capabilities & CAPABILITY_STROKES) != 0 ? 2 : 0);
+}
+
+// Frames the whole batch into the given buffer, consecutive
+// actions of the same user go out as a single action batch
+// (unless batching is off, then every action is a frame of its
+// own, and unless strokes are off, then they go out as lines).
+// Gives the number of frames.
+static uint64_t coalesce(
+    const std::vector<QueuedPayload>& batch,
+    ByteString& frames,
+    bool batching,
+    bool strokes
+)
+{
+    uint64_t frame_count { 0 };
+
+    ActionBatch pending {};
+
+    auto flush = [&frames, &frame_count, &pending]() {
+        if (pending.actions.empty()) {
+            return;
+        }
+
+        frames.append(Channel::frame(serialize<Payload>(to_payload(pending))));
+
+        frame_count++;
+
+        pending.actions.clear();
+    };
+
+    auto follow = [&flush, &pending](UserId user) {
+        if (pending.user != user) {
+            flush();
+
+            pending.user = user;
+        }
+    };
+
+    auto push = [&flush, &pending, batching, strokes](BatchedAction action) {
+        if (!strokes) {
+            stroke::to_lines(action.action);
+        }
+
+        pending.actions.push_back(std::move(action));
+
+        if (!batching) {
+            flush();
+        }
+    };
+
+    for (auto& queued : batch) {
+        const Payload& payload = queued.payload;
+
+        if (std::holds_alternative<TaggedAction>(payload)) {
+            const auto& tagged_action = std::get<TaggedAction>(payload);
+
+            follow(tagged_action.user);
+
+            push(BatchedAction { tagged_action.action, tagged_action.sent_at });
+        } else if (std::holds_alternative<ActionBatch>(payload)) {
+            const auto& action_batch = std::get<ActionBatch>(payload);
+
+            follow(action_batch.user);
+
+            for (auto& batched_action : action_batch.actions) {
+                push(batched_action);
+            }
+        } else {
+            flush();
+
+            frames.append(Channel::frame(serialize<Payload>(payload)));
+
+            frame_count++;
+        }
+    }
+
+    flush();
+
+    return frame_count;
+}
+
 void Updater::operator()()
 {
+    std::vector<QueuedPayload> batch {};
+
+    batch.reserve(m_batch_limit);
+
+    // NOTE: indexed by framing(), only the ones some connection
+    // needs are filled in (all of them but the one for every
+    // capability are filled in while going over the connections)
+    std::array<ByteString, FRAMINGS> frames {};
+    std::array<uint64_t, FRAMINGS> frame_counts {};
+
+    // NOTE: written to without holding the connections mutex,
+    // so that a slow connection does not hold up the ones which
+    // come and go in the meantime
+    std::vector<std::shared_ptr<share::Connection>> connections {};
+
     for (;;) {
-        Payload payload {};
+        batch.clear();
+
+        uint64_t sequence { 0 };
+
+        // NOTE: blocks for the first update only, everything which
+        // piled up behind it is taken without waiting
+        batch.push_back(share::payload_queue.pop());
+
+        QueuedPayload queued {};
+
+        while (batch.size() < m_batch_limit
+               && share::payload_queue.try_pop(queued)) {
+            batch.push_back(std::move(queued));
+        }
+
+        for (auto& queued : batch) {
+            if (queued.trace) {
+                queued.trace->mark(Stage::QUEUE);
+            }
+
+            if (!queued.frame.empty()) {
+                share::recorder.frame(queued.connection, queued.frame);
+            }
+        }
 
         {
             threading::unique_mutex_guard guard { share::update_mutex };
 
-            share::update_cond.wait(guard, []() {
-                return share::payload_queue.empty();
-            });
-
             BENCH("updater reading changes");
 
-            payload = share::payload_queue.back();
+            TaggedDrawVectorWrapper wrapper { share::tagged_draw_vector };
+
+            for (auto& queued : batch) {
+                Payload& payload = queued.payload;
+
+                if (std::holds_alternative<Adopt>(payload)) {
+                    wrapper.adopt(std::get<Adopt>(payload));
+
+                    share::metrics.adoptions.fetch_add(
+                        1,
+                        std::memory_order_relaxed
+                    );
+                } else if (std::holds_alternative<TaggedAction>(payload)) {
+                    wrapper.update(std::get<TaggedAction>(payload));
+
+                    share::metrics.count_action(
+                        std::get<TaggedAction>(payload).action
+                    );
+                } else if (std::holds_alternative<ActionBatch>(payload)) {
+                    const auto& action_batch = std::get<ActionBatch>(payload);
 
-            share::payload_queue.pop();
+                    for (size_t i = 0; i < action_batch.actions.size(); i++) {
+                        wrapper.update(action_batch.at(i));
 
-            if (std::holds_alternative<Adopt>(payload)) {
-                TaggedDrawVectorWrapper { share::tagged_draw_vector }.adopt(
-                    std::get<Adopt>(payload)
-                );
-            } else if (std::holds_alternative<TaggedAction>(payload)) {
-                TaggedDrawVectorWrapper { share::tagged_draw_vector }.update(
-                    std::get<TaggedAction>(payload)
-                );
-            } else {
-                ABORT("unreachable");
+                        share::metrics.count_action(
+                            action_batch.actions[i].action
+                        );
+                    }
+                } else if (std::holds_alternative<UserNames>(payload)) {
+                    // nothing to apply, the usernames are only sent
+                    // out
+                } else {
+                    ABORT("unreachable");
+                }
             }
+
+            // the cached snapshot no longer matches the canvas
+            share::snapshot_cache = {};
+
+            sequence = ++share::update_sequence;
         }
 
-        ByteString bytes = serialize<Payload>(payload);
+        share::metrics.update_batch_size.observe(batch.size());
+
+        for (auto& queued : batch) {
+            if (queued.trace) {
+                queued.trace->mark(Stage::APPLY);
+            }
+        }
+
+        for (auto& framed : frames) {
+            framed.clear();
+        }
+
+        frame_counts[framing(CAPABILITIES_ALL)]
+            = coalesce(batch, frames[framing(CAPABILITIES_ALL)], true, true);
 
         {
             BENCH("updating all connected clients");
 
-            threading::mutex_guard guard { share::connections_mutex };
+            auto start = std::chrono::steady_clock::now();
+
+            uint64_t frames_sent { 0 };
+            uint64_t bytes_sent { 0 };
 
-            for (auto& [fd, conn] : share::connections) {
-                Channel channel { conn };
+            {
+                threading::mutex_guard guard { share::connections_mutex };
 
-                auto status = channel.write(bytes);
+                connections.reserve(share::connections.size());
+
+                for (auto& [fd, conn] : share::connections) {
+                    connections.push_back(conn);
+                }
+            }
+
+            for (auto& conn : connections) {
+                threading::mutex_guard guard { conn->write_mutex };
+
+                // NOTE: the batch can be applied before a new
+                // connection takes its snapshot, and broadcast
+                // after, the snapshot already has it then
+                if (sequence <= conn->snapshot_sequence) {
+                    continue;
+                }
+
+                Channel channel { conn->sock };
+
+                size_t index = framing(conn->capabilities);
+
+                if (frames[index].empty()) {
+                    frame_counts[index] = coalesce(
+                        batch,
+                        frames[index],
+                        (conn->capabilities & CAPABILITY_BATCHING) != 0,
+                        (conn->capabilities & CAPABILITY_STROKES) != 0
+                    );
+                }
+
+                const ByteString& packet = frames[index];
+
+                auto status = channel.write_frames(packet);
 
                 if (status != ChannelErrorCode::OK) {
+                    share::metrics.write_errors.fetch_add(
+                        1,
+                        std::memory_order_relaxed
+                    );
+
                     spdlog::error(
                         "[{}] writing failed, reason {}",
-                        fd,
+                        conn->sock.native_handle(),
                         status.what()
                     );
+                } else {
+                    frames_sent += frame_counts[index];
+                    bytes_sent += packet.size();
                 }
             }
 
+            // NOTE: a connection which closed in the meantime
+            // is only let go of (and its socket closed) here
+            connections.clear();
+
+            share::metrics.frames_sent.fetch_add(
+                frames_sent,
+                std::memory_order_relaxed
+            );
+            share::metrics.bytes_sent.fetch_add(
+                bytes_sent,
+                std::memory_order_relaxed
+            );
+            share::metrics.broadcast_duration.observe(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start
+                )
+                    .count()
+            ));
+
             // end of bench scope (for clarity)
         }
+
+        for (auto& queued : batch) {
+            if (queued.trace) {
+                queued.trace->mark(Stage::BROADCAST);
+
+                share::stage_tracer.finish(std::move(queued.trace));
+            }
+        }
     }
 }
 
@@ -1,5 +1,13 @@
 #pragma once
 
+// cstd
+#include <cstddef>
+
+// The largest number of updates the updater applies under a
+// single acquisition of the update mutex (and sends to every
+// connection in a single write)
+#define UPDATER_DEFAULT_BATCH_LIMIT (256)
+
 namespace server {
 
 // NOTE: ideally we have a thread pool of updaters
@@ -12,9 +20,24 @@ namespace server {
 // by leveraging the single threaded performance of our
 // CPU.
 
+// The updater drains everything waiting in the payload queue
+// (up to the batch limit), applies it all at once and then
+// sends the frames of the whole batch back to back, so under
+// load every connection gets one write per batch rather than
+// one per update. Consecutive actions of the same user are
+// sent as a single action batch.
+
 class Updater {
    public:
+    explicit Updater(size_t batch_limit)
+        : m_batch_limit { batch_limit }
+    {
+    }
+
     [[noreturn]] void operator()();
+
+   private:
+    size_t m_batch_limit { UPDATER_DEFAULT_BATCH_LIMIT };
 };
 
 } // namespace server
@@ -0,0 +1,827 @@
+// test_client
+#include "load_generator.hpp"
+#include "share.hpp"
+
+// common
+#include "../common/channel.hpp"
+#include "../common/overload.hpp"
+#include "../common/serial.hpp"
+
+// unix
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// cstd
+#include <cerrno>
+#include <cstring>
+
+// std
+#include <fstream>
+#include <optional>
+#include <random>
+
+// fmt
+#include <fmt/core.h>
+
+// spdlog
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+namespace test_client {
+
+static std::mt19937 mt { std::random_device {}() };
+
+[[nodiscard]] static uint64_t
+to_timestamp(std::chrono::steady_clock::time_point time)
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            time.time_since_epoch()
+        )
+            .count()
+    );
+}
+
+bool LoadGenerator::setup(
+    const std::string& ipv4_addr,
+    uint16_t port,
+    uint32_t clients,
+    uint32_t iterations,
+    double interval,
+    uint32_t expected_responses,
+    const std::string& username,
+    const WorkloadProfile& profile,
+    Capabilities capabilities,
+    double rate,
+    Arrivals arrivals,
+    const std::string& latency_output,
+    OutputFormat latency_format
+)
+{
+    // setup network info
+
+    struct in_addr addr { };
+
+    if (inet_pton(AF_INET, ipv4_addr.c_str(), &addr) <= 0) {
+        fmt::println(stderr, "error: invalid IPv4 address");
+
+        return false;
+    }
+
+    // NOTE: this is in host-readable form
+    m_ipv4_addr = ntohl(addr.s_addr);
+
+    m_port = port;
+
+    m_iterations = iterations;
+
+    m_interval = interval;
+
+    m_expected_responses = expected_responses;
+
+    m_capabilities = capabilities;
+
+    if (rate < 0) {
+        fmt::println(stderr, "error: the rate cannot be negative");
+
+        return false;
+    }
+
+    m_rate = rate;
+
+    m_arrivals = arrivals;
+
+    m_latency_output = latency_output;
+
+    m_latency_format = latency_format;
+
+    // NOTE: with a seed the arrivals are reproducible too
+    if (profile.seed != 0) {
+        mt.seed(static_cast<std::mt19937::result_type>(profile.seed));
+    }
+
+    share::username = username;
+
+    // setup logging
+
+    try {
+        auto logger = spdlog::stdout_color_mt(
+            fmt::format("load_generator ({})", username)
+        );
+
+        spdlog::set_default_logger(logger);
+
+        spdlog::set_level(spdlog::level::info);
+    } catch (const spdlog::spdlog_ex& ex) {
+        fmt::println(stderr, "error: log init failed, reason {}", ex.what());
+
+        return false;
+    }
+
+    // every simulated user needs its own socket so the
+    // default limit on open files is easily exceeded
+
+    struct rlimit limit { };
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+
+        setrlimit(RLIMIT_NOFILE, &limit);
+
+        if (limit.rlim_cur < clients + 16) {
+            spdlog::warn(
+                "the limit on open files ({}) might be too low for {} "
+                "users",
+                limit.rlim_cur,
+                clients
+            );
+        }
+    }
+
+    m_epoll_fd = epoll_create1(0);
+
+    if (m_epoll_fd == -1) {
+        fmt::println(stderr, "error: epoll_create1(): {}", strerror(errno));
+
+        return false;
+    }
+
+    m_users.resize(clients);
+
+    for (uint32_t i = 0; i < clients; i++) {
+        m_users[i].username = fmt::format("{}{}", username, i);
+        m_users[i].workload = Workload { profile, i };
+    }
+
+    return connect_users();
+}
+
+bool LoadGenerator::connect_users()
+{
+    for (size_t i = 0; i < m_users.size(); i++) {
+        SimulatedUser& user = m_users[i];
+
+        // NOTE: connecting is done in blocking mode, it is
+        // only done once and it keeps things simple
+        try {
+            user.sock.open(SOCK_STREAM, 0);
+
+            sockaddr_in addr {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(m_ipv4_addr);
+            addr.sin_port = htons(m_port);
+
+            user.sock.connect(&addr);
+        } catch (std::runtime_error& error) {
+            fmt::println(
+                stderr,
+                "error: opening & connecting failed for {}, reason {}",
+                user.username,
+                error.what()
+            );
+
+            return false;
+        }
+
+        user.sock.make_non_blocking();
+
+        struct epoll_event event { };
+
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+
+        if (epoll_ctl(
+                m_epoll_fd,
+                EPOLL_CTL_ADD,
+                user.sock.native_handle(),
+                &event
+            )
+            == -1) {
+            fmt::println(stderr, "error: epoll_ctl(): {}", strerror(errno));
+
+            return false;
+        }
+
+        queue_payload(
+            user,
+            Username { user.username,
+                       PROTOCOL_VERSION_MIN,
+                       PROTOCOL_VERSION_MAX,
+                       m_capabilities }
+        );
+
+        if (!flush(user)) {
+            fmt::println(
+                stderr,
+                "error: writing failed for {}, reason {}",
+                user.username,
+                strerror(errno)
+            );
+
+            return false;
+        }
+    }
+
+    m_remaining = m_users.size();
+
+    return true;
+}
+
+void LoadGenerator::queue_payload(SimulatedUser& user, const Payload& payload)
+{
+    user.out_buffer.append(Channel::frame(serialize<Payload>(payload)));
+}
+
+void LoadGenerator::send_action(
+    SimulatedUser& user,
+    Clock::time_point scheduled_at
+)
+{
+    queue_payload(
+        user,
+        TaggedAction { user.user,
+                       user.workload.next_action(),
+                       to_timestamp(scheduled_at) }
+    );
+
+    user.sent++;
+    m_sent++;
+
+    if (!flush(user)) {
+        close(user);
+
+        return;
+    }
+
+    check_if_done(user);
+}
+
+void LoadGenerator::send_arrivals(Clock::time_point now)
+{
+    uint64_t total = static_cast<uint64_t>(m_users.size()) * m_iterations;
+
+    // the arrivals only start once every user has finished
+    // the handshake, otherwise the first few seconds would
+    // be measuring how quickly the server accepts users
+    if (!m_has_arrivals_started) {
+        if (m_accepted + m_failed < m_users.size()) {
+            return;
+        }
+
+        m_has_arrivals_started = true;
+
+        m_next_arrival = now;
+    }
+
+    while (m_arrivals_sent < total && m_next_arrival <= now) {
+        size_t tries = 0;
+
+        // hand the action out to the next user which is still
+        // around and has not yet sent all of its actions
+        while (tries < m_users.size()
+               && (m_users[m_next_user].state
+                       != SimulatedUser::State::ACTIVE
+                   || m_users[m_next_user].sent >= m_iterations)) {
+            m_next_user = (m_next_user + 1) % m_users.size();
+
+            tries++;
+        }
+
+        if (tries == m_users.size()) {
+            m_arrivals_sent = total;
+
+            break;
+        }
+
+        SimulatedUser& user = m_users[m_next_user];
+
+        // NOTE: the action is stamped with when it should have
+        // been sent rather than when it actually is, if we
+        // fall behind that delay is part of the latency
+        send_action(user, m_next_arrival);
+
+        // a user in the middle of a burst (or a stroke) keeps
+        // getting the arrivals
+        if (!user.workload.continues_burst()) {
+            m_next_user = (m_next_user + 1) % m_users.size();
+        }
+
+        m_arrivals_sent++;
+
+        m_next_arrival += next_gap();
+    }
+}
+
+LoadGenerator::Clock::duration LoadGenerator::next_gap()
+{
+    double gap { 0 };
+
+    switch (m_arrivals) {
+    case Arrivals::CONSTANT:
+        gap = 1.0 / m_rate;
+        break;
+    case Arrivals::POISSON: {
+        std::exponential_distribution<> gap_dist { m_rate };
+
+        gap = gap_dist(mt);
+    } break;
+    }
+
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(gap)
+    );
+}
+
+bool LoadGenerator::flush(SimulatedUser& user)
+{
+    while (user.out_offset < user.out_buffer.size()) {
+        ssize_t ret = ::send(
+            user.sock.native_handle(),
+            user.out_buffer.data() + user.out_offset,
+            user.out_buffer.size() - user.out_offset,
+            MSG_NOSIGNAL
+        );
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            return false;
+        }
+
+        user.out_offset += static_cast<size_t>(ret);
+    }
+
+    if (user.out_offset == user.out_buffer.size()) {
+        user.out_buffer.clear();
+        user.out_offset = 0;
+    }
+
+    // only ask to be woken up when the socket becomes
+    // writable if there actually is something to write
+    bool should_wait_for_out = !user.out_buffer.empty();
+
+    if (should_wait_for_out != user.is_waiting_for_out) {
+        struct epoll_event event { };
+
+        event.events = EPOLLIN | (should_wait_for_out ? EPOLLOUT : 0u);
+        event.data.u64 = static_cast<uint64_t>(&user - m_users.data());
+
+        if (epoll_ctl(
+                m_epoll_fd,
+                EPOLL_CTL_MOD,
+                user.sock.native_handle(),
+                &event
+            )
+            == -1) {
+            return false;
+        }
+
+        user.is_waiting_for_out = should_wait_for_out;
+    }
+
+    return true;
+}
+
+bool LoadGenerator::receive(SimulatedUser& user)
+{
+    char buffer[65536];
+
+    for (;;) {
+        ssize_t ret = ::recv(user.sock.native_handle(), buffer, sizeof(buffer), 0);
+
+        if (ret == 0) {
+            return false;
+        }
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            return false;
+        }
+
+        user.in_buffer.append(buffer, static_cast<size_t>(ret));
+    }
+
+    // split the received bytes up into packets, whatever is
+    // left over is kept around until the rest arrives
+
+    size_t offset = 0;
+
+    while (user.in_buffer.size() - offset >= Header::size()) {
+        auto [header, status]
+            = deserialize<Header>(user.in_buffer.substr(offset, Header::size())
+            );
+
+        if (status != DeserializeErrorCode::OK
+            || header.magic_bytes != MAGIC_BYTES) {
+            spdlog::error("{} received an invalid header", user.username);
+
+            return false;
+        }
+
+        if (user.in_buffer.size() - offset
+            < Header::size() + header.payload_size) {
+            break;
+        }
+
+        auto [bytes, unpack_status] = Channel::unpack(
+            header,
+            user.in_buffer.substr(offset + Header::size(), header.payload_size)
+        );
+
+        if (unpack_status != ChannelErrorCode::OK) {
+            spdlog::error("{} received a malformed frame", user.username);
+
+            return false;
+        }
+
+        if (!handle_packet(user, bytes)) {
+            return false;
+        }
+
+        offset += Header::size() + header.payload_size;
+    }
+
+    user.in_buffer.erase(0, offset);
+
+    return true;
+}
+
+bool LoadGenerator::handle_packet(SimulatedUser& user, const ByteString& bytes)
+{
+    auto [payload, status] = deserialize<Payload>(bytes);
+
+    if (status != DeserializeErrorCode::OK) {
+        spdlog::warn("deserialization failed, reason {}", status.what());
+
+        return true;
+    }
+
+    return std::visit(
+        overload {
+            [this, &user](Accept& arg) {
+                user.state = SimulatedUser::State::ACTIVE;
+                user.user = arg.user;
+
+                if ((arg.capabilities & CAPABILITY_STROKES) == 0) {
+                    user.workload.without_strokes();
+                }
+
+                m_accepted++;
+
+                // in open loop mode the actions are handed out
+                // by send_arrivals instead
+                if (m_rate > 0) {
+                    return true;
+                }
+
+                // spread the users out over the first interval
+                // so they do not all send at the same time
+                std::uniform_real_distribution<> phase_dist { 0, m_interval };
+
+                auto first_send_at = Clock::now()
+                                     + std::chrono::duration_cast<
+                                         Clock::duration>(
+                                         std::chrono::duration<double>(
+                                             phase_dist(mt)
+                                         )
+                                     );
+
+                if (m_iterations > 0) {
+                    m_schedule.emplace(
+                        first_send_at,
+                        static_cast<size_t>(&user - m_users.data())
+                    );
+                }
+
+                return true;
+            },
+            [&user](Decline& arg) {
+                spdlog::error(
+                    "{} was declined, reason {}",
+                    user.username,
+                    arg.reason
+                );
+
+                return false;
+            },
+            [this, &user](Snapshot& arg) {
+                user.received += arg.draws.size();
+                m_received += arg.draws.size();
+
+                return true;
+            },
+            [this, &user](TaggedAction& arg) {
+                user.received++;
+                m_received++;
+
+                if (arg.sent_at != 0) {
+                    uint64_t now = to_timestamp(Clock::now());
+
+                    m_latencies.record(
+                        now > arg.sent_at ? (now - arg.sent_at) / 1000 : 0
+                    );
+                }
+
+                return true;
+            },
+            [this, &user](ActionBatch& arg) {
+                user.received += arg.actions.size();
+                m_received += arg.actions.size();
+
+                uint64_t now = to_timestamp(Clock::now());
+
+                for (auto& batched_action : arg.actions) {
+                    if (batched_action.sent_at != 0) {
+                        m_latencies.record(
+                            now > batched_action.sent_at
+                                ? (now - batched_action.sent_at) / 1000
+                                : 0
+                        );
+                    }
+                }
+
+                return true;
+            },
+            [](Adopt&) {
+                return true;
+            },
+            [](UserNames&) {
+                return true;
+            },
+            [&user](auto& object) {
+                spdlog::warn(
+                    "{} received an unexpected payload type {}",
+                    user.username,
+                    typeid(object).name()
+                );
+
+                return true;
+            },
+        },
+        payload
+    );
+}
+
+void LoadGenerator::close(SimulatedUser& user)
+{
+    if (user.state == SimulatedUser::State::CLOSED) {
+        return;
+    }
+
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, user.sock.native_handle(), nullptr);
+
+    user.sock.close();
+
+    user.state = SimulatedUser::State::CLOSED;
+
+    if (!user.is_done) {
+        m_failed++;
+
+        user.is_done = true;
+
+        m_remaining--;
+    }
+}
+
+void LoadGenerator::check_if_done(SimulatedUser& user)
+{
+    if (user.is_done || user.sent < m_iterations
+        || user.received < m_expected_responses) {
+        return;
+    }
+
+    user.is_done = true;
+
+    m_remaining--;
+
+    close(user);
+}
+
+bool LoadGenerator::run()
+{
+    auto start = Clock::now();
+
+    std::vector<struct epoll_event> events(MAX_EPOLL_EVENTS);
+
+    while (m_remaining > 0) {
+        auto now = Clock::now();
+
+        while (!m_schedule.empty() && m_schedule.top().first <= now) {
+            auto [send_at, index] = m_schedule.top();
+
+            m_schedule.pop();
+
+            SimulatedUser& user = m_users[index];
+
+            if (user.state != SimulatedUser::State::ACTIVE) {
+                continue;
+            }
+
+            send_action(user, send_at);
+
+            // NOTE: the next action is scheduled relative to when
+            // this one should have been sent, so a slow iteration
+            // of the loop does not make the user drift
+            if (user.state == SimulatedUser::State::ACTIVE
+                && user.sent < m_iterations) {
+                auto gap = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(
+                        user.workload.next_gap(m_interval)
+                    )
+                );
+
+                m_schedule.emplace(send_at + gap, index);
+            }
+        }
+
+        if (m_rate > 0) {
+            send_arrivals(now);
+        }
+
+        // sleep until the next action is due (or something
+        // happens on one of the sockets)
+        std::optional<Clock::time_point> wake_at {};
+
+        if (!m_schedule.empty()) {
+            wake_at = m_schedule.top().first;
+        }
+
+        if (m_has_arrivals_started
+            && m_arrivals_sent
+                   < static_cast<uint64_t>(m_users.size()) * m_iterations) {
+            wake_at = wake_at.has_value()
+                          ? std::min(*wake_at, m_next_arrival)
+                          : m_next_arrival;
+        }
+
+        int timeout = 1000;
+
+        if (wake_at.has_value()) {
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+                *wake_at - Clock::now()
+            );
+
+            timeout = static_cast<int>(std::max<long>(0, wait.count()));
+        }
+
+        int count = epoll_wait(
+            m_epoll_fd,
+            events.data(),
+            static_cast<int>(events.size()),
+            timeout
+        );
+
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            spdlog::error("epoll_wait(): {}", strerror(errno));
+
+            return false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            const struct epoll_event& event = events[static_cast<size_t>(i)];
+
+            SimulatedUser& user = m_users[event.data.u64];
+
+            if (user.state == SimulatedUser::State::CLOSED) {
+                continue;
+            }
+
+            if (event.events & EPOLLIN) {
+                if (!receive(user)) {
+                    close(user);
+
+                    continue;
+                }
+            } else if (event.events & (EPOLLERR | EPOLLHUP)) {
+                close(user);
+
+                continue;
+            }
+
+            if (event.events & EPOLLOUT) {
+                if (!flush(user)) {
+                    close(user);
+
+                    continue;
+                }
+            }
+
+            check_if_done(user);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    spdlog::info(
+        "users: {}, failed: {}, actions sent: {}, actions received: {}, "
+        "elapsed: {:.3f}s",
+        m_users.size(),
+        m_failed,
+        m_sent,
+        m_received,
+        elapsed.count()
+    );
+
+    spdlog::info(
+        "send rate: {:.1f} actions/s, receive rate: {:.1f} actions/s",
+        static_cast<double>(m_sent) / elapsed.count(),
+        static_cast<double>(m_received) / elapsed.count()
+    );
+
+    spdlog::info(
+        "latency (µs): p50 {}, p90 {}, p99 {}, p99.9 {}, max {} ({} samples)",
+        m_latencies.percentile(50),
+        m_latencies.percentile(90),
+        m_latencies.percentile(99),
+        m_latencies.percentile(99.9),
+        m_latencies.max(),
+        m_latencies.count()
+    );
+
+    if (!write_latencies(elapsed.count())) {
+        return false;
+    }
+
+    return m_failed == 0;
+}
+
+bool LoadGenerator::write_latencies(double elapsed) const
+{
+    if (m_latency_output.empty()) {
+        return true;
+    }
+
+    std::ofstream of { m_latency_output };
+
+    if (!of) {
+        spdlog::error("could not open {}", m_latency_output);
+
+        return false;
+    }
+
+    switch (m_latency_format) {
+    case OutputFormat::CSV:
+        of << "users,rate,actions_sent,actions_received,elapsed_sec,samples,"
+              "p50_us,p90_us,p99_us,p999_us,max_us\n";
+        of << fmt::format(
+            "{},{},{},{},{:.6f},{},{},{},{},{},{}\n",
+            m_users.size(),
+            m_rate,
+            m_sent,
+            m_received,
+            elapsed,
+            m_latencies.count(),
+            m_latencies.percentile(50),
+            m_latencies.percentile(90),
+            m_latencies.percentile(99),
+            m_latencies.percentile(99.9),
+            m_latencies.max()
+        );
+        break;
+    case OutputFormat::JSON:
+        of << fmt::format(
+            "{{\"users\": {}, \"rate\": {}, \"actions_sent\": {}, "
+            "\"actions_received\": {}, \"elapsed_sec\": {:.6f}, "
+            "\"samples\": {}, \"p50_us\": {}, \"p90_us\": {}, "
+            "\"p99_us\": {}, \"p999_us\": {}, \"max_us\": {}}}\n",
+            m_users.size(),
+            m_rate,
+            m_sent,
+            m_received,
+            elapsed,
+            m_latencies.count(),
+            m_latencies.percentile(50),
+            m_latencies.percentile(90),
+            m_latencies.percentile(99),
+            m_latencies.percentile(99.9),
+            m_latencies.max()
+        );
+        break;
+    }
+
+    return true;
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    if (m_epoll_fd != -1) {
+        ::close(m_epoll_fd);
+    }
+
+    spdlog::info("Finished...");
+}
+
+} // namespace test_client
@@ -0,0 +1,186 @@
+#pragma once
+
+// test_client
+#include "workload.hpp"
+
+// common
+#include "../common/bytes.hpp"
+#include "../common/histogram.hpp"
+#include "../common/network.hpp"
+#include "../common/types.hpp"
+
+// std
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+// The maximum number of events handled per call to
+// epoll_wait
+#define MAX_EPOLL_EVENTS (256)
+
+namespace test_client {
+
+// The load generator drives a large number of simulated
+// users from a single thread. Instead of a reader and a
+// writer thread per user (like the regular test client),
+// all the connections are non-blocking and multiplexed on
+// an epoll loop, so the generator itself stays cheap enough
+// to saturate the server.
+//
+// By default every user sends an action every interval
+// (closed loop, like the regular test client). Given a
+// rate, the generator is open loop instead: actions arrive
+// at the given aggregate rate (with constant or exponential
+// gaps) regardless of how quickly the server responds and
+// are handed out to the users in turn. Every action carries
+// the time at which it was scheduled to be sent, so the
+// latencies measured (from sending an action to receiving
+// its broadcast) do not suffer from coordinated omission.
+
+enum class Arrivals : uint8_t {
+    CONSTANT,
+    POISSON,
+};
+
+enum class OutputFormat : uint8_t {
+    CSV,
+    JSON,
+};
+
+struct SimulatedUser {
+    enum class State : uint8_t {
+        HANDSHAKE,
+        ACTIVE,
+        CLOSED,
+    };
+
+    IPv4Socket sock {};
+    std::string username {};
+    UserId user { 0 };
+    State state { State::HANDSHAKE };
+
+    // bytes which have been received but do not yet
+    // make up a whole packet
+    ByteString in_buffer {};
+
+    // bytes which are waiting for the socket to
+    // become writable
+    ByteString out_buffer {};
+    size_t out_offset { 0 };
+    bool is_waiting_for_out { false };
+
+    Workload workload {};
+
+    uint32_t sent { 0 };
+    uint64_t received { 0 };
+
+    // set once the user has sent and received everything it
+    // was meant to (or its connection was closed)
+    bool is_done { false };
+};
+
+class LoadGenerator {
+   public:
+    LoadGenerator() = default;
+
+    LoadGenerator(const LoadGenerator&) = delete;
+
+    LoadGenerator& operator=(const LoadGenerator&) = delete;
+
+    bool setup(
+        const std::string& ipv4_addr,
+        uint16_t port,
+        uint32_t clients,
+        uint32_t iterations,
+        double interval,
+        uint32_t expected_responses,
+        const std::string& username,
+        const WorkloadProfile& profile,
+        Capabilities capabilities,
+        double rate,
+        Arrivals arrivals,
+        const std::string& latency_output,
+        OutputFormat latency_format
+    );
+
+    [[nodiscard]] bool run();
+
+    ~LoadGenerator();
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    bool connect_users();
+
+    void queue_payload(SimulatedUser& user, const Payload& payload);
+
+    void send_action(SimulatedUser& user, Clock::time_point scheduled_at);
+
+    // hands out the actions which are due in open loop mode
+    void send_arrivals(Clock::time_point now);
+
+    [[nodiscard]] Clock::duration next_gap();
+
+    [[nodiscard]] bool write_latencies(double elapsed) const;
+
+    bool flush(SimulatedUser& user);
+
+    bool receive(SimulatedUser& user);
+
+    bool handle_packet(SimulatedUser& user, const ByteString& bytes);
+
+    void close(SimulatedUser& user);
+
+    void check_if_done(SimulatedUser& user);
+
+    uint32_t m_ipv4_addr {};
+    uint16_t m_port {};
+    uint32_t m_iterations {};
+    double m_interval {};
+    uint32_t m_expected_responses {};
+    Capabilities m_capabilities {};
+
+    // open loop state (a rate of zero means closed loop)
+    double m_rate { 0 };
+    Arrivals m_arrivals { Arrivals::CONSTANT };
+    bool m_has_arrivals_started { false };
+    Clock::time_point m_next_arrival {};
+    uint64_t m_arrivals_sent { 0 };
+    size_t m_next_user { 0 };
+    size_t m_accepted { 0 };
+
+    std::string m_latency_output {};
+    OutputFormat m_latency_format { OutputFormat::CSV };
+
+    // latencies (in microseconds) from an action being
+    // scheduled to its broadcast being received, recorded
+    // for every user which receives the broadcast
+    Histogram m_latencies {};
+
+    int m_epoll_fd { -1 };
+
+    std::vector<SimulatedUser> m_users {};
+
+    // the users which have to send their next action,
+    // ordered by when they have to do so
+    std::priority_queue<
+        std::pair<Clock::time_point, size_t>,
+        std::vector<std::pair<Clock::time_point, size_t>>,
+        std::greater<>>
+        m_schedule {};
+
+    size_t m_remaining { 0 };
+
+    // totals over all the users
+    uint64_t m_sent { 0 };
+    uint64_t m_received { 0 };
+    uint32_t m_failed { 0 };
+};
+
+} // namespace test_client
@@ -1,5 +1,7 @@
 // client_test
+#include "load_generator.hpp"
 #include "runner.hpp"
+#include "workload.hpp"
 
 // bench
 #include "../bench/bench.hpp"
@@ -93,8 +95,124 @@ int main(int argc, char** argv)
     )
         ->capture_default_str();
 
+    std::string workload_path {};
+    app.add_option(
+        "--workload",
+        workload_path,
+        "A workload profile describing the actions to generate (please "
+        "refer to the profiles directory), by default every kind of draw "
+        "(and with --other-actions every other action) is equally likely"
+    );
+
+    uint64_t seed { 0 };
+    app.add_option(
+        "--seed",
+        seed,
+        "The seed for generating the actions (overrides the seed of the "
+        "workload profile), zero picks a random one"
+    );
+
+    uint32_t clients { 1 };
+    app.add_option(
+           "--clients",
+           clients,
+           "The number of users to simulate, anything above one (or a "
+           "rate) drives all of the users from a single process (the "
+           "usernames are suffixed with the index of the user)"
+    )
+        ->capture_default_str();
+
+    double rate { 0 };
+    app.add_option(
+           "--rate",
+           rate,
+           "The aggregate number of actions per second to send to the "
+           "NetSketch server (open loop), when zero every user sends an "
+           "action every interval instead"
+    )
+        ->capture_default_str();
+
+    std::string arrivals { "poisson" };
+    app.add_option(
+           "--arrivals",
+           arrivals,
+           "How the actions are spaced out in time when a rate is given"
+    )
+        ->capture_default_str()
+        ->check(CLI::IsMember({ "constant", "poisson" }));
+
+    std::string latency_output {};
+    app.add_option(
+           "--latency-output",
+           latency_output,
+           "The file to which the latency percentiles are written (only "
+           "when simulating multiple users or given a rate)"
+    );
+
+    std::string latency_format { "csv" };
+    app.add_option(
+           "--latency-format",
+           latency_format,
+           "The format of the latency output"
+    )
+        ->capture_default_str()
+        ->check(CLI::IsMember({ "csv", "json" }));
+
+    Capabilities capabilities { CAPABILITIES_ALL };
+    app.add_option(
+           "--capabilities",
+           capabilities,
+           "The capabilities offered to the server in the handshake, as a "
+           "mask of compression (1), batching (2), the compact encoding (4) "
+           "and strokes (16)"
+    )
+        ->capture_default_str();
+
     CLI11_PARSE(app, argc, argv);
 
+    test_client::WorkloadProfile profile
+        = test_client::uniform_profile(other_actions);
+
+    if (!workload_path.empty()
+        && !test_client::load_workload_profile(workload_path, profile)) {
+        return EXIT_FAILURE;
+    }
+
+    if (seed != 0) {
+        profile.seed = seed;
+    }
+
+    if (clients > 1 || rate > 0) {
+        test_client::LoadGenerator generator {};
+
+        if (!generator.setup(
+                ipv4_addr_str,
+                port,
+                clients,
+                iterations,
+                interval,
+                expected_responses,
+                username,
+                profile,
+                capabilities,
+                rate,
+                arrivals == "constant" ? test_client::Arrivals::CONSTANT
+                                       : test_client::Arrivals::POISSON,
+                latency_output,
+                latency_format == "json" ? test_client::OutputFormat::JSON
+                                         : test_client::OutputFormat::CSV
+            )) {
+            return EXIT_FAILURE;
+        }
+
+        // NOTE: the generator reports its own timings
+        if (!generator.run()) {
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     test_client::Runner runner {};
 
     if (!runner.setup(
@@ -104,7 +222,8 @@ int main(int argc, char** argv)
             interval,
             expected_responses,
             username,
-            other_actions
+            profile,
+            capabilities
         )) {
         return EXIT_FAILURE;
     }
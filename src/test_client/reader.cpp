@@ -85,13 +85,23 @@ void Reader::handle_payload(ByteString& bytes)
                 TaggedDrawVectorWrapper { share::tagged_draw_vector }.adopt(arg
                 );
             },
-            [](TaggedDrawVector& arg) {
-                share::tagged_draw_vector = arg;
+            [](Snapshot& arg) {
+                share::tagged_draw_vector = std::move(arg.draws);
             },
             [](TaggedAction& arg) {
                 TaggedDrawVectorWrapper { share::tagged_draw_vector }.update(arg
                 );
             },
+            [](UserNames&) {
+                // the usernames are never shown
+            },
+            [](ActionBatch& arg) {
+                TaggedDrawVectorWrapper wrapper { share::tagged_draw_vector };
+
+                for (size_t i = 0; i < arg.actions.size(); i++) {
+                    wrapper.update(arg.at(i));
+                }
+            },
             [](auto& object) {
                 spdlog::warn(
                     "unexpected payload type {}",
@@ -53,7 +53,8 @@ bool Runner::setup(
     double interval,
     uint32_t expected_responses,
     const std::string& username,
-    bool other_actions
+    const WorkloadProfile& profile,
+    Capabilities capabilities
 )
 {
     // setup network info
@@ -77,7 +78,7 @@ bool Runner::setup(
 
     share::expected_responses = expected_responses;
 
-    share::only_drawing = !other_actions;
+    m_profile = profile;
 
     share::username = username;
 
@@ -122,7 +123,10 @@ bool Runner::setup(
 
     // check username
 
-    ByteString req { serialize<Payload>(Username { username }) };
+    ByteString req { serialize<Payload>(Username { username,
+                                                   PROTOCOL_VERSION_MIN,
+                                                   PROTOCOL_VERSION_MAX,
+                                                   capabilities }) };
 
     auto write_status = m_channel.write(req);
 
@@ -180,6 +184,11 @@ bool Runner::setup(
         return false;
     }
 
+    share::user = std::get<Accept>(payload).user;
+    share::capabilities = std::get<Accept>(payload).capabilities;
+
+    SETUP_BENCHMARKS;
+
     return true;
 }
 
@@ -187,12 +196,10 @@ bool Runner::setup(
 {
     DISABLE_INDIVIDUAL_LOGS;
 
-    START_BENCHMARK_THREAD;
-
     share::reader_thread = threading::thread { Reader { m_channel } };
     share::writer_thread = threading::thread { Writer { m_channel } };
 
-    simulate_behaviour(m_iterations, m_interval);
+    simulate_behaviour(m_iterations, m_interval, m_profile);
 
     return EXIT_SUCCESS;
 }
@@ -204,7 +211,9 @@ Runner::~Runner()
     if (share::writer_thread.is_initialized())
         share::writer_thread.join();
 
-    END_BENCHMARK_THREAD;
+    REPORT_BENCHMARKS;
+
+    REPORT_LOCKS;
 
 #ifdef NETSKETCH_DUMPHASH
     spdlog::debug(
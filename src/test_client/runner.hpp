@@ -10,6 +10,9 @@
 #include "../common/channel.hpp"
 #include "../common/network.hpp"
 
+// test_client
+#include "workload.hpp"
+
 namespace test_client {
 
 class Runner {
@@ -23,7 +26,8 @@ class Runner {
         double interval,
         uint32_t expected_responses,
         const std::string& username,
-        bool other_actions
+        const WorkloadProfile& profile,
+        Capabilities capabilities
     );
 
     [[nodiscard]] bool run() const;
@@ -35,6 +39,7 @@ class Runner {
     uint16_t m_port {};
     uint32_t m_iterations {};
     double m_interval {};
+    WorkloadProfile m_profile {};
     IPv4Socket m_sock {};
     Channel m_channel {};
 };
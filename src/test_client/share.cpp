@@ -3,17 +3,16 @@
 
 namespace test_client::share {
 
-bool only_drawing { true };
 std::string username {};
+UserId user { 0 };
+Capabilities capabilities { 0 };
 uint32_t expected_responses {};
 
 threading::thread reader_thread {};
 threading::thread writer_thread {};
 threading::thread input_thread {};
 
-threading::mutex writer_mutex {};
-threading::cond_var writer_cond {};
-std::queue<Action> writer_queue {};
+threading::spsc_queue<Action> writer_queue { WRITER_QUEUE_CAPACITY };
 
 TaggedDrawVector tagged_draw_vector {};
 
@@ -5,21 +5,26 @@
 #include "../common/types.hpp"
 
 // std
-#include <queue>
 #include <string>
 
+// The number of actions which can be waiting to be sent, the
+// simulated user blocks once it is full
+#define WRITER_QUEUE_CAPACITY (1024)
+
 namespace test_client::share {
 
-extern bool only_drawing;
 extern std::string username;
+extern UserId user;
+// what the handshake settled on
+extern Capabilities capabilities;
 extern uint32_t expected_responses;
 
 extern threading::thread reader_thread;
 extern threading::thread writer_thread;
 
-extern threading::mutex writer_mutex;
-extern threading::cond_var writer_cond;
-extern std::queue<Action> writer_queue;
+// NOTE: the queue is lock-free, the simulated user pushes
+// onto it and only the writer pops from it
+extern threading::spsc_queue<Action> writer_queue;
 
 extern TaggedDrawVector tagged_draw_vector;
 
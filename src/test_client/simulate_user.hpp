@@ -1,7 +1,7 @@
 #pragma once
 
-// common
-#include "../common/types.hpp"
+// test_client
+#include "workload.hpp"
 
 // cstd
 #include <cstdint>
@@ -17,17 +17,10 @@
 
 namespace test_client {
 
-Colour pick_random_colour();
-
-std::string generate_random_string();
-
-LineDraw random_line_draw();
-RectangleDraw random_rectangle_draw();
-CircleDraw random_circle_draw();
-TextDraw random_text_draw();
-
-Action generate_random_action();
-
-void simulate_behaviour(uint32_t iterations, double interval);
+void simulate_behaviour(
+    uint32_t iterations,
+    double interval,
+    const WorkloadProfile& profile
+);
 
 } // namespace test_client
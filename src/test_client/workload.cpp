@@ -0,0 +1,564 @@
+// test_client
+#include "workload.hpp"
+
+// common
+#include "../common/abort.hpp"
+#include "../common/stroke.hpp"
+
+// cstd
+#include <cmath>
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+// fmt
+#include <fmt/core.h>
+
+namespace test_client {
+
+static const std::unordered_map<std::string, ActionKind> weight_keys {
+    { "line", ActionKind::LINE },
+    { "rectangle", ActionKind::RECTANGLE },
+    { "circle", ActionKind::CIRCLE },
+    { "text", ActionKind::TEXT },
+    { "stroke", ActionKind::STROKE },
+    { "undo", ActionKind::UNDO },
+    { "delete", ActionKind::DELETE },
+    { "clear_mine", ActionKind::CLEAR_MINE },
+    { "clear_all", ActionKind::CLEAR_ALL },
+};
+
+WorkloadProfile uniform_profile(bool other_actions)
+{
+    WorkloadProfile profile {};
+
+    if (other_actions) {
+        profile.weights[static_cast<size_t>(ActionKind::UNDO)] = 1;
+        profile.weights[static_cast<size_t>(ActionKind::DELETE)] = 1;
+        profile.weights[static_cast<size_t>(ActionKind::CLEAR_MINE)] = 1;
+        profile.weights[static_cast<size_t>(ActionKind::CLEAR_ALL)] = 1;
+    }
+
+    return profile;
+}
+
+static std::string trim(const std::string& string)
+{
+    auto begin = string.find_first_not_of(" \t\r");
+
+    if (begin == std::string::npos) {
+        return {};
+    }
+
+    auto end = string.find_last_not_of(" \t\r");
+
+    return string.substr(begin, end - begin + 1);
+}
+
+// reads a single value and makes sure nothing is left over
+template <class T>
+static bool read_value(std::istringstream& values, T& field)
+{
+    T value {};
+
+    if (!(values >> value) || !(values >> std::ws).eof()) {
+        return false;
+    }
+
+    field = value;
+
+    return true;
+}
+
+static bool validate(const std::string& path, const WorkloadProfile& profile)
+{
+    auto fail = [&path](std::string_view reason) {
+        fmt::println(stderr, "error: {}: {}", path, reason);
+
+        return false;
+    };
+
+    if (std::any_of(
+            profile.weights.begin(),
+            profile.weights.end(),
+            [](double weight) {
+                return weight < 0;
+            }
+        )
+        || std::accumulate(profile.weights.begin(), profile.weights.end(), 0.0)
+               <= 0) {
+        return fail("the weights must be positive and not all zero");
+    }
+
+    if (profile.extent <= 0) {
+        return fail("the extent must be positive");
+    }
+
+    if (profile.hotspot_share < 0 || profile.hotspot_share > 1) {
+        return fail("the hotspot share must be between zero and one");
+    }
+
+    if (profile.hotspot_share > 0 && profile.hotspots.empty()) {
+        return fail("a hotspot share is given without any hotspots");
+    }
+
+    for (auto& hotspot : profile.hotspots) {
+        if (hotspot.radius <= 0 || hotspot.weight <= 0) {
+            return fail("the radius and weight of a hotspot must be positive");
+        }
+    }
+
+    if (profile.shape_size < 0 || profile.stroke_step <= 0
+        || profile.delete_max_id < 0) {
+        return fail("sizes and steps cannot be negative");
+    }
+
+    if (profile.stroke_width <= 0 || profile.stroke_width > 255) {
+        return fail("the width of a stroke must be between 1 and 255");
+    }
+
+    if (!profile.stroke_lines
+        && profile.stroke_segments_max >= STROKE_MAX_POINTS) {
+        return fail(fmt::format(
+            "a stroke can have at most {} segments",
+            STROKE_MAX_POINTS - 1
+        ));
+    }
+
+    if (profile.stroke_segments_min == 0
+        || profile.stroke_segments_min > profile.stroke_segments_max
+        || profile.text_length_min == 0
+        || profile.text_length_min > profile.text_length_max
+        || profile.undo_burst_min == 0
+        || profile.undo_burst_min > profile.undo_burst_max
+        || profile.burst_length_min == 0
+        || profile.burst_length_min > profile.burst_length_max) {
+        return fail("every range must be non-empty and start above zero");
+    }
+
+    if (profile.burst_probability < 0 || profile.burst_probability > 1
+        || profile.burst_speedup <= 0) {
+        return fail("invalid burst probability or speedup");
+    }
+
+    return true;
+}
+
+bool load_workload_profile(const std::string& path, WorkloadProfile& profile)
+{
+    std::ifstream file { path };
+
+    if (!file) {
+        fmt::println(stderr, "error: could not open {}", path);
+
+        return false;
+    }
+
+    profile = uniform_profile(false);
+
+    std::string line {};
+
+    for (size_t number = 1; std::getline(file, line); number++) {
+        line = trim(line.substr(0, line.find('#')));
+
+        if (line.empty()) {
+            continue;
+        }
+
+        auto separator = line.find('=');
+
+        if (separator == std::string::npos) {
+            fmt::println(stderr, "error: {}:{}: expected key = value", path, number);
+
+            return false;
+        }
+
+        std::string key = trim(line.substr(0, separator));
+
+        std::istringstream values { trim(line.substr(separator + 1)) };
+
+        bool is_valid { false };
+
+        if (auto iter = weight_keys.find(key); iter != weight_keys.end()) {
+            is_valid = read_value(
+                values,
+                profile.weights[static_cast<size_t>(iter->second)]
+            );
+        } else if (key == "hotspot") {
+            Hotspot hotspot {};
+
+            values >> hotspot.x >> hotspot.y >> hotspot.radius;
+
+            // the weight is optional
+            if (!(values >> std::ws).eof()) {
+                values >> hotspot.weight;
+            }
+
+            is_valid = !values.fail() && (values >> std::ws).eof();
+
+            profile.hotspots.push_back(hotspot);
+        } else if (key == "extent") {
+            is_valid = read_value(values, profile.extent);
+        } else if (key == "hotspot_share") {
+            is_valid = read_value(values, profile.hotspot_share);
+        } else if (key == "shape_size") {
+            is_valid = read_value(values, profile.shape_size);
+        } else if (key == "stroke_segments_min") {
+            is_valid = read_value(values, profile.stroke_segments_min);
+        } else if (key == "stroke_segments_max") {
+            is_valid = read_value(values, profile.stroke_segments_max);
+        } else if (key == "stroke_step") {
+            is_valid = read_value(values, profile.stroke_step);
+        } else if (key == "stroke_width") {
+            is_valid = read_value(values, profile.stroke_width);
+        } else if (key == "stroke_lines") {
+            is_valid = read_value(values, profile.stroke_lines);
+        } else if (key == "text_length_min") {
+            is_valid = read_value(values, profile.text_length_min);
+        } else if (key == "text_length_max") {
+            is_valid = read_value(values, profile.text_length_max);
+        } else if (key == "undo_burst_min") {
+            is_valid = read_value(values, profile.undo_burst_min);
+        } else if (key == "undo_burst_max") {
+            is_valid = read_value(values, profile.undo_burst_max);
+        } else if (key == "delete_max_id") {
+            is_valid = read_value(values, profile.delete_max_id);
+        } else if (key == "burst_probability") {
+            is_valid = read_value(values, profile.burst_probability);
+        } else if (key == "burst_length_min") {
+            is_valid = read_value(values, profile.burst_length_min);
+        } else if (key == "burst_length_max") {
+            is_valid = read_value(values, profile.burst_length_max);
+        } else if (key == "burst_speedup") {
+            is_valid = read_value(values, profile.burst_speedup);
+        } else if (key == "seed") {
+            is_valid = read_value(values, profile.seed);
+        } else {
+            fmt::println(stderr, "error: {}:{}: unknown key {}", path, number, key);
+
+            return false;
+        }
+
+        if (!is_valid) {
+            fmt::println(
+                stderr,
+                "error: {}:{}: invalid value for {}",
+                path,
+                number,
+                key
+            );
+
+            return false;
+        }
+    }
+
+    return validate(path, profile);
+}
+
+Workload::Workload(const WorkloadProfile& profile, uint64_t stream)
+    : m_profile(profile)
+    , m_action_dist(profile.weights.begin(), profile.weights.end())
+{
+    std::vector<double> hotspot_weights {};
+
+    for (auto& hotspot : profile.hotspots) {
+        hotspot_weights.push_back(hotspot.weight);
+    }
+
+    m_hotspot_dist = std::discrete_distribution<> { hotspot_weights.begin(),
+                                                    hotspot_weights.end() };
+
+    uint64_t seed = profile.seed;
+
+    if (seed == 0) {
+        std::random_device rd {};
+
+        seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+
+    // NOTE: every user gets its own stream of the same seed
+    // so the actions of a user do not depend on how the
+    // actions of all the users happen to interleave
+    std::seed_seq seq { static_cast<uint32_t>(seed),
+                        static_cast<uint32_t>(seed >> 32),
+                        static_cast<uint32_t>(stream),
+                        static_cast<uint32_t>(stream >> 32) };
+
+    m_mt.seed(seq);
+}
+
+Action Workload::next_action()
+{
+    if (m_stroke_remaining > 0) {
+        return next_stroke_segment();
+    }
+
+    if (m_undo_remaining > 0) {
+        m_undo_remaining--;
+
+        return Undo {};
+    }
+
+    auto kind = static_cast<ActionKind>(m_action_dist(m_mt));
+
+    switch (kind) {
+    case ActionKind::LINE:
+    case ActionKind::RECTANGLE:
+    case ActionKind::CIRCLE:
+    case ActionKind::TEXT:
+        return random_shape(kind);
+    case ActionKind::STROKE: {
+        std::uniform_int_distribution<uint32_t> segments_dist {
+            m_profile.stroke_segments_min,
+            m_profile.stroke_segments_max
+        };
+        std::uniform_real_distribution<> angle_dist { 0, 2 * M_PI };
+
+        auto [x, y] = random_point();
+
+        m_stroke_remaining = segments_dist(m_mt);
+        m_stroke_x = x;
+        m_stroke_y = y;
+        m_stroke_angle = angle_dist(m_mt);
+        m_stroke_colour = random_colour();
+
+        if (m_profile.stroke_lines) {
+            return next_stroke_segment();
+        }
+
+        std::uniform_int_distribution<int> width_dist {
+            1,
+            m_profile.stroke_width
+        };
+
+        stroke::Builder builder { m_stroke_colour,
+                                  static_cast<uint8_t>(width_dist(m_mt)),
+                                  x,
+                                  y };
+
+        while (m_stroke_remaining > 0) {
+            auto [x1, y1] = next_stroke_point();
+
+            builder.add(x1, y1);
+        }
+
+        return builder.build();
+    }
+    case ActionKind::UNDO: {
+        std::uniform_int_distribution<uint32_t> burst_dist {
+            m_profile.undo_burst_min,
+            m_profile.undo_burst_max
+        };
+
+        m_undo_remaining = burst_dist(m_mt) - 1;
+
+        return Undo {};
+    }
+    case ActionKind::DELETE: {
+        std::uniform_int_distribution<long> id_dist { 0,
+                                                      m_profile.delete_max_id };
+
+        return Delete { id_dist(m_mt) };
+    }
+    case ActionKind::CLEAR_MINE:
+        return Clear { Qualifier::MINE };
+    case ActionKind::CLEAR_ALL:
+        return Clear { Qualifier::ALL };
+    default:
+        ABORT("unreachable");
+    }
+}
+
+void Workload::without_strokes()
+{
+    m_profile.stroke_lines = true;
+}
+
+bool Workload::continues_burst()
+{
+    // strokes and bursts of undos are always sent in one go
+    if (m_stroke_remaining > 0 || m_undo_remaining > 0) {
+        return true;
+    }
+
+    if (m_burst_remaining > 0) {
+        m_burst_remaining--;
+
+        return true;
+    }
+
+    if (m_profile.burst_probability > 0) {
+        std::bernoulli_distribution burst_dist { m_profile.burst_probability };
+
+        if (burst_dist(m_mt)) {
+            std::uniform_int_distribution<uint32_t> length_dist {
+                m_profile.burst_length_min,
+                m_profile.burst_length_max
+            };
+
+            m_burst_remaining = length_dist(m_mt) - 1;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+double Workload::next_gap(double interval)
+{
+    return continues_burst() ? interval / m_profile.burst_speedup : interval;
+}
+
+Colour Workload::random_colour()
+{
+    std::uniform_int_distribution<int> channel_dist { 0, 255 };
+
+    Colour colour {};
+
+    colour.r = static_cast<uint8_t>(channel_dist(m_mt));
+    colour.g = static_cast<uint8_t>(channel_dist(m_mt));
+    colour.b = static_cast<uint8_t>(channel_dist(m_mt));
+
+    return colour;
+}
+
+std::pair<int, int> Workload::random_point()
+{
+    if (!m_profile.hotspots.empty() && m_profile.hotspot_share > 0) {
+        std::bernoulli_distribution share_dist { m_profile.hotspot_share };
+
+        if (share_dist(m_mt)) {
+            const Hotspot& hotspot = m_profile.hotspots[static_cast<size_t>(
+                m_hotspot_dist(m_mt)
+            )];
+
+            std::normal_distribution<> x_dist { static_cast<double>(hotspot.x),
+                                                hotspot.radius };
+            std::normal_distribution<> y_dist { static_cast<double>(hotspot.y),
+                                                hotspot.radius };
+
+            return { static_cast<int>(std::lround(x_dist(m_mt))),
+                     static_cast<int>(std::lround(y_dist(m_mt))) };
+        }
+    }
+
+    std::uniform_int_distribution<int> coord_dist { -m_profile.extent,
+                                                    m_profile.extent };
+
+    int x = coord_dist(m_mt);
+    int y = coord_dist(m_mt);
+
+    return { x, y };
+}
+
+std::pair<int, int> Workload::random_second_point(int x, int y)
+{
+    if (m_profile.shape_size == 0) {
+        return random_point();
+    }
+
+    std::uniform_int_distribution<int> offset_dist { -m_profile.shape_size,
+                                                     m_profile.shape_size };
+
+    int dx = offset_dist(m_mt);
+    int dy = offset_dist(m_mt);
+
+    return { x + dx, y + dy };
+}
+
+std::string Workload::random_string()
+{
+    std::uniform_int_distribution<uint32_t> length_dist {
+        m_profile.text_length_min,
+        m_profile.text_length_max
+    };
+
+    // NOTE: we are using 'a'-'z' as our list cause the
+    // olive.c supports a very limited character set
+    std::uniform_int_distribution<int> char_dist { 'a', 'z' };
+
+    uint32_t length = length_dist(m_mt);
+
+    std::string string {};
+
+    string.reserve(length);
+
+    for (uint32_t i = 0; i < length; i++) {
+        string.push_back(static_cast<char>(char_dist(m_mt)));
+    }
+
+    return string;
+}
+
+Draw Workload::random_shape(ActionKind kind)
+{
+    Colour colour = random_colour();
+
+    auto [x0, y0] = random_point();
+
+    switch (kind) {
+    case ActionKind::LINE: {
+        auto [x1, y1] = random_second_point(x0, y0);
+
+        return LineDraw { colour, x0, y0, x1, y1 };
+    }
+    case ActionKind::RECTANGLE: {
+        auto [x1, y1] = random_second_point(x0, y0);
+
+        return RectangleDraw { colour, x0, y0, x1, y1 };
+    }
+    case ActionKind::CIRCLE: {
+        std::uniform_int_distribution<int> radius_dist {
+            m_profile.shape_size == 0 ? 0 : 1,
+            m_profile.shape_size == 0 ? 255 : m_profile.shape_size
+        };
+
+        return CircleDraw { colour,
+                            x0,
+                            y0,
+                            static_cast<float>(radius_dist(m_mt)) };
+    }
+    case ActionKind::TEXT:
+        return TextDraw { colour, x0, y0, random_string() };
+    default:
+        ABORT("unreachable");
+    }
+}
+
+std::pair<int, int> Workload::next_stroke_point()
+{
+    // NOTE: a stroke is a random walk which only turns
+    // gradually, much like a hand would
+    std::normal_distribution<> turn_dist { 0, 0.35 };
+    std::uniform_int_distribution<int> step_dist { 1, m_profile.stroke_step };
+
+    m_stroke_remaining--;
+
+    m_stroke_angle += turn_dist(m_mt);
+
+    auto step = static_cast<double>(step_dist(m_mt));
+
+    m_stroke_x += std::cos(m_stroke_angle) * step;
+    m_stroke_y += std::sin(m_stroke_angle) * step;
+
+    return { static_cast<int>(std::lround(m_stroke_x)),
+             static_cast<int>(std::lround(m_stroke_y)) };
+}
+
+LineDraw Workload::next_stroke_segment()
+{
+    int x0 = static_cast<int>(std::lround(m_stroke_x));
+    int y0 = static_cast<int>(std::lround(m_stroke_y));
+
+    auto [x1, y1] = next_stroke_point();
+
+    return LineDraw { m_stroke_colour, x0, y0, x1, y1 };
+}
+
+} // namespace test_client
@@ -0,0 +1,154 @@
+#pragma once
+
+// common
+#include "../common/types.hpp"
+
+// std
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// cstd
+#include <cstdint>
+
+namespace test_client {
+
+// A workload profile describes the actions a simulated user
+// sends. Profiles are read from files of "key = value" lines
+// (with # starting a comment), please refer to the profiles
+// directory for the keys and what they mean. Anything left
+// out keeps the value of the uniform profile, which behaves
+// like the test client always has.
+
+enum class ActionKind : uint8_t {
+    LINE,
+    RECTANGLE,
+    CIRCLE,
+    TEXT,
+    STROKE,
+    UNDO,
+    DELETE,
+    CLEAR_MINE,
+    CLEAR_ALL,
+    COUNT,
+};
+
+struct Hotspot {
+    int x { 0 };
+    int y { 0 };
+    double radius { 0 };
+    double weight { 1 };
+};
+
+struct WorkloadProfile {
+    // relative weights of every kind of action (indexed by
+    // ActionKind)
+    std::vector<double> weights
+        = { 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+
+    // draws land uniformly in [-extent, extent] on both axes,
+    // except for the share which lands around a hotspot
+    // (normally distributed with the radius as the deviation)
+    int extent { 2000 };
+    std::vector<Hotspot> hotspots {};
+    double hotspot_share { 0 };
+
+    // how far the second point of a shape (or the radius of a
+    // circle) is from the first, zero picks both points (and
+    // a radius up to 255) independently
+    int shape_size { 0 };
+
+    // a freehand stroke is sent as a single stroke (of a width
+    // up to stroke_width), or as a run of short connected lines
+    // when stroke_lines is set (which is how strokes were sent
+    // before there were strokes)
+    uint32_t stroke_segments_min { 8 };
+    uint32_t stroke_segments_max { 64 };
+    int stroke_step { 8 };
+    int stroke_width { 1 };
+    bool stroke_lines { false };
+
+    uint32_t text_length_min { 1 };
+    uint32_t text_length_max { 64 };
+
+    uint32_t undo_burst_min { 1 };
+    uint32_t undo_burst_max { 1 };
+
+    long delete_max_id { 255 };
+
+    // every action has a chance of starting a burst, the
+    // actions of a burst (like the segments of a stroke or a
+    // burst of undos) are sent burst_speedup times quicker
+    double burst_probability { 0 };
+    uint32_t burst_length_min { 1 };
+    uint32_t burst_length_max { 1 };
+    double burst_speedup { 10 };
+
+    // zero picks a random seed
+    uint64_t seed { 0 };
+};
+
+WorkloadProfile uniform_profile(bool other_actions);
+
+bool load_workload_profile(const std::string& path, WorkloadProfile& profile);
+
+// Generates the actions of a single simulated user following
+// a profile, given the same seed (and stream) the sequence of
+// actions is always the same
+
+class Workload {
+   public:
+    Workload() = default;
+
+    Workload(const WorkloadProfile& profile, uint64_t stream);
+
+    Action next_action();
+
+    // strokes are sent as lines from now on, for a server which
+    // did not settle on strokes (which it would drop)
+    void without_strokes();
+
+    // whether the next action is part of the current burst
+    // (and should be sent straight away)
+    [[nodiscard]] bool continues_burst();
+
+    // the time to wait before sending the next action given
+    // the regular interval
+    [[nodiscard]] double next_gap(double interval);
+
+   private:
+    Colour random_colour();
+
+    std::pair<int, int> random_point();
+
+    std::pair<int, int> random_second_point(int x, int y);
+
+    std::string random_string();
+
+    Draw random_shape(ActionKind kind);
+
+    std::pair<int, int> next_stroke_point();
+
+    LineDraw next_stroke_segment();
+
+    WorkloadProfile m_profile {};
+
+    std::mt19937_64 m_mt {};
+
+    std::discrete_distribution<> m_action_dist {};
+    std::discrete_distribution<> m_hotspot_dist {};
+
+    // the stroke currently being drawn
+    uint32_t m_stroke_remaining { 0 };
+    double m_stroke_x { 0 };
+    double m_stroke_y { 0 };
+    double m_stroke_angle { 0 };
+    Colour m_stroke_colour {};
+
+    uint32_t m_undo_remaining { 0 };
+
+    uint32_t m_burst_remaining { 0 };
+};
+
+} // namespace test_client
@@ -7,6 +7,9 @@
 #include "../common/threading.hpp"
 #include "../common/types.hpp"
 
+// std
+#include <utility>
+
 // spdlog
 #include <spdlog/spdlog.h>
 
@@ -20,22 +23,24 @@ Writer::Writer(Channel channel)
 void Writer::operator()()
 {
     for (;;) {
-        Action action {};
+        ActionBatch batch { share::user, {} };
 
-        {
-            threading::unique_mutex_guard guard { share::writer_mutex };
+        batch.actions.push_back(BatchedAction { share::writer_queue.pop() });
 
-            share::writer_cond.wait(guard, []() {
-                return share::writer_queue.empty();
-            });
+        // NOTE: whatever else is already pending goes out in the
+        // same frame (as long as the server takes batches)
+        size_t limit = (share::capabilities & CAPABILITY_BATCHING) != 0
+                           ? ACTION_BATCH_LIMIT
+                           : 1;
 
-            action = share::writer_queue.back();
+        Action action {};
 
-            share::writer_queue.pop();
+        while (batch.actions.size() < limit
+               && share::writer_queue.try_pop(action)) {
+            batch.actions.push_back(BatchedAction { std::move(action) });
         }
 
-        ByteString bytes { serialize<Payload>(TaggedAction { share::username,
-                                                             action }) };
+        ByteString bytes { serialize<Payload>(to_payload(std::move(batch))) };
 
         auto status = m_channel.write(bytes);
 